@@ -1595,6 +1595,10 @@ function test_mon_osd_misc()
   ceph osd reweight-by-pg 110
   ceph osd reweight-by-pg 110 rbd
   expect_false ceph osd reweight-by-pg 110 boguspoolasdfasdfasdf
+  ceph osd reweight-by-pg-optimize
+  ceph osd reweight-by-pg-optimize 5 rbd
+  expect_false ceph osd reweight-by-pg-optimize 5 boguspoolasdfasdfasdf
+  expect_false ceph osd reweight-by-pg-optimize 100000
 }
 
 function test_mon_heap_profiler()
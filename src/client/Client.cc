@@ -1454,8 +1454,10 @@ int Client::verify_reply_trace(int r,
   if (extra_bl.length() >= 8) {
     // if the extra bufferlist has a buffer, we assume its the created inode
     // and that this request to create succeeded in actually creating
-    // the inode (won the race with other create requests)
-    ::decode(created_ino, extra_bl);
+    // the inode (won the race with other create requests).  The session's
+    // delegated inos may follow; handle_client_reply took those.
+    bufferlist::iterator p = extra_bl.begin();
+    ::decode(created_ino, p);
     got_created_ino = true;
     ldout(cct, 10) << "make_request created ino " << created_ino << dendl;
   }
@@ -2211,6 +2213,8 @@ void Client::handle_client_reply(MClientReply *reply)
   
   assert(request->reply == NULL);
   request->reply = reply;
+  if (request->get_op() == CEPH_MDS_OP_CREATE)
+    update_delegated_inos(session, reply);
   insert_trace(request, session);
 
   // Handle unsafe reply
@@ -2261,6 +2265,28 @@ void Client::handle_client_reply(MClientReply *reply)
     mount_cond.Signal();
 }
 
+void Client::update_delegated_inos(MetaSession *session, MClientReply *reply)
+{
+  if (!reply->get_connection()->has_feature(CEPH_FEATURE_MDS_DELEG_INO))
+    return;
+
+  // the created ino, then the inos the mds holds for our next creates
+  bufferlist::iterator p = reply->get_extra_bl().begin();
+  if (p.end())
+    return;
+  try {
+    inodeno_t created_ino;
+    ::decode(created_ino, p);
+    ::decode(session->delegated_inos, p);
+  } catch (buffer::error& e) {
+    ldout(cct, 0) << "couldn't decode delegated inos from mds." << session->mds_num
+		  << dendl;
+    return;
+  }
+  ldout(cct, 10) << "mds." << session->mds_num << " delegated inos "
+		 << session->delegated_inos << dendl;
+}
+
 void Client::_handle_full_flag(int64_t pool)
 {
   ldout(cct, 1) << __func__ << ": FULL: cancelling outstanding operations "
@@ -7794,22 +7820,26 @@ int Client::uninline_data(Inode *in, Context *onfinish)
 
 int Client::read(int fd, char *buf, loff_t size, loff_t offset)
 {
-  Mutex::Locker lock(client_lock);
-  tout(cct) << "read" << std::endl;
-  tout(cct) << fd << std::endl;
-  tout(cct) << size << std::endl;
-  tout(cct) << offset << std::endl;
+  bufferlist bl;
+  int r;
+  {
+    Mutex::Locker lock(client_lock);
+    tout(cct) << "read" << std::endl;
+    tout(cct) << fd << std::endl;
+    tout(cct) << size << std::endl;
+    tout(cct) << offset << std::endl;
 
-  Fh *f = get_filehandle(fd);
-  if (!f)
-    return -EBADF;
+    Fh *f = get_filehandle(fd);
+    if (!f)
+      return -EBADF;
 #if defined(__linux__) && defined(O_PATH)
-  if (f->flags & O_PATH)
-    return -EBADF;
+    if (f->flags & O_PATH)
+      return -EBADF;
 #endif
-  bufferlist bl;
-  int r = _read(f, offset, size, &bl);
-  ldout(cct, 3) << "read(" << fd << ", " << (void*)buf << ", " << size << ", " << offset << ") = " << r << dendl;
+    r = _read(f, offset, size, &bl);
+    ldout(cct, 3) << "read(" << fd << ", " << (void*)buf << ", " << size << ", " << offset << ") = " << r << dendl;
+  }
+  // copy out to the caller without holding client_lock
   if (r >= 0) {
     bl.copy(0, bl.length(), buf);
     r = bl.length();
@@ -8140,6 +8170,12 @@ void Client::sync_write_commit(InodeRef& in)
 
 int Client::write(int fd, const char *buf, loff_t size, loff_t offset) 
 {
+  // copy into fresh buffer (since our write may be resub, async), before
+  // taking client_lock
+  bufferlist bl;
+  if (size > 0)
+    bl.push_back(buffer::copy(buf, size));
+
   Mutex::Locker lock(client_lock);
   tout(cct) << "write" << std::endl;
   tout(cct) << fd << std::endl;
@@ -8153,7 +8189,7 @@ int Client::write(int fd, const char *buf, loff_t size, loff_t offset)
   if (fh->flags & O_PATH)
     return -EBADF;
 #endif
-  int r = _write(fh, offset, size, buf, NULL, 0);
+  int r = _write(fh, offset, size, bl);
   ldout(cct, 3) << "write(" << fd << ", \"...\", " << size << ", " << offset << ") = " << r << dendl;
   return r;
 }
@@ -8167,29 +8203,45 @@ int Client::pwritev(int fd, const struct iovec *iov, int iovcnt, int64_t offset)
 
 int Client::_preadv_pwritev(int fd, const struct iovec *iov, unsigned iovcnt, int64_t offset, bool write)
 {
-    Mutex::Locker lock(client_lock);
-    tout(cct) << fd << std::endl;
-    tout(cct) << offset << std::endl;
-
-    Fh *fh = get_filehandle(fd);
-    if (!fh)
-        return -EBADF;
-#if defined(__linux__) && defined(O_PATH)
-    if (fh->flags & O_PATH)
-        return -EBADF;
-#endif
     loff_t totallen = 0;
     for (unsigned i = 0; i < iovcnt; i++) {
         totallen += iov[i].iov_len;
     }
+
+    // copy user data in and out without holding client_lock
+    bufferlist bl;
+    if (write) {
+        for (unsigned i = 0; i < iovcnt; i++) {
+            if (iov[i].iov_len > 0)
+                bl.push_back(buffer::copy((char*)iov[i].iov_base, iov[i].iov_len));
+        }
+    }
+
+    int r;
+    {
+        Mutex::Locker lock(client_lock);
+        tout(cct) << fd << std::endl;
+        tout(cct) << offset << std::endl;
+
+        Fh *fh = get_filehandle(fd);
+        if (!fh)
+            return -EBADF;
+#if defined(__linux__) && defined(O_PATH)
+        if (fh->flags & O_PATH)
+            return -EBADF;
+#endif
+        if (write) {
+            r = _write(fh, offset, totallen, bl);
+            ldout(cct, 3) << "pwritev(" << fd << ", \"...\", " << totallen << ", " << offset << ") = " << r << dendl;
+        } else {
+            r = _read(fh, offset, totallen, &bl);
+            ldout(cct, 3) << "preadv(" << fd << ", " <<  offset << ") = " << r << dendl;
+        }
+    }
+
     if (write) {
-        int w = _write(fh, offset, totallen, NULL, iov, iovcnt);
-        ldout(cct, 3) << "pwritev(" << fd << ", \"...\", " << totallen << ", " << offset << ") = " << w << dendl;
-        return w;
+        return r;
     } else {
-        bufferlist bl;
-        int r = _read(fh, offset, totallen, &bl);
-        ldout(cct, 3) << "preadv(" << fd << ", " <<  offset << ") = " << r << dendl;
         int bufoff = 0;
         for (unsigned j = 0, resid = r; j < iovcnt && resid > 0; j++) {
                /*
@@ -8209,8 +8261,7 @@ int Client::_preadv_pwritev(int fd, const struct iovec *iov, unsigned iovcnt, in
     }
 }
 
-int Client::_write(Fh *f, int64_t offset, uint64_t size, const char *buf,
-                  const struct iovec *iov, int iovcnt)
+int Client::_write(Fh *f, int64_t offset, uint64_t size, bufferlist& bl)
 {
   if ((uint64_t)(offset+size) > mdsmap->get_max_filesize()) //too large!
     return -EFBIG;
@@ -8261,23 +8312,7 @@ int Client::_write(Fh *f, int64_t offset, uint64_t size, const char *buf,
     assert(in->inline_version > 0);
   }
 
-  // copy into fresh buffer (since our write may be resub, async)
-  bufferlist bl;
-  bufferptr *bparr = NULL;
-  if (buf) {
-      bufferptr bp;
-      if (size > 0) bp = buffer::copy(buf, size);
-      bl.push_back( bp );
-  } else if (iov){
-      //iov case 
-      bparr = new bufferptr[iovcnt];
-      for (int i = 0; i < iovcnt; i++) {
-        if (iov[i].iov_len > 0) {
-            bparr[i] = buffer::copy((char*)iov[i].iov_base, iov[i].iov_len);
-        }
-        bl.push_back( bparr[i] );
-      }
-  }
+  assert(bl.length() == size);
 
   utime_t lat;
   uint64_t totalwritten;
@@ -8433,7 +8468,6 @@ done:
   }
 
   put_cap_ref(in, CEPH_CAP_FILE_WR);
-  delete[] bparr; 
   return r;
 }
 
@@ -11279,6 +11313,11 @@ int Client::ll_commit_blocks(Inode *in,
 
 int Client::ll_write(Fh *fh, loff_t off, loff_t len, const char *data)
 {
+  // copy the caller's data before taking client_lock
+  bufferlist bl;
+  if (len > 0)
+    bl.push_back(buffer::copy(data, len));
+
   Mutex::Locker lock(client_lock);
   ldout(cct, 3) << "ll_write " << fh << " " << fh->inode->ino << " " << off <<
     "~" << len << dendl;
@@ -11287,7 +11326,7 @@ int Client::ll_write(Fh *fh, loff_t off, loff_t len, const char *data)
   tout(cct) << off << std::endl;
   tout(cct) << len << std::endl;
 
-  int r = _write(fh, off, len, data, NULL, 0);
+  int r = _write(fh, off, len, bl);
   ldout(cct, 3) << "ll_write " << fh << " " << off << "~" << len << " = " << r
 		<< dendl;
   return r;
@@ -348,6 +348,7 @@ protected:
   void kick_requests_closed(MetaSession *session);
   void handle_client_request_forward(MClientRequestForward *reply);
   void handle_client_reply(MClientReply *reply);
+  void update_delegated_inos(MetaSession *session, MClientReply *reply);
   bool is_dir_operation(MetaRequest *request);
 
   bool   initialized;
@@ -746,8 +747,7 @@ private:
 
   loff_t _lseek(Fh *fh, loff_t offset, int whence);
   int _read(Fh *fh, int64_t offset, uint64_t size, bufferlist *bl);
-  int _write(Fh *fh, int64_t offset, uint64_t size, const char *buf,
-          const struct iovec *iov, int iovcnt);
+  int _write(Fh *fh, int64_t offset, uint64_t size, bufferlist& bl);
   int _preadv_pwritev(int fd, const struct iovec *iov, unsigned iovcnt, int64_t offset, bool write);
   int _flush(Fh *fh);
   int _fsync(Fh *fh, bool syncdataonly);
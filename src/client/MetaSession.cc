@@ -32,6 +32,7 @@ void MetaSession::dump(Formatter *f) const
   f->dump_unsigned("cap_renew_seq", cap_renew_seq);
   f->dump_int("num_caps", num_caps);
   f->dump_string("state", get_state_name());
+  f->dump_stream("delegated_inos") << delegated_inos;
 }
 
 MetaSession::~MetaSession()
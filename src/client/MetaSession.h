@@ -8,6 +8,7 @@
 #include "include/utime.h"
 #include "msg/msg_types.h"
 #include "include/xlist.h"
+#include "include/interval_set.h"
 
 #include "messages/MClientCapRelease.h"
 #include "mds/MDSMap.h"
@@ -52,7 +53,10 @@ struct MetaSession {
   Cap *s_cap_iterator;
 
   MClientCapRelease *release;
-  
+
+  // inos the mds preallocated for our creates, as of the last create reply
+  interval_set<inodeno_t> delegated_inos;
+
   MetaSession()
     : mds_num(-1), con(NULL),
       seq(0), cap_gen(0), cap_renew_seq(0), num_caps(0),
@@ -25,6 +25,7 @@ CLS_NAME(rgw)
 cls_handle_t h_class;
 cls_method_handle_t h_rgw_bucket_init_index;
 cls_method_handle_t h_rgw_bucket_set_tag_timeout;
+cls_method_handle_t h_rgw_bucket_set_resharding;
 cls_method_handle_t h_rgw_bucket_list;
 cls_method_handle_t h_rgw_bucket_check_index;
 cls_method_handle_t h_rgw_bucket_rebuild_index;
@@ -409,6 +410,24 @@ static int read_bucket_header(cls_method_context_t hctx, struct rgw_bucket_dir_h
   return 0;
 }
 
+/*
+ * Index updates check this before touching the shard, so that nothing
+ * changes under a reshard once it has started copying entries out.
+ */
+static int check_bucket_resharding(cls_method_context_t hctx)
+{
+  struct rgw_bucket_dir_header header;
+  int rc = read_bucket_header(hctx, &header);
+  if (rc < 0) {
+    CLS_LOG(1, "ERROR: check_bucket_resharding(): failed to read header\n");
+    return rc;
+  }
+  if (header.resharding) {
+    return -CLS_RGW_ERR_BUSY_RESHARDING;
+  }
+  return 0;
+}
+
 int rgw_bucket_list(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
 {
   bufferlist::iterator iter = in->begin();
@@ -506,6 +525,7 @@ static int check_index(cls_method_context_t hctx, struct rgw_bucket_dir_header *
 
   calc_header->tag_timeout = existing_header->tag_timeout;
   calc_header->ver = existing_header->ver;
+  calc_header->resharding = existing_header->resharding;
 
   bufferlist bl;
 
@@ -634,6 +654,30 @@ int rgw_bucket_set_tag_timeout(cls_method_context_t hctx, bufferlist *in, buffer
   return write_bucket_header(hctx, &header);
 }
 
+int rgw_bucket_set_resharding(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
+{
+  // decode request
+  rgw_cls_set_resharding_op op;
+  bufferlist::iterator iter = in->begin();
+  try {
+    ::decode(op, iter);
+  } catch (buffer::error& err) {
+    CLS_LOG(1, "ERROR: rgw_bucket_set_resharding(): failed to decode request\n");
+    return -EINVAL;
+  }
+
+  struct rgw_bucket_dir_header header;
+  int rc = read_bucket_header(hctx, &header);
+  if (rc < 0) {
+    CLS_LOG(1, "ERROR: rgw_bucket_set_resharding(): failed to read header\n");
+    return rc;
+  }
+
+  header.resharding = op.resharding;
+
+  return write_bucket_header(hctx, &header);
+}
+
 static int read_key_entry(cls_method_context_t hctx, cls_rgw_obj_key& key, string *idx, struct rgw_bucket_dir_entry *entry,
                           bool special_delete_marker_name = false);
 
@@ -657,11 +701,21 @@ int rgw_bucket_prepare_op(cls_method_context_t hctx, bufferlist *in, bufferlist
   CLS_LOG(1, "rgw_bucket_prepare_op(): request: op=%d name=%s instance=%s tag=%s\n",
           op.op, op.key.name.c_str(), op.key.instance.c_str(), op.tag.c_str());
 
+  struct rgw_bucket_dir_header header;
+  int rc = read_bucket_header(hctx, &header);
+  if (rc < 0) {
+    CLS_LOG(1, "ERROR: rgw_bucket_prepare_op(): failed to read header\n");
+    return rc;
+  }
+  if (header.resharding) {
+    return -CLS_RGW_ERR_BUSY_RESHARDING;
+  }
+
   // get on-disk state
   string idx;
 
   struct rgw_bucket_dir_entry entry;
-  int rc = read_key_entry(hctx, op.key, &idx, &entry);
+  rc = read_key_entry(hctx, op.key, &idx, &entry);
   if (rc < 0 && rc != -ENOENT)
     return rc;
 
@@ -683,13 +737,6 @@ int rgw_bucket_prepare_op(cls_method_context_t hctx, bufferlist *in, bufferlist
   info.op = op.op;
   entry.pending_map.insert(pair<string, rgw_bucket_pending_info>(op.tag, info));
 
-  struct rgw_bucket_dir_header header;
-  rc = read_bucket_header(hctx, &header);
-  if (rc < 0) {
-    CLS_LOG(1, "ERROR: rgw_bucket_complete_op(): failed to read header\n");
-    return rc;
-  }
-
   if (op.log_op) {
     rc = log_index_operation(hctx, op.key, op.op, op.tag, entry.meta.mtime,
                              entry.ver, info.state, header.ver, header.max_marker, op.bilog_flags, NULL, NULL);
@@ -804,6 +851,9 @@ int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist
     CLS_LOG(1, "ERROR: rgw_bucket_complete_op(): failed to read header\n");
     return -EINVAL;
   }
+  if (header.resharding) {
+    return -CLS_RGW_ERR_BUSY_RESHARDING;
+  }
 
   struct rgw_bucket_dir_entry entry;
   bool ondisk = true;
@@ -1376,6 +1426,11 @@ static int rgw_bucket_link_olh(cls_method_context_t hctx, bufferlist *in, buffer
     return -EINVAL;
   }
 
+  int rc = check_bucket_resharding(hctx);
+  if (rc < 0) {
+    return rc;
+  }
+
   BIVerObjEntry obj(hctx, op.key);
   BIOLHEntry olh(hctx, op.key);
 
@@ -1550,6 +1605,11 @@ static int rgw_bucket_unlink_instance(cls_method_context_t hctx, bufferlist *in,
     return -EINVAL;
   }
 
+  int rc = check_bucket_resharding(hctx);
+  if (rc < 0) {
+    return rc;
+  }
+
   cls_rgw_obj_key dest_key = op.key;
   if (dest_key.instance == "null") {
     dest_key.instance.clear();
@@ -1731,6 +1791,11 @@ static int rgw_bucket_trim_olh_log(cls_method_context_t hctx, bufferlist *in, bu
     return -EINVAL;
   }
 
+  int rc = check_bucket_resharding(hctx);
+  if (rc < 0) {
+    return rc;
+  }
+
   if (!op.olh.instance.empty()) {
     CLS_LOG(1, "bad key passed in (non empty instance)");
     return -EINVAL;
@@ -1782,6 +1847,11 @@ static int rgw_bucket_clear_olh(cls_method_context_t hctx, bufferlist *in, buffe
     return -EINVAL;
   }
 
+  int rc = check_bucket_resharding(hctx);
+  if (rc < 0) {
+    return rc;
+  }
+
   if (!op.key.instance.empty()) {
     CLS_LOG(1, "bad key passed in (non empty instance)");
     return -EINVAL;
@@ -1849,6 +1919,9 @@ int rgw_dir_suggest_changes(cls_method_context_t hctx, bufferlist *in, bufferlis
     CLS_LOG(1, "ERROR: rgw_dir_suggest_changes(): failed to read header\n");
     return rc;
   }
+  if (header.resharding) {
+    return -CLS_RGW_ERR_BUSY_RESHARDING;
+  }
 
   tag_timeout = (header.tag_timeout ? header.tag_timeout : CEPH_RGW_TAG_TIMEOUT);
 
@@ -3170,6 +3243,7 @@ void __cls_init()
   /* bucket index */
   cls_register_cxx_method(h_class, "bucket_init_index", CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_init_index, &h_rgw_bucket_init_index);
   cls_register_cxx_method(h_class, "bucket_set_tag_timeout", CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_set_tag_timeout, &h_rgw_bucket_set_tag_timeout);
+  cls_register_cxx_method(h_class, "bucket_set_resharding", CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_set_resharding, &h_rgw_bucket_set_resharding);
   cls_register_cxx_method(h_class, "bucket_list", CLS_METHOD_RD, rgw_bucket_list, &h_rgw_bucket_list);
   cls_register_cxx_method(h_class, "bucket_check_index", CLS_METHOD_RD, rgw_bucket_check_index, &h_rgw_bucket_check_index);
   cls_register_cxx_method(h_class, "bucket_rebuild_index", CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_rebuild_index, &h_rgw_bucket_rebuild_index);
@@ -138,6 +138,27 @@ int CLSRGWIssueSetTagTimeout::issue_op(int shard_id, const string& oid)
   return issue_bucket_set_tag_timeout_op(io_ctx, oid, tag_timeout, &manager);
 }
 
+void cls_rgw_bucket_set_resharding(ObjectWriteOperation& o, bool resharding)
+{
+  bufferlist in;
+  struct rgw_cls_set_resharding_op call;
+  call.resharding = resharding;
+  ::encode(call, in);
+  o.exec("rgw", "bucket_set_resharding", in);
+}
+
+static bool issue_bucket_set_resharding_op(librados::IoCtx& io_ctx,
+    const string& oid, bool resharding, BucketIndexAioManager *manager) {
+  ObjectWriteOperation op;
+  cls_rgw_bucket_set_resharding(op, resharding);
+  return manager->aio_operate(io_ctx, oid, &op);
+}
+
+int CLSRGWIssueSetBucketResharding::issue_op(int shard_id, const string& oid)
+{
+  return issue_bucket_set_resharding_op(io_ctx, oid, resharding, &manager);
+}
+
 void cls_rgw_bucket_prepare_op(ObjectWriteOperation& o, RGWModifyOp op, string& tag,
                                const cls_rgw_obj_key& key, const string& locator, bool log_op,
                                uint16_t bilog_flags)
@@ -276,6 +297,15 @@ int cls_rgw_bi_put(librados::IoCtx& io_ctx, const string oid, rgw_cls_bi_entry&
   return 0;
 }
 
+void cls_rgw_bi_put(librados::ObjectWriteOperation& op, const string oid, rgw_cls_bi_entry& entry)
+{
+  bufferlist in;
+  struct rgw_cls_bi_put_op call;
+  call.entry = entry;
+  ::encode(call, in);
+  op.exec("rgw", "bi_put", in);
+}
+
 int cls_rgw_bi_list(librados::IoCtx& io_ctx, const string oid,
                    const string& name, const string& marker, uint32_t max,
                    list<rgw_cls_bi_entry> *entries, bool *is_truncated)
@@ -303,6 +303,19 @@ public:
     CLSRGWConcurrentIO(ioc, _bucket_objs, _max_aio), tag_timeout(_tag_timeout) {}
 };
 
+/* while set, the shard refuses index updates with -CLS_RGW_ERR_BUSY_RESHARDING */
+void cls_rgw_bucket_set_resharding(librados::ObjectWriteOperation& o, bool resharding);
+
+class CLSRGWIssueSetBucketResharding : public CLSRGWConcurrentIO {
+  bool resharding;
+protected:
+  int issue_op(int shard_id, const string& oid);
+public:
+  CLSRGWIssueSetBucketResharding(librados::IoCtx& ioc, map<int, string>& _bucket_objs,
+                     uint32_t _max_aio, bool _resharding) :
+    CLSRGWConcurrentIO(ioc, _bucket_objs, _max_aio), resharding(_resharding) {}
+};
+
 void cls_rgw_bucket_prepare_op(librados::ObjectWriteOperation& o, RGWModifyOp op, string& tag,
                                const cls_rgw_obj_key& key, const string& locator, bool log_op,
                                uint16_t bilog_op);
@@ -323,6 +336,7 @@ int cls_rgw_bi_get(librados::IoCtx& io_ctx, const string oid,
                    BIIndexType index_type, cls_rgw_obj_key& key,
                    rgw_cls_bi_entry *entry);
 int cls_rgw_bi_put(librados::IoCtx& io_ctx, const string oid, rgw_cls_bi_entry& entry);
+void cls_rgw_bi_put(librados::ObjectWriteOperation& op, const string oid, rgw_cls_bi_entry& entry);
 int cls_rgw_bi_list(librados::IoCtx& io_ctx, const string oid,
                    const string& name, const string& marker, uint32_t max,
                    list<rgw_cls_bi_entry> *entries, bool *is_truncated);
@@ -16,6 +16,18 @@ void rgw_cls_tag_timeout_op::generate_test_instances(list<rgw_cls_tag_timeout_op
   ls.back()->tag_timeout = 23323;
 }
 
+void rgw_cls_set_resharding_op::dump(Formatter *f) const
+{
+  f->dump_bool("resharding", resharding);
+}
+
+void rgw_cls_set_resharding_op::generate_test_instances(list<rgw_cls_set_resharding_op*>& ls)
+{
+  ls.push_back(new rgw_cls_set_resharding_op);
+  ls.push_back(new rgw_cls_set_resharding_op);
+  ls.back()->resharding = true;
+}
+
 void cls_rgw_gc_set_entry_op::dump(Formatter *f) const
 {
   f->dump_unsigned("expiration_secs", expiration_secs);
@@ -27,6 +27,27 @@ struct rgw_cls_tag_timeout_op
 };
 WRITE_CLASS_ENCODER(rgw_cls_tag_timeout_op)
 
+struct rgw_cls_set_resharding_op
+{
+  bool resharding;
+
+  rgw_cls_set_resharding_op() : resharding(false) {}
+
+  void encode(bufferlist &bl) const {
+    ENCODE_START(1, 1, bl);
+    ::encode(resharding, bl);
+    ENCODE_FINISH(bl);
+  }
+  void decode(bufferlist::iterator &bl) {
+    DECODE_START(1, bl);
+    ::decode(resharding, bl);
+    DECODE_FINISH(bl);
+  }
+  void dump(Formatter *f) const;
+  static void generate_test_instances(list<rgw_cls_set_resharding_op*>& ls);
+};
+WRITE_CLASS_ENCODER(rgw_cls_set_resharding_op)
+
 struct rgw_cls_obj_prepare_op
 {
   RGWModifyOp op;
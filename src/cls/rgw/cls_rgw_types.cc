@@ -457,12 +457,15 @@ void rgw_bucket_dir_header::generate_test_instances(list<rgw_bucket_dir_header*>
   }
 
   o.push_back(new rgw_bucket_dir_header);
+  o.push_back(new rgw_bucket_dir_header);
+  o.back()->resharding = true;
 }
 
 void rgw_bucket_dir_header::dump(Formatter *f) const
 {
   f->dump_int("ver", ver);
   f->dump_int("master_ver", master_ver);
+  f->dump_bool("resharding", resharding);
   map<uint8_t, struct rgw_bucket_category_stats>::const_iterator iter = stats.begin();
   f->open_array_section("stats");
   for (; iter != stats.end(); ++iter) {
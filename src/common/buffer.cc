@@ -1046,6 +1046,13 @@ static simple_spinlock_t buffer_debug_lock = SIMPLE_SPINLOCK_INITIALIZER;
   void buffer::list::iterator_impl<is_const>::copy(unsigned len, char *dest)
   {
     if (p == ls->end()) seek(off);
+    // fast path: it is all in the current buffer, and some of that is left
+    if (p != ls->end() && len < p->length() - p_off) {
+      maybe_inline_memcpy(dest, p->c_str() + p_off, len, 8);
+      p_off += len;
+      off += len;
+      return;
+    }
     while (len > 0) {
       if (p == ls->end())
 	throw end_of_buffer();
@@ -1597,6 +1604,26 @@ static simple_spinlock_t buffer_debug_lock = SIMPLE_SPINLOCK_INITIALIZER;
     }
   }
 
+  buffer::list::contiguous_appender buffer::list::get_contiguous_appender(size_t len)
+  {
+    if (append_buffer.unused_tail_length() < len) {
+      unsigned alen = CEPH_BUFFER_APPEND_SIZE * (((len-1) / CEPH_BUFFER_APPEND_SIZE) + 1);
+      append_buffer = create_aligned(alen, CEPH_BUFFER_APPEND_SIZE);
+      append_buffer.set_length(0);   // unused, so far.
+    }
+    char *start = len ? append_buffer.c_str() + append_buffer.length() : NULL;
+    return contiguous_appender(this, start, len);
+  }
+
+  void buffer::list::commit_contiguous(unsigned len)
+  {
+    if (len == 0)
+      return;
+    // the data is already in place in the append_buffer, just claim it
+    append_buffer.set_length(append_buffer.length() + len);
+    append(append_buffer, append_buffer.end() - len, len);	// add segment to the list
+  }
+
   void buffer::list::append(const ptr& bp)
   {
     if (bp.length())
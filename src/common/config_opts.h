@@ -281,6 +281,10 @@ OPTION(mon_daemon_bytes, OPT_U64, 400ul << 20)  // mds, osd message memory cap (
 OPTION(mon_max_log_entries_per_event, OPT_INT, 4096)
 OPTION(mon_reweight_min_pgs_per_osd, OPT_U64, 10)   // min pgs per osd for reweight-by-pg command
 OPTION(mon_reweight_min_bytes_per_osd, OPT_U64, 100*1024*1024)   // min bytes per osd for reweight-by-utilization command
+OPTION(mon_pg_balance_max_iterations, OPT_INT, 20)   // adjustment rounds for reweight-by-pg-optimize
+OPTION(mon_pg_balance_iterations_limit, OPT_INT, 100)   // max rounds a reweight-by-pg-optimize command may ask for
+OPTION(mon_pg_balance_max_change, OPT_FLOAT, .05)   // max fractional reweight change per round for reweight-by-pg-optimize
+OPTION(mon_pg_balance_max_mappings, OPT_U64, 1000000)   // max pg mappings (pgs times rounds) a reweight-by-pg-optimize command may do
 OPTION(mon_health_data_update_interval, OPT_FLOAT, 60.0)
 OPTION(mon_health_to_clog, OPT_BOOL, true)
 OPTION(mon_health_to_clog_interval, OPT_INT, 3600)
@@ -426,9 +430,11 @@ OPTION(journaler_batch_max, OPT_U64, 0)  // max bytes we'll delay flushing; disa
 OPTION(mds_data, OPT_STR, "/var/lib/ceph/mds/$cluster-$id")
 OPTION(mds_max_file_size, OPT_U64, 1ULL << 40) // Used when creating new CephFS. Change with 'ceph mds set max_file_size <size>' afterwards
 OPTION(mds_cache_size, OPT_INT, 100000)
+OPTION(mds_cache_memory_limit, OPT_U64, 0) // if nonzero, bound the cache by approximate bytes instead of mds_cache_size
 OPTION(mds_cache_mid, OPT_FLOAT, .7)
 OPTION(mds_max_file_recover, OPT_U32, 32)
 OPTION(mds_dir_max_commit_size, OPT_INT, 10) // MB
+OPTION(mds_readdir_prefetch, OPT_BOOL, true) // fetch the next dirfrag while a client lists the current one
 OPTION(mds_decay_halflife, OPT_FLOAT, 5)
 OPTION(mds_beacon_interval, OPT_FLOAT, 4)
 OPTION(mds_beacon_grace, OPT_FLOAT, 15)
@@ -451,6 +457,8 @@ OPTION(mds_early_reply, OPT_BOOL, true)
 OPTION(mds_default_dir_hash, OPT_INT, CEPH_STR_HASH_RJENKINS)
 OPTION(mds_log, OPT_BOOL, true)
 OPTION(mds_log_pause, OPT_BOOL, false)
+OPTION(mds_log_max_batch_events, OPT_INT, 128)  // events appended to the journal per submit thread pass
+OPTION(mds_log_max_outstanding_bytes, OPT_U64, 64 << 20)  // journaled but not yet safe; 0 = unlimited
 OPTION(mds_log_skip_corrupt_events, OPT_BOOL, false)
 OPTION(mds_log_max_events, OPT_INT, -1)
 OPTION(mds_log_events_per_segment, OPT_INT, 1024)
@@ -661,6 +669,7 @@ OPTION(osd_disk_threads, OPT_INT, 1)
 OPTION(osd_disk_thread_ioprio_class, OPT_STR, "") // rt realtime be best effort idle
 OPTION(osd_disk_thread_ioprio_priority, OPT_INT, -1) // 0-7
 OPTION(osd_recovery_threads, OPT_INT, 1)
+OPTION(osd_load_pgs_threads, OPT_INT, 4)    // read pg info/log in parallel on startup; <= 1 == serial
 OPTION(osd_recover_clone_overlap, OPT_BOOL, true)   // preserve clone_overlap during recovery/migration
 OPTION(osd_op_num_threads_per_shard, OPT_INT, 2)
 OPTION(osd_op_num_shards, OPT_INT, 5)
@@ -983,6 +992,7 @@ OPTION(filestore_debug_inject_read_err, OPT_BOOL, false)
 
 OPTION(filestore_debug_omap_check, OPT_BOOL, 0) // Expensive debugging check on sync
 OPTION(filestore_omap_header_cache_size, OPT_INT, 1024)
+OPTION(filestore_omap_header_shards, OPT_INT, 8)  // split header cache and locks by object hash
 
 // Use omap for xattrs for attrs over
 // filestore_max_inline_xattr_size or
@@ -1037,6 +1047,7 @@ OPTION(filestore_commit_timeout, OPT_FLOAT, 600)
 OPTION(filestore_fiemap_threshold, OPT_INT, 4096)
 OPTION(filestore_merge_threshold, OPT_INT, 10)
 OPTION(filestore_split_multiple, OPT_INT, 2)
+OPTION(filestore_split_ahead_ratio, OPT_DOUBLE, .9)  // split subdirs in the background past this fraction of the split threshold; 0 to disable
 OPTION(filestore_update_to, OPT_INT, 1000)
 OPTION(filestore_blackhole, OPT_BOOL, false)     // drop any new transactions on the floor
 OPTION(filestore_fd_cache_size, OPT_INT, 128)    // FD lru size
@@ -1065,6 +1076,7 @@ OPTION(journal_replay_from, OPT_INT, 0)
 OPTION(journal_zero_on_create, OPT_BOOL, false)
 OPTION(journal_ignore_corruption, OPT_BOOL, false) // assume journal is not corrupt
 OPTION(journal_discard, OPT_BOOL, false) //using ssd disk as journal, whether support discard nouse journal-data.
+OPTION(journal_stripe_paths, OPT_STR, "") // extra journal files/devices to stripe entries across, along with osd_journal
 
 OPTION(rados_mon_op_timeout, OPT_DOUBLE, 0) // how many seconds to wait for a response from the monitor before returning an error from a rados operation. 0 means on limit.
 OPTION(rados_osd_op_timeout, OPT_DOUBLE, 0) // how many seconds to wait for a response from osds before returning an error from a rados operation. 0 means no limit.
@@ -1152,6 +1164,20 @@ OPTION(rgw_max_put_size, OPT_U64, 5ULL*1024*1024*1024)
  */
 OPTION(rgw_override_bucket_index_max_shards, OPT_U32, 0)
 
+/**
+ * Target number of objects per bucket index shard; used by
+ * 'radosgw-admin bucket reshard' to size the index when no shard count
+ * is given.
+ */
+OPTION(rgw_max_objs_per_shard, OPT_U32, 100000)
+
+/**
+ * Index updates refused by a bucket index shard that is being resharded
+ * are retried at this interval, for up to rgw_reshard_max_wait_sec.
+ */
+OPTION(rgw_reshard_retry_interval_msec, OPT_INT, 1000)
+OPTION(rgw_reshard_max_wait_sec, OPT_INT, 600)
+
 /**
  * Represents the maximum AIO pending requests for the bucket index object shards.
  */
@@ -1167,6 +1193,11 @@ OPTION(rgw_data, OPT_STR, "/var/lib/ceph/radosgw/$cluster-$id")
 OPTION(rgw_enable_apis, OPT_STR, "s3, s3website, swift, swift_auth, admin")
 OPTION(rgw_cache_enabled, OPT_BOOL, true)   // rgw cache enabled
 OPTION(rgw_cache_lru_size, OPT_INT, 10000)   // num of entries in rgw cache
+OPTION(rgw_cache_num_shards, OPT_INT, 16)   // rgw cache is split in this many independently locked shards
+OPTION(rgw_data_cache_size, OPT_U64, 0)   // bytes of object data cached in memory, 0 disables the data cache
+OPTION(rgw_data_cache_max_obj_size, OPT_U64, 1024*1024)   // larger objects are not put in the data cache
+OPTION(rgw_data_cache_path, OPT_STR, "")   // directory for data cache entries evicted from memory
+OPTION(rgw_data_cache_path_size, OPT_U64, 10ull << 30)   // bytes of object data cached under rgw_data_cache_path
 OPTION(rgw_socket_path, OPT_STR, "")   // path to unix domain socket, if not specified, rgw will not run as external fcgi
 OPTION(rgw_host, OPT_STR, "")  // host for radosgw, can be an IP, default is 0.0.0.0
 OPTION(rgw_port, OPT_STR, "")  // port to listen, format as "8080" "5000", if not specified, rgw will not run external fcgi
@@ -1249,6 +1280,8 @@ OPTION(rgw_gc_max_objs, OPT_INT, 32)
 OPTION(rgw_gc_obj_min_wait, OPT_INT, 2 * 3600)    // wait time before object may be handled by gc
 OPTION(rgw_gc_processor_max_time, OPT_INT, 3600)  // total run time for a single gc processor work
 OPTION(rgw_gc_processor_period, OPT_INT, 3600)  // gc processor cycle time
+OPTION(rgw_gc_processor_threads, OPT_INT, 2)  // gc workers, each processing its own share of the gc objects
+OPTION(rgw_gc_max_concurrent_io, OPT_INT, 16)  // max concurrent tail object removals per gc worker
 OPTION(rgw_s3_success_create_obj_status, OPT_INT, 0) // alternative success status response for create-obj (0 - default)
 OPTION(rgw_resolve_cname, OPT_BOOL, false)  // should rgw try to resolve hostname as a dns cname record
 OPTION(rgw_obj_stripe_size, OPT_INT, 4 << 20)
@@ -1265,6 +1298,7 @@ OPTION(rgw_opstate_ratelimit_sec, OPT_INT, 30) // min time between opstate updat
 OPTION(rgw_curl_wait_timeout_ms, OPT_INT, 1000) // timeout for certain curl calls
 OPTION(rgw_copy_obj_progress, OPT_BOOL, true) // should dump progress during long copy operations?
 OPTION(rgw_copy_obj_progress_every_bytes, OPT_INT, 1024 * 1024) // min bytes between copy progress output
+OPTION(rgw_copy_obj_max_aio, OPT_U32, 16) // max concurrent rados ops when copying an object within the cluster
 
 OPTION(rgw_data_log_window, OPT_INT, 30) // data log entries window (in seconds)
 OPTION(rgw_data_log_changes_size, OPT_INT, 1000) // number of in-memory entries to hold for data changes log
@@ -500,6 +500,7 @@ void CrushTester::check_overlapped_rules() const
 
 int CrushTester::test()
 {
+  int ret = 0;
   if (min_rule < 0 || max_rule < 0) {
     min_rule = 0;
     max_rule = crush.get_max_rules() - 1;
@@ -633,6 +634,16 @@ int CrushTester::test()
         // create a vector to hold placement results temporarily 
         vector<int> temporary_per ( per.size() );
 
+        // map the whole batch through the batch api so that each
+        // scalar mapping below can be cross-checked against it
+        vector<vector<int> > batch_out;
+        if (use_crush && check_batch) {
+          vector<int> xs;
+          for (int x = batch_min; x <= batch_max; x++)
+            xs.push_back(x);
+          crush.do_rule_batch(r, xs, batch_out, nr, weight);
+        }
+
         for (int x = batch_min; x <= batch_max; x++) {
           // create a vector to hold the results of a CRUSH placement or RNG simulation
           vector<int> out;
@@ -641,6 +652,12 @@ int CrushTester::test()
             if (output_mappings)
 	      err << "CRUSH"; // prepend CRUSH to placement output
             crush.do_rule(r, x, out, nr, weight);
+            if (check_batch && batch_out[x - batch_min] != out) {
+              err << "batch mapping mismatch rule " << r << " x " << x
+                  << " num_rep " << nr << " scalar " << out
+                  << " batch " << batch_out[x - batch_min] << std::endl;
+              ret = -EINVAL;
+            }
           } else {
             if (output_mappings)
 	      err << "RNG"; // prepend RNG to placement output to denote simulation
@@ -746,5 +763,5 @@ int CrushTester::test()
     crush.stop_choose_profile();
   }
 
-  return 0;
+  return ret;
 }
@@ -34,6 +34,7 @@ class CrushTester {
 
   bool output_data_file;
   bool output_csv;
+  bool check_batch;
 
   string output_data_file_name;
 
@@ -184,6 +185,7 @@ public:
       output_choose_tries(false),
       output_data_file(false),
       output_csv(false),
+      check_batch(false),
       output_data_file_name("")
 
   { }
@@ -251,6 +253,12 @@ public:
     return output_choose_tries;
   }
 
+  void set_check_batch(bool b) {
+    check_batch = b;
+  }
+  bool get_check_batch() const {
+    return check_batch;
+  }
   void set_batches(int b) {
     num_batches = b;
   }
@@ -1087,6 +1087,37 @@ public:
       out[i] = rawout[i];
   }
 
+  /**
+   * map a vector of inputs through a rule in one pass
+   *
+   * Equivalent to calling do_rule() for each element of @xs, but takes
+   * mapper_lock once and reuses scratch space across inputs.
+   *
+   * @param rule rule id
+   * @param xs inputs to map
+   * @param out [out] one mapping per input, in the same order as @xs
+   * @param maxout maximum result size per input
+   * @param weight device weight vector
+   */
+  void do_rule_batch(int rule, const vector<int>& xs,
+		     vector<vector<int> >& out, int maxout,
+		     const vector<__u32>& weight) const {
+    Mutex::Locker l(mapper_lock);
+    vector<int> rawout(xs.size() * maxout);
+    vector<int> lens(xs.size());
+    int scratch[maxout * 3];
+    out.resize(xs.size());
+    if (xs.empty())
+      return;
+    crush_do_rule_batch(crush, rule, &xs[0], xs.size(), &rawout[0], maxout,
+			&lens[0], &weight[0], weight.size(), scratch);
+    for (unsigned i = 0; i < xs.size(); ++i) {
+      int numrep = lens[i] < 0 ? 0 : lens[i];
+      out[i].assign(rawout.begin() + i * maxout,
+		    rawout.begin() + i * maxout + numrep);
+    }
+  }
+
   int read_from_file(const char *fn) {
     bufferlist bl;
     std::string error;
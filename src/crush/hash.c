@@ -4,6 +4,11 @@
 # include "hash.h"
 #endif
 
+#if !defined(__KERNEL__) && defined(__SSE2__)
+# include <emmintrin.h>
+# define CRUSH_HASH_SSE2 1
+#endif
+
 /*
  * Robert Jenkins' function for mixing 32-bit values
  * http://burtleburtle.net/bob/hash/evahash.html
@@ -58,6 +63,63 @@ static __u32 crush_hash32_rjenkins1_3(__u32 a, __u32 b, __u32 c)
 	return hash;
 }
 
+/*
+ * crush_hash32_rjenkins1_3 evaluated for a vector of b values with a
+ * and c held fixed.  This is the shape of the straw2 inner loop (x and
+ * r are constant, the item id varies), so the SSE2 path hashes four
+ * items per iteration.  Results are bit-identical to the scalar hash.
+ */
+#ifdef CRUSH_HASH_SSE2
+#define crush_hashmix_sse2(a, b, c) do {				\
+		a = _mm_sub_epi32(a, b); a = _mm_sub_epi32(a, c);	\
+		a = _mm_xor_si128(a, _mm_srli_epi32(c, 13));		\
+		b = _mm_sub_epi32(b, c); b = _mm_sub_epi32(b, a);	\
+		b = _mm_xor_si128(b, _mm_slli_epi32(a, 8));		\
+		c = _mm_sub_epi32(c, a); c = _mm_sub_epi32(c, b);	\
+		c = _mm_xor_si128(c, _mm_srli_epi32(b, 13));		\
+		a = _mm_sub_epi32(a, b); a = _mm_sub_epi32(a, c);	\
+		a = _mm_xor_si128(a, _mm_srli_epi32(c, 12));		\
+		b = _mm_sub_epi32(b, c); b = _mm_sub_epi32(b, a);	\
+		b = _mm_xor_si128(b, _mm_slli_epi32(a, 16));		\
+		c = _mm_sub_epi32(c, a); c = _mm_sub_epi32(c, b);	\
+		c = _mm_xor_si128(c, _mm_srli_epi32(b, 5));		\
+		a = _mm_sub_epi32(a, b); a = _mm_sub_epi32(a, c);	\
+		a = _mm_xor_si128(a, _mm_srli_epi32(c, 3));		\
+		b = _mm_sub_epi32(b, c); b = _mm_sub_epi32(b, a);	\
+		b = _mm_xor_si128(b, _mm_slli_epi32(a, 10));		\
+		c = _mm_sub_epi32(c, a); c = _mm_sub_epi32(c, b);	\
+		c = _mm_xor_si128(c, _mm_srli_epi32(b, 15));		\
+	} while (0)
+#endif
+
+static void crush_hash32_rjenkins1_3_multi(__u32 a, const __u32 *b,
+					   __u32 c, __u32 *out, int n)
+{
+	int i = 0;
+
+#ifdef CRUSH_HASH_SSE2
+	const __m128i va = _mm_set1_epi32(a);
+	const __m128i vc = _mm_set1_epi32(c);
+	const __m128i vseed = _mm_set1_epi32(crush_hash_seed ^ a ^ c);
+
+	for (; i + 4 <= n; i += 4) {
+		__m128i ta = va, tc = vc;
+		__m128i tb = _mm_loadu_si128((const __m128i *)(b + i));
+		__m128i hash = _mm_xor_si128(vseed, tb);
+		__m128i x = _mm_set1_epi32(231232);
+		__m128i y = _mm_set1_epi32(1232);
+		crush_hashmix_sse2(ta, tb, hash);
+		crush_hashmix_sse2(tc, x, hash);
+		crush_hashmix_sse2(y, ta, hash);
+		crush_hashmix_sse2(tb, x, hash);
+		crush_hashmix_sse2(y, tc, hash);
+		_mm_storeu_si128((__m128i *)(out + i), hash);
+	}
+#endif
+	for (; i < n; i++)
+		out[i] = crush_hash32_rjenkins1_3(a, b[i], c);
+}
+
 static __u32 crush_hash32_rjenkins1_4(__u32 a, __u32 b, __u32 c, __u32 d)
 {
 	__u32 hash = crush_hash_seed ^ a ^ b ^ c ^ d;
@@ -120,6 +182,22 @@ __u32 crush_hash32_3(int type, __u32 a, __u32 b, __u32 c)
 	}
 }
 
+void crush_hash32_3_multi(int type, __u32 a, const __u32 *b, __u32 c,
+			  __u32 *out, int n)
+{
+	int i;
+
+	switch (type) {
+	case CRUSH_HASH_RJENKINS1:
+		crush_hash32_rjenkins1_3_multi(a, b, c, out, n);
+		break;
+	default:
+		for (i = 0; i < n; i++)
+			out[i] = 0;
+		break;
+	}
+}
+
 __u32 crush_hash32_4(int type, __u32 a, __u32 b, __u32 c, __u32 d)
 {
 	switch (type) {
@@ -294,6 +294,12 @@ static __u64 crush_ln(unsigned int xin)
  *
  */
 
+/*
+ * number of item hashes computed per crush_hash32_3_multi call; sized so
+ * typical host and rack buckets are hashed in a single pass.
+ */
+#define CRUSH_STRAW2_HASH_BATCH 32
+
 static int bucket_straw2_choose(struct crush_bucket_straw2 *bucket,
 				int x, int r)
 {
@@ -301,12 +307,22 @@ static int bucket_straw2_choose(struct crush_bucket_straw2 *bucket,
 	unsigned int u;
 	unsigned int w;
 	__s64 ln, draw, high_draw = 0;
+	__u32 hashes[CRUSH_STRAW2_HASH_BATCH];
+	unsigned int batch_start = 0, batch_len = 0;
 
 	for (i = 0; i < bucket->h.size; i++) {
+		if (i == batch_start + batch_len) {
+			batch_start = i;
+			batch_len = bucket->h.size - i;
+			if (batch_len > CRUSH_STRAW2_HASH_BATCH)
+				batch_len = CRUSH_STRAW2_HASH_BATCH;
+			crush_hash32_3_multi(bucket->h.hash, x,
+					     (const __u32 *)&bucket->h.items[i],
+					     r, hashes, batch_len);
+		}
 		w = bucket->item_weights[i];
 		if (w) {
-			u = crush_hash32_3(bucket->h.hash, x,
-					   bucket->h.items[i], r);
+			u = hashes[i - batch_start];
 			u &= 0xffff;
 
 			/*
@@ -994,3 +1010,44 @@ int crush_do_rule(const struct crush_map *map,
 	}
 	return result_len;
 }
+
+/**
+ * crush_do_rule_batch - calculate mappings for a vector of inputs
+ * @map: the crush_map
+ * @ruleno: the rule id
+ * @x: vector of hash inputs
+ * @num_x: number of hash inputs
+ * @result: pointer to result matrix; must be >= num_x * result_max
+ * @result_max: maximum result size per input
+ * @result_len: vector of result sizes, one per input
+ * @weight: weight vector (for map leaves)
+ * @weight_max: size of weight vector
+ * @scratch: scratch vector for private use; must be >= 3 * result_max
+ *
+ * The mapping for x[i] is stored at result + i * result_max and is
+ * identical to what crush_do_rule would return for that input.  Each
+ * input is mapped by crush_do_rule, reusing the same scratch space; a
+ * bad or missing rule gives empty results for all inputs.
+ */
+int crush_do_rule_batch(const struct crush_map *map,
+			int ruleno, const int *x, int num_x,
+			int *result, int result_max, int *result_len,
+			const __u32 *weight, int weight_max,
+			int *scratch)
+{
+	int i;
+
+	if ((__u32)ruleno >= map->max_rules || !map->rules[ruleno]) {
+		dprintk(" bad ruleno %d\n", ruleno);
+		for (i = 0; i < num_x; i++)
+			result_len[i] = 0;
+		return 0;
+	}
+
+	for (i = 0; i < num_x; i++)
+		result_len[i] = crush_do_rule(map, ruleno, x[i],
+					      result + i * result_max,
+					      result_max, weight, weight_max,
+					      scratch);
+	return num_x;
+}
@@ -16,5 +16,11 @@ extern int crush_do_rule(const struct crush_map *map,
 			 int x, int *result, int result_max,
 			 const __u32 *weights, int weight_max,
 			 int *scratch);
+extern int crush_do_rule_batch(const struct crush_map *map,
+			       int ruleno,
+			       const int *x, int num_x,
+			       int *result, int result_max, int *result_len,
+			       const __u32 *weights, int weight_max,
+			       int *scratch);
 
 #endif
@@ -351,9 +351,53 @@ namespace buffer CEPH_BUFFER_API {
       void copy_in(unsigned len, const list& otherl);
     };
 
+    /*
+     * appends through a pointer into space reserved up front, so that
+     * each append is a plain memcpy.  the data is added to the list when
+     * the appender goes away; nothing else may be appended to the list
+     * in the meantime.
+     */
+    class CEPH_BUFFER_API contiguous_appender {
+      list *pbl;
+      char *start;
+      char *pos;
+      char *end;
+
+      contiguous_appender(list *l, char *s, size_t len)
+	: pbl(l), start(s), pos(s), end(s + len) {}
+      friend class list;
+
+    public:
+      contiguous_appender(contiguous_appender&& other)
+	: pbl(other.pbl), start(other.start), pos(other.pos), end(other.end) {
+	other.pbl = 0;
+      }
+      contiguous_appender(const contiguous_appender& other) = delete;
+      ~contiguous_appender() {
+	if (pbl)
+	  pbl->commit_contiguous(pos - start);
+      }
+
+      void append(const char *p, size_t l) {
+	assert(pos + l <= end);
+	memcpy(pos, p, l);
+	pos += l;
+      }
+      /// reserve l bytes to fill in through the returned pointer
+      char *get_pos_add(size_t l) {
+	assert(pos + l <= end);
+	char *r = pos;
+	pos += l;
+	return r;
+      }
+      /// bytes appended so far
+      size_t length() const { return pos - start; }
+    };
+
   private:
     mutable iterator last_p;
     int zero_copy_to_fd(int fd) const;
+    void commit_contiguous(unsigned len);
 
   public:
     // cons/des
@@ -527,6 +571,9 @@ namespace buffer CEPH_BUFFER_API {
     void append(const list& bl);
     void append(std::istream& in);
     void append_zero(unsigned len);
+
+    /// get an appender for up to len bytes, contiguous in memory
+    contiguous_appender get_contiguous_appender(size_t len);
     
     /*
      * get a char
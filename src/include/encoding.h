@@ -52,6 +52,11 @@ inline void encode_raw(const T& t, bufferlist& bl)
   bl.append((char*)&t, sizeof(t));
 }
 template<class T>
+inline void encode_raw(const T& t, bufferlist::contiguous_appender& app)
+{
+  app.append((const char*)&t, sizeof(t));
+}
+template<class T>
 inline void decode_raw(T& t, bufferlist::iterator &p)
 {
   p.copy(sizeof(t), (char*)&t);
@@ -59,6 +64,7 @@ inline void decode_raw(T& t, bufferlist::iterator &p)
 
 #define WRITE_RAW_ENCODER(type)						\
   inline void encode(const type &v, bufferlist& bl, uint64_t features=0) { encode_raw(v, bl); } \
+  inline void encode(const type &v, bufferlist::contiguous_appender& app) { encode_raw(v, app); } \
   inline void decode(type &v, bufferlist::iterator& p) { __ASSERT_FUNCTION decode_raw(v, p); }
 
 WRITE_RAW_ENCODER(__u8)
@@ -94,6 +100,11 @@ inline void decode(bool &v, bufferlist::iterator& p) {
     e = v;                                                              \
     encode_raw(e, bl);							\
   }									\
+  inline void encode(type v, bufferlist::contiguous_appender& app) {	\
+    ceph_##etype e;							\
+    e = v;								\
+    encode_raw(e, app);							\
+  }									\
   inline void decode(type &v, bufferlist::iterator& p) {		\
     ceph_##etype e;							\
     decode_raw(e, p);							\
@@ -165,9 +176,10 @@ WRITE_INTTYPE_ENCODER(int16_t, le16)
 inline void encode(const std::string& s, bufferlist& bl, uint64_t features=0)
 {
   __u32 len = s.length();
-  encode(len, bl);
-  if (len)
-    bl.append(s.data(), len);
+  bufferlist::contiguous_appender app =
+    bl.get_contiguous_appender(sizeof(ceph_le32) + len);
+  encode(len, app);
+  app.append(s.data(), len);
 }
 inline void decode(std::string& s, bufferlist::iterator& p)
 {
@@ -836,15 +848,19 @@ inline void decode(std::deque<T>& ls, bufferlist::iterator& p)
  */
 #define ENCODE_START(v, compat, bl)			     \
   __u8 struct_v = v, struct_compat = compat;		     \
-  ::encode(struct_v, (bl));				     \
-  ::encode(struct_compat, (bl));			     \
-  buffer::list::iterator struct_compat_it = (bl).end();	     \
-  struct_compat_it.advance(-1);				     \
   ceph_le32 struct_len;				             \
   struct_len = 0;                                            \
-  ::encode(struct_len, (bl));				     \
-  buffer::list::iterator struct_len_it = (bl).end();	     \
-  struct_len_it.advance(-4);				     \
+  {							     \
+    buffer::list::contiguous_appender struct_app =	     \
+      (bl).get_contiguous_appender(2 + sizeof(struct_len));  \
+    ::encode(struct_v, struct_app);			     \
+    ::encode(struct_compat, struct_app);		     \
+    ::encode(struct_len, struct_app);			     \
+  }							     \
+  buffer::list::iterator struct_compat_it = (bl).end();	     \
+  struct_compat_it.advance(-5);				     \
+  buffer::list::iterator struct_len_it = struct_compat_it;   \
+  struct_len_it.advance(1);				     \
   do {
 
 /**
@@ -227,6 +227,7 @@ public:
     versionlock(this, &versionlock_type) {
     g_num_dn++;
     g_num_dna++;
+    g_mem_dn += sizeof(CDentry) + name.length();
   }
   CDentry(const std::string& n, __u32 h, inodeno_t ino, unsigned char dt,
 	  snapid_t f, snapid_t l) :
@@ -240,6 +241,7 @@ public:
     versionlock(this, &versionlock_type) {
     g_num_dn++;
     g_num_dna++;
+    g_mem_dn += sizeof(CDentry) + name.length();
     linkage.remote_ino = ino;
     linkage.remote_d_type = dt;
   }
@@ -248,6 +250,7 @@ public:
     assert(!item_scrub.is_on_list());
     g_num_dn--;
     g_num_dns++;
+    g_mem_dn -= sizeof(CDentry) + name.length();
   }
 
 
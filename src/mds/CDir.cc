@@ -202,6 +202,7 @@ CDir::CDir(CInode *in, frag_t fg, MDCache *mdcache, bool auth) :
 {
   g_num_dir++;
   g_num_dira++;
+  g_mem_dir += sizeof(CDir);
 
   state = STATE_INITIAL;
 
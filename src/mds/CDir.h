@@ -397,6 +397,7 @@ protected:
     remove_bloom();
     g_num_dir--;
     g_num_dirs++;
+    g_mem_dir -= sizeof(CDir);
   }
 
   const scrub_info_t *scrub_info() const {
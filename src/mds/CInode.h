@@ -646,12 +646,14 @@ public:
   {
     g_num_ino++;
     g_num_inoa++;
+    g_mem_ino += sizeof(CInode);
     state = 0;  
     if (auth) state_set(STATE_AUTH);
   }
   ~CInode() {
     g_num_ino--;
     g_num_inos++;
+    g_mem_ino -= sizeof(CInode);
     close_dirfrags();
     close_snaprealm();
     clear_file_locks();
@@ -127,6 +127,11 @@ long g_num_dirs = 0;
 long g_num_dns = 0;
 long g_num_caps = 0;
 
+long g_mem_ino = 0;
+long g_mem_dir = 0;
+long g_mem_dn = 0;
+long g_mem_cap = 0;
+
 set<int> SimpleLock::empty_gather_set;
 
 
@@ -208,7 +213,7 @@ MDCache::MDCache(MDSRank *m) :
   cap_imports_num_opening = 0;
 
   opening_root = open = false;
-  lru.lru_set_max(g_conf->mds_cache_size);
+  lru.lru_set_max(cache_limit());
   lru.lru_set_midpoint(g_conf->mds_cache_mid);
 
   decayrate.set_halflife(g_conf->mds_decay_halflife);
@@ -234,9 +239,53 @@ MDCache::~MDCache()
 
 
 
+int MDCache::cache_limit()
+{
+  uint64_t limit = g_conf->mds_cache_memory_limit;
+  if (!limit)
+    return g_conf->mds_cache_size;
+
+  uint64_t used = cache_memory_used();
+  uint64_t num = lru.lru_get_size();
+  if (!used || !num)
+    return INT_MAX;  // nothing to go by yet; the count no longer applies
+  double max = (double)num * (double)limit / (double)used;
+  if (max > INT_MAX)
+    return INT_MAX;
+  return MAX(1, (int)max);
+}
+
+void MDCache::cache_status(Formatter *f)
+{
+  f->open_object_section("cache");
+  f->dump_unsigned("memory_limit", g_conf->mds_cache_memory_limit);
+  f->dump_unsigned("memory_used", cache_memory_used());
+  f->dump_int("dentry_limit", cache_limit());
+  f->dump_unsigned("dentries_in_lru", lru.lru_get_size());
+
+  f->open_object_section("inodes");
+  f->dump_int("items", g_num_ino);
+  f->dump_int("bytes", g_mem_ino);
+  f->close_section();
+  f->open_object_section("dirfrags");
+  f->dump_int("items", g_num_dir);
+  f->dump_int("bytes", g_mem_dir);
+  f->close_section();
+  f->open_object_section("dentries");
+  f->dump_int("items", g_num_dn);
+  f->dump_int("bytes", g_mem_dn);
+  f->close_section();
+  f->open_object_section("caps");
+  f->dump_int("items", g_num_cap);
+  f->dump_int("bytes", g_mem_cap);
+  f->close_section();
+
+  f->close_section();
+}
+
 void MDCache::log_stat()
 {
-  mds->logger->set(l_mds_inode_max, g_conf->mds_cache_size);
+  mds->logger->set(l_mds_inode_max, cache_limit());
   mds->logger->set(l_mds_inodes, lru.lru_get_size());
   mds->logger->set(l_mds_inodes_pinned, lru.lru_get_num_pinned());
   mds->logger->set(l_mds_inodes_top, lru.lru_get_top());
@@ -6263,9 +6312,12 @@ bool MDCache::trim(int max, int count)
     if (max <= 0)
       max = 1;
   } else if (max < 0) {
-    max = g_conf->mds_cache_size;
+    max = cache_limit();
     if (max <= 0)
       return false;
+    // the top/bottom split follows the limit, which moves with the
+    // average dentry size under mds_cache_memory_limit
+    lru.lru_set_max(max);
   }
   dout(7) << "trim max=" << max << "  cur=" << lru.lru_get_size() << dendl;
 
@@ -7236,8 +7288,9 @@ void MDCache::check_memory_usage()
   mds->mlogger->set(l_mdm_heap, last.get_heap());
   mds->mlogger->set(l_mdm_malloc, last.malloc);
 
-  if (num_inodes_with_caps > g_conf->mds_cache_size) {
-    float ratio = (float)g_conf->mds_cache_size * .9 / (float)num_inodes_with_caps;
+  int limit = cache_limit();
+  if (num_inodes_with_caps > limit) {
+    float ratio = (float)limit * .9 / (float)num_inodes_with_caps;
     if (ratio < 1.0)
       mds->server->recall_client_state(ratio);
   }
@@ -8935,6 +8988,9 @@ void MDCache::request_cleanup(MDRequestRef& mdr)
 {
   dout(15) << "request_cleanup " << *mdr << dendl;
 
+  if (mdr->batch_key.first)
+    mds->server->batch_getattr_cleanup(mdr);
+
   if (mdr->has_more()) {
     if (mdr->more()->is_ambiguous_auth)
       mdr->clear_ambiguous_auth();
@@ -11966,4 +12022,8 @@ void MDCache::handle_conf_change(const struct md_config_t *conf,
       || changed.count("mds_max_purge_ops_per_pg")) {
     stray_manager.update_op_limit();
   }
+  if (changed.count("mds_cache_size")
+      || changed.count("mds_cache_memory_limit")) {
+    lru.lru_set_max(cache_limit());
+  }
 }
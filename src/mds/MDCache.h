@@ -643,6 +643,18 @@ public:
   void set_cache_size(size_t max) { lru.lru_set_max(max); }
   size_t get_cache_size() { return lru.lru_get_size(); }
 
+  /// approximate bytes used by cached inodes, dirfrags, dentries and caps
+  static uint64_t cache_memory_used() {
+    return g_mem_ino + g_mem_dir + g_mem_dn + g_mem_cap;
+  }
+  /**
+   * Number of dentries the cache should hold: mds_cache_size, or, if
+   * mds_cache_memory_limit is set, as many as fit in that many bytes
+   * at the current average size per dentry.
+   */
+  int cache_limit();
+  void cache_status(Formatter *f);
+
   // trimming
   bool trim(int max=-1, int count=-1);   // trim cache
   bool trim_dentry(CDentry *dn, map<mds_rank_t, MCacheExpire*>& expiremap);
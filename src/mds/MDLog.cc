@@ -74,6 +74,11 @@ void MDLog::create_logger()
   plb.add_u64(l_mdl_wrpos, "wrpos", "Journaler  write position");
   plb.add_u64(l_mdl_rdpos, "rdpos", "Journaler  read position");
   plb.add_u64(l_mdl_jlat, "jlat", "Journaler flush latency");
+  plb.add_u64_avg(l_mdl_evbatch, "evbatch", "Events per journal submission");
+  plb.add_u64_avg(l_mdl_batchbytes, "batchbytes",
+      "Bytes per journal submission");
+  plb.add_u64_counter(l_mdl_throttle, "throttle",
+      "Submissions delayed by mds_log_max_outstanding_bytes");
 
   // logger
   logger = plb.create_perf_counters();
@@ -331,22 +336,29 @@ class C_MDL_Flushed : public MDSIOContextBase {
   MDLog *mdlog;
   MDSRank *get_mds() {return mdlog->mds;}
   uint64_t flushed_to;
-  MDSInternalContextBase *wrapped;
+  list<MDSInternalContextBase*> wrapped;
 
   void finish(int r) {
-    if (wrapped) {
-      wrapped->complete(r);
-    }
+    finish_contexts(g_ceph_context, wrapped, r);
 
     mdlog->submit_mutex.Lock();
     assert(mdlog->safe_pos <= flushed_to);
     mdlog->safe_pos = flushed_to;
+    // the submit thread may be waiting for outstanding bytes to drop
+    mdlog->submit_cond.Signal();
     mdlog->submit_mutex.Unlock();
   }
 
   public:
   C_MDL_Flushed(MDLog *m, uint64_t ft, MDSInternalContextBase *w)
-    : mdlog(m), flushed_to(ft), wrapped(w) {}
+    : mdlog(m), flushed_to(ft) {
+    if (w)
+      wrapped.push_back(w);
+  }
+  C_MDL_Flushed(MDLog *m, uint64_t ft, list<MDSInternalContextBase*>& ls)
+    : mdlog(m), flushed_to(ft) {
+    wrapped.swap(ls);
+  }
 };
 
 void MDLog::_submit_thread()
@@ -372,53 +384,88 @@ void MDLog::_submit_thread()
       continue;
     }
 
-    PendingEvent data = it->second.front();
-    it->second.pop_front();
-
-    submit_mutex.Unlock();
-
-    if (data.le) {
-      LogEvent *le = data.le;
-      LogSegment *ls = le->_segment;
-      // encode it, with event type
-      bufferlist bl;
-      le->encode_with_header(bl);
-
-      uint64_t write_pos = journaler->get_write_pos();
-
-      le->set_start_off(write_pos);
-      if (le->get_type() == EVENT_SUBTREEMAP)
-	ls->offset = write_pos;
-
-      dout(5) << "_submit_thread " << write_pos << "~" << bl.length()
-	      << " : " << *le << dendl;
+    // don't run too far ahead of what is safe
+    uint64_t max_outstanding = g_conf->mds_log_max_outstanding_bytes;
+    if (max_outstanding &&
+	journaler->get_write_pos() > safe_pos + max_outstanding) {
+      dout(10) << "_submit_thread " << journaler->get_write_pos() - safe_pos
+	       << " bytes outstanding, waiting" << dendl;
+      if (logger)
+	logger->inc(l_mdl_throttle);
+      submit_mutex.Unlock();
+      journaler->flush();
+      submit_mutex.Lock();
+      unflushed = 0;
+      if (journaler->get_write_pos() > safe_pos + max_outstanding)
+	submit_cond.Wait(submit_mutex);
+      continue;
+    }
 
-      // journal it.
-      const uint64_t new_write_pos = journaler->append_entry(bl);  // bl is destroyed.
-      ls->end = new_write_pos;
+    // take as many of this segment's events as we may in one go; they
+    // are appended together and share a single flush waiter.
+    list<PendingEvent> batch;
+    unsigned max_events = MAX(1, g_conf->mds_log_max_batch_events);
+    while (!it->second.empty() && batch.size() < max_events) {
+      batch.push_back(it->second.front());
+      it->second.pop_front();
+    }
 
-      journaler->wait_for_flush(new C_MDL_Flushed(
-            this, new_write_pos, data.fin));
+    submit_mutex.Unlock();
 
+    list<MDSInternalContextBase*> fins;
+    bool do_flush = false;
+    int events = 0;
+    uint64_t start_pos = journaler->get_write_pos();
+    for (list<PendingEvent>::iterator p = batch.begin(); p != batch.end(); ++p) {
+      PendingEvent& data = *p;
+      if (data.le) {
+	LogEvent *le = data.le;
+	LogSegment *ls = le->_segment;
+	// encode it, with event type
+	bufferlist bl;
+	le->encode_with_header(bl);
+
+	uint64_t write_pos = journaler->get_write_pos();
+
+	le->set_start_off(write_pos);
+	if (le->get_type() == EVENT_SUBTREEMAP)
+	  ls->offset = write_pos;
+
+	dout(5) << "_submit_thread " << write_pos << "~" << bl.length()
+		<< " : " << *le << dendl;
+
+	// journal it.
+	const uint64_t new_write_pos = journaler->append_entry(bl);  // bl is destroyed.
+	ls->end = new_write_pos;
+
+	if (logger)
+	  logger->set(l_mdl_wrpos, ls->end);
+
+	delete le;
+	events++;
+      }
+      if (data.fin)
+	fins.push_back(data.fin);
       if (data.flush)
-	journaler->flush();
+	do_flush = true;
+    }
 
-      if (logger)
-	logger->set(l_mdl_wrpos, ls->end);
+    uint64_t end_pos = journaler->get_write_pos();
+    journaler->wait_for_flush(new C_MDL_Flushed(this, end_pos, fins));
+    if (do_flush)
+      journaler->flush();
 
-      delete le;
-    } else {
-      journaler->wait_for_flush(new C_MDL_Flushed(
-            this, journaler->get_write_pos(), data.fin));
-      if (data.flush)
-	journaler->flush();
+    if (logger && events) {
+      logger->inc(l_mdl_evbatch, events);
+      logger->inc(l_mdl_batchbytes, end_pos - start_pos);
     }
 
     submit_mutex.Lock();
-    if (data.flush)
+    // the flush covers the whole batch
+    if (do_flush)
       unflushed = 0;
-    else if (data.le)
-      unflushed++;
+    else
+      unflushed += events;
   }
 
   submit_mutex.Unlock();
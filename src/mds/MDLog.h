@@ -34,6 +34,9 @@ enum {
   l_mdl_wrpos,
   l_mdl_rdpos,
   l_mdl_jlat,
+  l_mdl_evbatch,
+  l_mdl_batchbytes,
+  l_mdl_throttle,
   l_mdl_last,
 };
 
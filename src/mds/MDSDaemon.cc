@@ -273,6 +273,11 @@ void MDSDaemon::set_up_admin_socket()
                                      asok_hook,
                                      "dump metadata cache (optionally to a file)");
   assert(r == 0);
+  r = admin_socket->register_command("cache status",
+                                     "cache status",
+                                     asok_hook,
+                                     "show cache status");
+  assert(r == 0);
   r = admin_socket->register_command("session evict",
 				     "session evict name=client_id,type=CephString",
 				     asok_hook,
@@ -336,6 +341,7 @@ void MDSDaemon::clean_up_admin_socket()
   admin_socket->unregister_command("dump_historic_ops");
   admin_socket->unregister_command("scrub_path");
   admin_socket->unregister_command("flush_path");
+  admin_socket->unregister_command("cache status");
   admin_socket->unregister_command("session evict");
   admin_socket->unregister_command("session ls");
   admin_socket->unregister_command("flush journal");
@@ -359,6 +365,9 @@ const char** MDSDaemon::get_tracked_conf_keys() const
     // StrayManager
     "mds_max_purge_ops",
     "mds_max_purge_ops_per_pg",
+    // MDCache
+    "mds_cache_size",
+    "mds_cache_memory_limit",
     "clog_to_graylog",
     "clog_to_graylog_host",
     "clog_to_graylog_port",
@@ -524,6 +524,10 @@ bool MDSRank::_dispatch(Message *m, bool new_msg)
     mlogger->set(l_mdm_dir, g_num_dir);
     mlogger->set(l_mdm_dn, g_num_dn);
     mlogger->set(l_mdm_cap, g_num_cap);
+    mlogger->set(l_mdm_ino_bytes, g_mem_ino);
+    mlogger->set(l_mdm_dir_bytes, g_mem_dir);
+    mlogger->set(l_mdm_dn_bytes, g_mem_dn);
+    mlogger->set(l_mdm_cap_bytes, g_mem_cap);
 
     mlogger->inc(l_mdm_inoa, g_num_inoa);  g_num_inoa = 0;
     mlogger->inc(l_mdm_inos, g_num_inos);  g_num_inos = 0;
@@ -1769,6 +1773,9 @@ bool MDSRankDispatcher::handle_asok_command(
     } else {
       mdcache->dump_cache(path);
     }
+  } else if (command == "cache status") {
+    Mutex::Locker l(mds_lock);
+    mdcache->cache_status(f);
   } else if (command == "force_readonly") {
     mds_lock.Lock();
     mdcache->force_readonly();
@@ -2364,6 +2371,10 @@ void MDSRank::create_logger()
     mdm_plb.add_u64(l_mdm_heap, "heap", "Heap size");
     mdm_plb.add_u64(l_mdm_malloc, "malloc", "Malloc size");
     mdm_plb.add_u64(l_mdm_buf, "buf", "Buffer size");
+    mdm_plb.add_u64(l_mdm_ino_bytes, "ino_bytes", "Approximate inode memory");
+    mdm_plb.add_u64(l_mdm_dir_bytes, "dir_bytes", "Approximate directory memory");
+    mdm_plb.add_u64(l_mdm_dn_bytes, "dn_bytes", "Approximate dentry memory");
+    mdm_plb.add_u64(l_mdm_cap_bytes, "cap_bytes", "Approximate capability memory");
     mlogger = mdm_plb.create_perf_counters();
     g_ceph_context->get_perfcounters_collection()->add(mlogger);
   }
@@ -85,6 +85,10 @@ enum {
   l_mdm_heap,
   l_mdm_malloc,
   l_mdm_buf,
+  l_mdm_ino_bytes,
+  l_mdm_dir_bytes,
+  l_mdm_dn_bytes,
+  l_mdm_cap_bytes,
   l_mdm_last,
 };
 
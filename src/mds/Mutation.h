@@ -201,6 +201,8 @@ struct MDRequestImpl : public MutationImpl, public TrackedOp {
 
   int snap_caps;
   int getattr_caps;       ///< caps requested by getattr
+  /// (object, mask) we are answering for batched getattr/lookups, if any
+  pair<MDSCacheObject*, int> batch_key;
   bool did_early_reply;
   bool o_trunc;           ///< request is an O_TRUNC mutation
   bool has_completed;     ///< request has already completed
@@ -305,6 +307,7 @@ struct MDRequestImpl : public MutationImpl, public TrackedOp {
     client_request(params.client_req), straydn(NULL), snapid(CEPH_NOSNAP),
     tracei(NULL), tracedn(NULL), alloc_ino(0), used_prealloc_ino(0),
     snap_caps(0), getattr_caps(0),
+    batch_key((MDSCacheObject*)NULL, 0),
     did_early_reply(false), o_trunc(false), has_completed(false),
     slave_request(NULL), internal_op(params.internal_op), internal_op_finish(NULL),
     internal_op_private(NULL),
@@ -897,7 +897,7 @@ void Server::recover_filelocks(CInode *in, bufferlist locks, int64_t client)
  */
 void Server::recall_client_state(float ratio)
 {
-  int max_caps_per_client = (int)(g_conf->mds_cache_size * .8);
+  int max_caps_per_client = (int)(mdcache->cache_limit() * .8);
   int min_caps_per_client = 100;
 
   dout(10) << "recall_client_state " << ratio
@@ -1017,6 +1017,9 @@ void Server::submit_mdlog_entry(LogEvent *le, MDSInternalContextBase *fin, MDReq
  */
 void Server::respond_to_request(MDRequestRef& mdr, int r)
 {
+  if (mdr->batch_key.first)
+    batch_getattr_respond(mdr, r);
+
   if (mdr->client_request) {
     reply_client_request(mdr, new MClientReply(mdr->client_request, r));
   } else if (mdr->internal_op > -1) {
@@ -2706,6 +2709,29 @@ void Server::handle_client_getattr(MDRequestRef& mdr, bool is_lookup)
   if ((mask & CEPH_CAP_FILE_SHARED) && (issued & CEPH_CAP_FILE_EXCL) == 0) rdlocks.insert(&ref->filelock);
   if ((mask & CEPH_CAP_XATTR_SHARED) && (issued & CEPH_CAP_XATTR_EXCL) == 0) rdlocks.insert(&ref->xattrlock);
 
+  // if an identical request is already waiting for these locks, wait
+  // for its answer instead
+  if (mdr->snapid == CEPH_NOSNAP && !mdr->batch_key.first) {
+    MDSCacheObject *obj = ref;
+    if (is_lookup)
+      obj = mdr->dn[0].back();
+    pair<MDSCacheObject*, int> key(obj, mask);
+    map<pair<MDSCacheObject*, int>, list<MDRequestRef> >::iterator p =
+      batched_getattrs.find(key);
+    if (p != batched_getattrs.end()) {
+      dout(10) << "batching " << *req << " with an identical request" << dendl;
+      p->second.push_back(mdr);
+      return;
+    }
+    // we can only answer for others if we rdlock everything in mask
+    int excl = CEPH_CAP_LINK_EXCL | CEPH_CAP_AUTH_EXCL | CEPH_CAP_FILE_EXCL |
+      CEPH_CAP_XATTR_EXCL;
+    if ((issued & excl) == 0) {
+      batched_getattrs[key];
+      mdr->batch_key = key;
+    }
+  }
+
   if (!mds->locker->acquire_locks(mdr, rdlocks, wrlocks, xlocks))
     return;
 
@@ -2727,6 +2753,60 @@ void Server::handle_client_getattr(MDRequestRef& mdr, bool is_lookup)
   respond_to_request(mdr, 0);
 }
 
+void Server::batch_getattr_respond(MDRequestRef& mdr, int r)
+{
+  map<pair<MDSCacheObject*, int>, list<MDRequestRef> >::iterator p =
+    batched_getattrs.find(mdr->batch_key);
+  assert(p != batched_getattrs.end());
+  MDSCacheObject *obj = mdr->batch_key.first;
+  int mask = mdr->batch_key.second;
+  list<MDRequestRef> ls;
+  ls.swap(p->second);
+  batched_getattrs.erase(p);
+  mdr->batch_key = make_pair((MDSCacheObject*)NULL, 0);
+
+  // only answer for the others if mdr got an answer for what they asked
+  CInode *in = mdr->tracei;
+  MDSCacheObject *answered = in;
+  if (mdr->tracedn)
+    answered = mdr->tracedn;
+  for (list<MDRequestRef>::iterator q = ls.begin(); q != ls.end(); ++q) {
+    MDRequestRef& b = *q;
+    if (b->killed)
+      continue;
+    if (r != 0 || !in || answered != obj) {
+      // let it find its own answer
+      mds->queue_waiter(new C_MDS_RetryRequest(mdcache, b));
+      continue;
+    }
+    if (!check_access(b, in, MAY_READ))
+      continue;
+    dout(10) << "reply to batched stat on " << *b->client_request << dendl;
+    b->getattr_caps = mask;
+    mds->balancer->hit_inode(ceph_clock_now(g_ceph_context), in, META_POP_IRD,
+			     b->client_request->get_source().num());
+    b->tracei = in;
+    if (mdr->tracedn)
+      b->tracedn = b->dn[0].back();
+    respond_to_request(b, 0);
+  }
+}
+
+void Server::batch_getattr_cleanup(MDRequestRef& mdr)
+{
+  // mdr went away without an answer; retry the requests waiting on it
+  map<pair<MDSCacheObject*, int>, list<MDRequestRef> >::iterator p =
+    batched_getattrs.find(mdr->batch_key);
+  assert(p != batched_getattrs.end());
+  for (list<MDRequestRef>::iterator q = p->second.begin();
+       q != p->second.end();
+       ++q)
+    if (!(*q)->killed)
+      mds->queue_waiter(new C_MDS_RetryRequest(mdcache, *q));
+  batched_getattrs.erase(p);
+  mdr->batch_key = make_pair((MDSCacheObject*)NULL, 0);
+}
+
 struct C_MDS_LookupIno2 : public ServerContext {
   MDRequestRef mdr;
   C_MDS_LookupIno2(Server *s, MDRequestRef& r) : ServerContext(s), mdr(r) {}
@@ -3203,6 +3283,11 @@ void Server::handle_client_openc(MDRequestRef& mdr)
     dout(10) << "adding ino to reply to indicate inode was created" << dendl;
     // add the file created flag onto the reply if create_flags features is supported
     ::encode(in->inode.ino, mdr->reply_extra_bl);
+    if (mdr->client_request->get_connection()->has_feature(CEPH_FEATURE_MDS_DELEG_INO)) {
+      // the inos the session still holds for its next creates; a client may
+      // ask for one of them when it creates a file
+      ::encode(mdr->session->info.prealloc_inos, mdr->reply_extra_bl);
+    }
   }
 
   journal_and_reply(mdr, in, dn, le, fin);
@@ -3266,6 +3351,7 @@ void Server::handle_client_readdir(MDRequestRef& mdr)
     // fetch
     dout(10) << " incomplete dir contents for readdir on " << *dir << ", fetching" << dendl;
     dir->fetch(new C_MDS_RetryRequest(mdcache, mdr), true);
+    readdir_prefetch(diri, fg);
     return;
   }
 
@@ -3345,9 +3431,32 @@ void Server::handle_client_readdir(MDRequestRef& mdr)
 	  if (!p->second->get_linkage()->is_null())
 	    mdcache->lru.lru_touch(p->second);
 
+	// open the rest of the remote inodes we are likely to list along
+	// with this one, instead of one round trip per dentry.
+	MDSGatherBuilder gather(g_ceph_context);
+	mdcache->open_remote_dentry(dn, dnp, gather.new_sub());
+	unsigned opening = 1;
+	for (CDir::map_t::iterator p = it;
+	     p != dir->end() && numfiles + opening < max;
+	     ++p) {
+	  CDentry *odn = p->second;
+	  bool odnp = odn->use_projected(client, mdr);
+	  CDentry::linkage_t *odnl = odnp ? odn->get_projected_linkage() :
+	    odn->get_linkage();
+	  if (!odnl->is_remote() || odnl->get_inode() ||
+	      odn->state_test(CDentry::STATE_BADREMOTEINO) ||
+	      odn->state_test(CDentry::STATE_PURGING) ||
+	      mdcache->get_inode(odnl->get_remote_ino()))
+	    continue;
+	  mdcache->open_remote_dentry(odn, odnp, gather.new_sub());
+	  opening++;
+	}
+	dout(10) << " opening " << opening << " remote dentries" << dendl;
+
 	// already issued caps and leases, reply immediately.
 	if (dnbl.length() > 0) {
-	  mdcache->open_remote_dentry(dn, dnp, new C_MDSInternalNoop);
+	  gather.set_finisher(new C_MDSInternalNoop);
+	  gather.activate();
 	  dout(10) << " open remote dentry after caps were issued, stopping at "
 		   << dnbl.length() << " < " << bytes_left << dendl;
 	  break;
@@ -3355,7 +3464,8 @@ void Server::handle_client_readdir(MDRequestRef& mdr)
 
 	mds->locker->drop_locks(mdr.get());
 	mdr->drop_local_auth_pins();
-	mdcache->open_remote_dentry(dn, dnp, new C_MDS_RetryRequest(mdcache, mdr));
+	gather.set_finisher(new C_MDS_RetryRequest(mdcache, mdr));
+	gather.activate();
 	return;
       }
     }
@@ -3411,12 +3521,41 @@ void Server::handle_client_readdir(MDRequestRef& mdr)
 
   // bump popularity.  NOTE: this doesn't quite capture it.
   mds->balancer->hit_dir(ceph_clock_now(g_ceph_context), dir, META_POP_IRD, -1, numfiles);
+
+  // the client will move on to the next frag when it is done with this one
+  if (offset_str.empty())
+    readdir_prefetch(diri, fg);
   
   // reply
   mdr->tracei = diri;
   respond_to_request(mdr, 0);
 }
 
+/*
+ * Start loading the dirfrag after fg, the one a client listing diri
+ * will read next, so that it is (more likely) complete by the time
+ * the client gets there.
+ */
+void Server::readdir_prefetch(CInode *diri, frag_t fg)
+{
+  if (!g_conf->mds_readdir_prefetch || fg.is_rightmost())
+    return;
+
+  frag_t nfg = diri->dirfragtree[fg.next().value()];
+  CDir *dir = diri->get_dirfrag(nfg);
+  if (!dir) {
+    if (!diri->is_auth() || diri->is_frozen())
+      return;
+    dir = diri->get_or_open_dirfrag(mdcache, nfg);
+  }
+  if (!dir->is_auth() || dir->is_complete() || dir->is_frozen() ||
+      dir->state_test(CDir::STATE_FETCHING) || !dir->can_auth_pin())
+    return;
+
+  dout(10) << "readdir_prefetch " << *dir << dendl;
+  dir->fetch(new C_MDSInternalNoop);
+}
+
 
 
 // ===============================================================================
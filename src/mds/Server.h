@@ -60,6 +60,15 @@ private:
   friend class MDSContinuation;
   friend class ServerContext;
 
+  /**
+   * getattr/lookup requests waiting behind an identical request (same
+   * object and mask) that is waiting for locks.  They are answered
+   * under that request's rdlocks when it completes, rather than each
+   * taking the locks in turn.
+   */
+  map<pair<MDSCacheObject*, int>, list<MDRequestRef> > batched_getattrs;
+  void batch_getattr_respond(MDRequestRef& mdr, int r);
+
 public:
   bool terminating_sessions;
 
@@ -118,6 +127,7 @@ public:
   void dispatch_client_request(MDRequestRef& mdr);
   void early_reply(MDRequestRef& mdr, CInode *tracei, CDentry *tracedn);
   void respond_to_request(MDRequestRef& mdr, int r = 0);
+  void batch_getattr_cleanup(MDRequestRef& mdr);
   void set_trace_dist(Session *session, MClientReply *reply, CInode *in, CDentry *dn,
 		      snapid_t snapid,
 		      int num_dentries_wanted,
@@ -165,6 +175,7 @@ public:
 				bool want_parent, bool want_dentry);
   void _lookup_ino_2(MDRequestRef& mdr, int r);
   void handle_client_readdir(MDRequestRef& mdr);
+  void readdir_prefetch(CInode *diri, frag_t fg);
   void handle_client_file_setlock(MDRequestRef& mdr);
   void handle_client_file_readlock(MDRequestRef& mdr);
 
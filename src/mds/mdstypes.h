@@ -83,6 +83,8 @@ extern const mds_rank_t MDS_RANK_NONE;
 extern long g_num_ino, g_num_dir, g_num_dn, g_num_cap;
 extern long g_num_inoa, g_num_dira, g_num_dna, g_num_capa;
 extern long g_num_inos, g_num_dirs, g_num_dns, g_num_caps;
+// approximate bytes held by cached metadata, by type
+extern long g_mem_ino, g_mem_dir, g_mem_dn, g_mem_cap;
 
 
 // CAPS
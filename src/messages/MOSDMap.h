@@ -30,6 +30,10 @@ class MOSDMap : public Message {
   map<epoch_t, bufferlist> incremental_maps;
   epoch_t oldest_map, newest_map;
 
+  /// features the maps were already encoded for by the sender (not
+  /// sent over the wire); 0 if they carry the canonical encoding.
+  uint64_t encode_features;
+
   epoch_t get_first() const {
     epoch_t e = 0;
     map<epoch_t, bufferlist>::const_iterator i = maps.begin();
@@ -56,11 +60,13 @@ class MOSDMap : public Message {
   }
 
 
-  MOSDMap() : Message(CEPH_MSG_OSD_MAP, HEAD_VERSION) { }
+  MOSDMap() : Message(CEPH_MSG_OSD_MAP, HEAD_VERSION),
+	      encode_features(0) { }
   MOSDMap(const uuid_d &f)
     : Message(CEPH_MSG_OSD_MAP, HEAD_VERSION),
       fsid(f),
-      oldest_map(0), newest_map(0) { }
+      oldest_map(0), newest_map(0),
+      encode_features(0) { }
 private:
   ~MOSDMap() {}
 
@@ -92,34 +98,36 @@ public:
       else if ((features & CEPH_FEATURE_OSDENC) == 0)
 	header.version = 2;  // old pg_pool_t
 
-      // reencode maps using old format
-      //
-      // FIXME: this can probably be done more efficiently higher up
-      // the stack, or maybe replaced with something that only
-      // includes the pools the client cares about.
-      for (map<epoch_t,bufferlist>::iterator p = incremental_maps.begin();
-	   p != incremental_maps.end();
-	   ++p) {
-	OSDMap::Incremental inc;
-	bufferlist::iterator q = p->second.begin();
-	inc.decode(q);
-	p->second.clear();
-	if (inc.fullmap.length()) {
-	  // embedded full map?
+      // reencode maps using old format, unless the sender already did
+      // so for these features (the mon does this higher up the stack and
+      // caches the result).
+      if (encode_features == 0 ||
+	  OSDMap::get_significant_features(encode_features) !=
+	  OSDMap::get_significant_features(features)) {
+	for (map<epoch_t,bufferlist>::iterator p = incremental_maps.begin();
+	     p != incremental_maps.end();
+	     ++p) {
+	  OSDMap::Incremental inc;
+	  bufferlist::iterator q = p->second.begin();
+	  inc.decode(q);
+	  p->second.clear();
+	  if (inc.fullmap.length()) {
+	    // embedded full map?
+	    OSDMap m;
+	    m.decode(inc.fullmap);
+	    inc.fullmap.clear();
+	    m.encode(inc.fullmap, features);
+	  }
+	  inc.encode(p->second, features);
+	}
+	for (map<epoch_t,bufferlist>::iterator p = maps.begin();
+	     p != maps.end();
+	     ++p) {
 	  OSDMap m;
-	  m.decode(inc.fullmap);
-	  inc.fullmap.clear();
-	  m.encode(inc.fullmap, features);
+	  m.decode(p->second);
+	  p->second.clear();
+	  m.encode(p->second, features);
 	}
-	inc.encode(p->second, features);
-      }
-      for (map<epoch_t,bufferlist>::iterator p = maps.begin();
-	   p != maps.end();
-	   ++p) {
-	OSDMap m;
-	m.decode(p->second);
-	p->second.clear();
-	m.encode(p->second, features);
       }
     }
     ::encode(incremental_maps, payload);
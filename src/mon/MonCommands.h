@@ -710,6 +710,11 @@ COMMAND("osd reweight-by-pg " \
 	"name=pools,type=CephPoolname,n=N,req=false", \
 	"reweight OSDs by PG distribution [overload-percentage-for-consideration, default 120]", \
 	"osd", "rw", "cli,rest")
+COMMAND("osd reweight-by-pg-optimize " \
+	"name=max_iterations,type=CephInt,range=1,req=false " \
+	"name=pools,type=CephPoolname,n=N,req=false", \
+	"search for OSD reweights that even out the PG distribution [max-iterations]", \
+	"osd", "rw", "cli,rest")
 COMMAND("osd thrash " \
 	"name=num_epochs,type=CephInt,range=0", \
 	"thrash OSDs for <num_epochs>", "osd", "rw", "cli,rest")
@@ -77,6 +77,8 @@ OSDMonitor::OSDMonitor(CephContext *cct, Monitor *mn, Paxos *p, const string& se
  : PaxosService(mn, p, service_name),
    inc_osd_cache(g_conf->mon_osd_cache_size),
    full_osd_cache(g_conf->mon_osd_cache_size),
+   inc_osd_legacy_cache(g_conf->mon_osd_cache_size),
+   full_osd_legacy_cache(g_conf->mon_osd_cache_size),
    thrash_map(0), thrash_last_up_osd(-1),
    op_tracker(cct, true, 1)
 {}
@@ -1222,7 +1224,8 @@ void OSDMonitor::share_map_with_random_osd()
 
   dout(10) << "committed, telling random " << s->inst << " all about it" << dendl;
   // whatev, they'll request more if they need it
-  MOSDMap *m = build_incremental(osdmap.get_epoch() - 1, osdmap.get_epoch());
+  MOSDMap *m = build_incremental(osdmap.get_epoch() - 1, osdmap.get_epoch(),
+				 s->con->get_features());
   s->con->send_message(m);
   // NOTE: do *not* record osd has up to this epoch (as we do
   // elsewhere) as they may still need to request older values.
@@ -1366,20 +1369,22 @@ bool OSDMonitor::preprocess_get_osdmap(MonOpRequestRef op)
   op->mark_osdmon_event(__func__);
   MMonGetOSDMap *m = static_cast<MMonGetOSDMap*>(op->get_req());
   dout(10) << __func__ << " " << *m << dendl;
+  uint64_t features = m->get_connection()->get_features();
   MOSDMap *reply = new MOSDMap(mon->monmap->fsid);
+  reply->encode_features = features;
   epoch_t first = get_first_committed();
   epoch_t last = osdmap.get_epoch();
   int max = g_conf->osd_map_message_max;
   for (epoch_t e = MAX(first, m->get_full_first());
        e <= MIN(last, m->get_full_last()) && max > 0;
        ++e, --max) {
-    int r = get_version_full(e, reply->maps[e]);
+    int r = get_version_full(e, features, reply->maps[e]);
     assert(r >= 0);
   }
   for (epoch_t e = MAX(first, m->get_inc_first());
        e <= MIN(last, m->get_inc_last()) && max > 0;
        ++e, --max) {
-    int r = get_version(e, reply->incremental_maps[e]);
+    int r = get_version(e, features, reply->incremental_maps[e]);
     assert(r >= 0);
   }
   reply->oldest_map = get_first_committed();
@@ -2370,25 +2375,29 @@ void OSDMonitor::send_latest(MonOpRequestRef op, epoch_t start)
 }
 
 
-MOSDMap *OSDMonitor::build_latest_full()
+MOSDMap *OSDMonitor::build_latest_full(uint64_t features)
 {
   MOSDMap *r = new MOSDMap(mon->monmap->fsid);
-  get_version_full(osdmap.get_epoch(), r->maps[osdmap.get_epoch()]);
+  r->encode_features = features;
+  get_version_full(osdmap.get_epoch(), features, r->maps[osdmap.get_epoch()]);
   r->oldest_map = get_first_committed();
   r->newest_map = osdmap.get_epoch();
   return r;
 }
 
-MOSDMap *OSDMonitor::build_incremental(epoch_t from, epoch_t to)
+MOSDMap *OSDMonitor::build_incremental(epoch_t from, epoch_t to,
+				       uint64_t features)
 {
-  dout(10) << "build_incremental [" << from << ".." << to << "]" << dendl;
+  dout(10) << "build_incremental [" << from << ".." << to << "] with features "
+	   << features << dendl;
   MOSDMap *m = new MOSDMap(mon->monmap->fsid);
   m->oldest_map = get_first_committed();
   m->newest_map = osdmap.get_epoch();
+  m->encode_features = features;
 
   for (epoch_t e = to; e >= from && e > 0; e--) {
     bufferlist bl;
-    int err = get_version(e, bl);
+    int err = get_version(e, features, bl);
     if (err == 0) {
       assert(bl.length());
       // if (get_version(e, bl) > 0) {
@@ -2398,7 +2407,7 @@ MOSDMap *OSDMonitor::build_incremental(epoch_t from, epoch_t to)
     } else {
       assert(err == -ENOENT);
       assert(!bl.length());
-      get_version_full(e, bl);
+      get_version_full(e, features, bl);
       if (bl.length() > 0) {
       //else if (get_version("full", e, bl) > 0) {
       dout(20) << "build_incremental   full " << e << " "
@@ -2416,7 +2425,8 @@ void OSDMonitor::send_full(MonOpRequestRef op)
 {
   op->mark_osdmon_event(__func__);
   dout(5) << "send_full to " << op->get_req()->get_orig_source_inst() << dendl;
-  mon->send_reply(op, build_latest_full());
+  mon->send_reply(op, build_latest_full(
+			 op->get_req()->get_connection()->get_features()));
 }
 
 void OSDMonitor::send_incremental(MonOpRequestRef op, epoch_t first)
@@ -2455,10 +2465,12 @@ void OSDMonitor::send_incremental(epoch_t first,
     first = session->osd_epoch + 1;
   }
 
+  uint64_t features = session->con->get_features();
+
   if (first < get_first_committed()) {
     first = get_first_committed();
     bufferlist bl;
-    int err = get_version_full(first, bl);
+    int err = get_version_full(first, features, bl);
     assert(err == 0);
     assert(bl.length());
 
@@ -2468,6 +2480,7 @@ void OSDMonitor::send_incremental(epoch_t first,
     MOSDMap *m = new MOSDMap(osdmap.get_fsid());
     m->oldest_map = get_first_committed();
     m->newest_map = osdmap.get_epoch();
+    m->encode_features = features;
     m->maps[first] = bl;
 
     if (req) {
@@ -2483,7 +2496,7 @@ void OSDMonitor::send_incremental(epoch_t first,
 
   while (first <= osdmap.get_epoch()) {
     epoch_t last = MIN(first + g_conf->osd_map_message_max, osdmap.get_epoch());
-    MOSDMap *m = build_incremental(first, last);
+    MOSDMap *m = build_incremental(first, last, features);
 
     if (req) {
       // send some maps.  it may not be all of them, but it will get them
@@ -2525,6 +2538,64 @@ int OSDMonitor::get_version_full(version_t ver, bufferlist& bl)
     return ret;
 }
 
+int OSDMonitor::get_version(version_t ver, uint64_t features,
+			    bufferlist& bl)
+{
+  uint64_t significant_features = OSDMap::get_significant_features(features);
+  if (significant_features & CEPH_FEATURE_OSDMAP_ENC)
+    return get_version(ver, bl);  // canonical encoding is fine
+
+  ver_features_t key(ver, significant_features);
+  if (inc_osd_legacy_cache.lookup(key, &bl)) {
+    return 0;
+  }
+  bufferlist canonical;
+  int ret = get_version(ver, canonical);
+  if (ret < 0)
+    return ret;
+
+  OSDMap::Incremental inc;
+  bufferlist::iterator q = canonical.begin();
+  inc.decode(q);
+  if (inc.fullmap.length()) {
+    // embedded full map?
+    OSDMap m;
+    m.decode(inc.fullmap);
+    inc.fullmap.clear();
+    m.encode(inc.fullmap, features);
+  }
+  inc.encode(bl, features);
+  dout(20) << __func__ << " reencoded inc " << ver << " for features "
+	   << significant_features << ", " << bl.length() << " bytes" << dendl;
+  inc_osd_legacy_cache.add(key, bl);
+  return 0;
+}
+
+int OSDMonitor::get_version_full(version_t ver, uint64_t features,
+				 bufferlist& bl)
+{
+  uint64_t significant_features = OSDMap::get_significant_features(features);
+  if (significant_features & CEPH_FEATURE_OSDMAP_ENC)
+    return get_version_full(ver, bl);  // canonical encoding is fine
+
+  ver_features_t key(ver, significant_features);
+  if (full_osd_legacy_cache.lookup(key, &bl)) {
+    return 0;
+  }
+  bufferlist canonical;
+  int ret = get_version_full(ver, canonical);
+  if (ret < 0)
+    return ret;
+
+  OSDMap m;
+  m.decode(canonical);
+  m.encode(bl, features);
+  dout(20) << __func__ << " reencoded full " << ver << " for features "
+	   << significant_features << ", " << bl.length() << " bytes" << dendl;
+  full_osd_legacy_cache.add(key, bl);
+  return 0;
+}
+
 epoch_t OSDMonitor::blacklist(const entity_addr_t& a, utime_t until)
 {
   dout(10) << "blacklist " << a << " until " << until << dendl;
@@ -2555,7 +2626,8 @@ void OSDMonitor::check_sub(Subscription *sub)
     if (sub->next >= 1)
       send_incremental(sub->next, sub->session, sub->incremental_onetime);
     else
-      sub->session->con->send_message(build_latest_full());
+      sub->session->con->send_message(
+	build_latest_full(sub->session->con->get_features()));
     if (sub->onetime)
       mon->session_map.remove_sub(sub);
     else
@@ -7443,6 +7515,71 @@ done:
 						get_last_committed() + 1));
       return true;
     }
+  } else if (prefix == "osd reweight-by-pg-optimize") {
+    int64_t max_iterations;
+    cmd_getval(g_ceph_context, cmdmap, "max_iterations", max_iterations,
+	       int64_t(g_conf->mon_pg_balance_max_iterations));
+    // every round maps all pgs synchronously in the mon
+    if (max_iterations > g_conf->mon_pg_balance_iterations_limit) {
+      ss << "max_iterations " << max_iterations << " > "
+	 << g_conf->mon_pg_balance_iterations_limit
+	 << " (mon_pg_balance_iterations_limit)";
+      err = -EINVAL;
+      goto reply;
+    }
+    set<int64_t> pools;
+    vector<string> poolnamevec;
+    cmd_getval(g_ceph_context, cmdmap, "pools", poolnamevec);
+    for (unsigned j = 0; j < poolnamevec.size(); j++) {
+      int64_t pool = osdmap.lookup_pg_pool_name(poolnamevec[j]);
+      if (pool < 0) {
+	ss << "pool '" << poolnamevec[j] << "' does not exist";
+	err = -ENOENT;
+	goto reply;
+      }
+      pools.insert(pool);
+    }
+    // each round, and the initial count, maps every pg of the pools while
+    // the mon does nothing else: take fewer rounds if that is too much
+    uint64_t num_pgs = 0;
+    for (map<int64_t,pg_pool_t>::const_iterator p = osdmap.get_pools().begin();
+	 p != osdmap.get_pools().end(); ++p) {
+      if (pools.empty() || pools.count(p->first))
+	num_pgs += p->second.get_pg_num();
+    }
+    uint64_t max_rounds = num_pgs ?
+      g_conf->mon_pg_balance_max_mappings / num_pgs : max_iterations + 1;
+    if (max_rounds < 2) {
+      ss << "mapping " << num_pgs << " pgs is too much work for the monitor"
+	 << " (mon_pg_balance_max_mappings "
+	 << g_conf->mon_pg_balance_max_mappings << ")";
+      err = -E2BIG;
+      goto reply;
+    }
+    map<int,unsigned> new_weights;
+    ostringstream out;
+    if ((uint64_t)max_iterations >= max_rounds) {
+      max_iterations = max_rounds - 1;
+      out << "limited to " << max_iterations << " iterations for "
+	  << num_pgs << " pgs; ";
+    }
+    err = osdmap.calc_pg_balance_weights(pools, max_iterations,
+					 g_conf->mon_pg_balance_max_change,
+					 &new_weights, &out);
+    if (err < 0) {
+      ss << "FAILED reweight-by-pg-optimize: " << out.str();
+    } else if (err == 0) {
+      ss << "no change: " << out.str();
+    } else {
+      for (map<int,unsigned>::iterator p = new_weights.begin();
+	   p != new_weights.end(); ++p)
+	pending_inc.new_weight[p->first] = p->second;
+      ss << "SUCCESSFUL reweight-by-pg-optimize: " << out.str();
+      getline(ss, rs);
+      wait_for_finished_proposal(op, new Monitor::C_Command(mon, op, 0, rs,
+						get_last_committed() + 1));
+      return true;
+    }
   } else if (prefix == "osd thrash") {
     int64_t num_epochs;
     cmd_getval(g_ceph_context, cmdmap, "num_epochs", num_epochs, int64_t(0));
@@ -26,6 +26,7 @@
 using namespace std;
 
 #include "include/types.h"
+#include "include/hash.h"
 #include "common/simple_cache.hpp"
 #include "msg/Messenger.h"
 
@@ -134,6 +135,20 @@ private:
   SimpleLRU<version_t, bufferlist> inc_osd_cache;
   SimpleLRU<version_t, bufferlist> full_osd_cache;
 
+  // maps reencoded for legacy peers, keyed by (epoch, significant
+  // features), so that each is encoded once and then shared by every
+  // session with the same feature set.
+  typedef pair<version_t,uint64_t> ver_features_t;
+  struct ver_features_hash {
+    size_t operator()(const ver_features_t& v) const {
+      return rjhash64(v.first ^ rjhash64(v.second));
+    }
+  };
+  typedef SimpleLRU<ver_features_t, bufferlist, less<ver_features_t>,
+		    ver_features_hash> legacy_osd_cache_t;
+  legacy_osd_cache_t inc_osd_legacy_cache;
+  legacy_osd_cache_t full_osd_legacy_cache;
+
   void check_failures(utime_t now);
   bool check_failure(utime_t now, int target_osd, failure_info_t& fi);
 
@@ -217,8 +232,8 @@ private:
   bool can_mark_in(int o);
 
   // ...
-  MOSDMap *build_latest_full();
-  MOSDMap *build_incremental(epoch_t first, epoch_t last);
+  MOSDMap *build_latest_full(uint64_t features);
+  MOSDMap *build_incremental(epoch_t first, epoch_t last, uint64_t features);
   void send_full(MonOpRequestRef op);
   void send_incremental(MonOpRequestRef op, epoch_t first);
 public:
@@ -420,6 +435,9 @@ private:
 
   int get_version(version_t ver, bufferlist& bl) override;
   int get_version_full(version_t ver, bufferlist& bl) override;
+  /// get an encoding of the given epoch that a peer with @p features decodes
+  int get_version(version_t ver, uint64_t features, bufferlist& bl);
+  int get_version_full(version_t ver, uint64_t features, bufferlist& bl);
 
   epoch_t blacklist(const entity_addr_t& a, utime_t until);
 
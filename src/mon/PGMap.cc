@@ -222,8 +222,15 @@ void PGMap::apply_incremental(CephContext *cct, const Incremental& inc)
           ))
 	min_last_epoch_clean = 0;
 
-      stat_pg_sub(update_pg, t->second);
+      // skip the pg_by_osd churn when the pg has not moved
+      bool sameosds =
+	t->second.acting == update_stat.acting &&
+	t->second.up == update_stat.up &&
+	t->second.blocked_by == update_stat.blocked_by;
+      stat_pg_sub(update_pg, t->second, false, sameosds);
       t->second = update_stat;
+      stat_pg_add(update_pg, update_stat, false, sameosds);
+      continue;
     }
     stat_pg_add(update_pg, update_stat);
   }
@@ -361,6 +368,7 @@ void PGMap::calc_stats()
   pg_sum = pool_stat_t();
   osd_sum = osd_stat_t();
   pg_by_osd.clear();
+  num_pg_by_last_epoch_clean.clear();
 
   for (ceph::unordered_map<pg_t,pg_stat_t>::iterator p = pg_stat.begin();
        p != pg_stat.end();
@@ -467,6 +475,7 @@ void PGMap::stat_pg_add(const pg_t &pgid, const pg_stat_t &s, bool nocreating,
 
   num_pg++;
   num_pg_by_state[s.state]++;
+  num_pg_by_last_epoch_clean[s.get_effective_last_epoch_clean()]++;
 
   if (!nocreating) {
     if (s.state & PG_STATE_CREATING) {
@@ -507,6 +516,12 @@ void PGMap::stat_pg_sub(const pg_t &pgid, const pg_stat_t &s, bool nocreating,
   if (end == 0)
     num_pg_by_state.erase(s.state);
 
+  map<epoch_t,int32_t>::iterator lec =
+    num_pg_by_last_epoch_clean.find(s.get_effective_last_epoch_clean());
+  assert(lec != num_pg_by_last_epoch_clean.end());
+  if (--lec->second == 0)
+    num_pg_by_last_epoch_clean.erase(lec);
+
   if (!nocreating) {
     if (s.state & PG_STATE_CREATING) {
       creating_pgs.erase(pgid);
@@ -578,16 +593,12 @@ void PGMap::stat_osd_sub(const osd_stat_t &s)
 
 epoch_t PGMap::calc_min_last_epoch_clean() const
 {
-  if (pg_stat.empty())
+  if (num_pg_by_last_epoch_clean.empty())
     return 0;
 
-  ceph::unordered_map<pg_t,pg_stat_t>::const_iterator p = pg_stat.begin();
-  epoch_t min = p->second.get_effective_last_epoch_clean();
-  for (++p; p != pg_stat.end(); ++p) {
-    epoch_t lec = p->second.get_effective_last_epoch_clean();
-    if (lec < min)
-      min = lec;
-  }
+  // the per-pg values are kept sorted by stat_pg_add/sub, so only the
+  // (much smaller) set of osd epochs needs to be scanned
+  epoch_t min = num_pg_by_last_epoch_clean.begin()->first;
   // also scan osd epochs
   // don't trim past the oldest reported osd epoch
   for (ceph::unordered_map<int32_t, epoch_t>::const_iterator i = osd_epochs.begin();
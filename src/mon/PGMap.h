@@ -120,6 +120,8 @@ public:
   pool_stat_t pg_sum;
   osd_stat_t osd_sum;
   mutable epoch_t min_last_epoch_clean;
+  /// number of pgs by effective last_epoch_clean, maintained by stat_pg_add/sub
+  map<epoch_t,int32_t> num_pg_by_last_epoch_clean;
   ceph::unordered_map<int,int> blocked_by_sum;
   ceph::unordered_map<int,set<pg_t> > pg_by_osd;
 
@@ -995,12 +995,13 @@ private:
       if (op_ptr.length() == 0 || op_ptr.offset() >= op_ptr.length()) {
         op_ptr = bufferptr(sizeof(Op) * OPS_PER_PTR);
       }
-      bufferptr ptr(op_ptr, 0, sizeof(Op));
-      op_bl.append(ptr);
+      // ops carved out of the same op_ptr extend the tail of op_bl, so
+      // the op array stays contiguous and the iterator need not copy it
+      op_bl.append(op_ptr, 0, sizeof(Op));
 
+      char* p = op_ptr.c_str();
       op_ptr.set_offset(op_ptr.offset() + sizeof(Op));
 
-      char* p = ptr.c_str();
       memset(p, 0, sizeof(Op));
       return reinterpret_cast<Op*>(p);
     }
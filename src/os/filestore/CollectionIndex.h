@@ -175,6 +175,18 @@ protected:
   /// Call prior to removing directory
   virtual int prep_delete() { return 0; }
 
+  /// True if some subdirs are close enough to splitting to split them early
+  virtual bool want_split_ahead() { return false; }
+
+  /**
+   * Perform one incremental step of splitting a subdir ahead of its
+   * split threshold.  Called with access_lock held for write; the lock
+   * may be dropped between calls so that IO can proceed.
+   *
+   * @return < 0 on error, 0 if no further work, > 0 if more remains
+   */
+  virtual int split_ahead() { return 0; }
+
   explicit CollectionIndex(const coll_t& collection):
     access_lock("CollectionIndex::access_lock", true, false) {}
 
@@ -1045,10 +1045,16 @@ int DBObjectMap::sync(const ghobject_t *oid,
     }
     /* It may appear that this and the identical portion of the else
      * block can combined below, but in this block, the transaction
-     * must be submitted under *both* the MapHeaderLock and the full
-     * header_lock.
+     * must be submitted while we still hold the MapHeaderLock.
+     * set_map_header() already put the new header in the cache; until
+     * the transaction is submitted the db still has the old one.  Every
+     * lookup that could fill the cache from the db for this oid, and
+     * every other update of its header, needs the MapHeaderLock on oid,
+     * so none of them can run in between (bug 9891, which the full
+     * header_lock used to exclude before the cache was sharded).
+     * header_lock only protects state for write_state().
      *
-     * See 2b63dd25fc1c73fa42e52e9ea4ab5a45dd9422a0 and bug 9891.
+     * See 2b63dd25fc1c73fa42e52e9ea4ab5a45dd9422a0.
      */
     Mutex::Locker l(header_lock);
     write_state(t);
@@ -1079,14 +1085,11 @@ DBObjectMap::Header DBObjectMap::_lookup_map_header(
 {
   assert(l.get_locked() == oid);
 
+  HeaderShard *shard = get_oid_shard(oid);
   _Header *header = new _Header();
-  {
-    Mutex::Locker l(cache_lock);
-    if (caches.lookup(oid, header)) {
-      assert(!in_use.count(header->seq));
-      in_use.insert(header->seq);
-      return Header(header, RemoveOnDelete(this));
-    }
+  if (shard->cache.lookup(oid, header)) {
+    use_seq(header->seq);
+    return Header(header, RemoveOnDelete(this));
   }
 
   bufferlist out;
@@ -1100,13 +1103,9 @@ DBObjectMap::Header DBObjectMap::_lookup_map_header(
   bufferlist::iterator iter = out.begin();
 
   ret->decode(iter);
-  {
-    Mutex::Locker l(cache_lock);
-    caches.add(oid, *ret);
-  }
+  shard->cache.add(oid, *ret);
 
-  assert(!in_use.count(header->seq));
-  in_use.insert(header->seq);
+  use_seq(header->seq);
   return ret;
 }
 
@@ -1121,8 +1120,7 @@ DBObjectMap::Header DBObjectMap::_generate_new_header(const ghobject_t &oid,
   }
   header->num_children = 1;
   header->oid = oid;
-  assert(!in_use.count(header->seq));
-  in_use.insert(header->seq);
+  use_seq(header->seq);
 
   write_state();
   return header;
@@ -1130,9 +1128,17 @@ DBObjectMap::Header DBObjectMap::_generate_new_header(const ghobject_t &oid,
 
 DBObjectMap::Header DBObjectMap::lookup_parent(Header input)
 {
-  Mutex::Locker l(header_lock);
-  while (in_use.count(input->parent))
-    header_cond.Wait(header_lock);
+  HeaderShard *shard = get_seq_shard(input->parent);
+  {
+    Mutex::Locker l(shard->lock);
+    while (shard->in_use.count(input->parent))
+      shard->header_cond.Wait(shard->lock);
+    shard->in_use.insert(input->parent);
+  }
+  // released when header goes out of scope
+  Header header = Header(new _Header(), RemoveOnDelete(this));
+  header->seq = input->parent;
+
   map<string, bufferlist> out;
   set<string> keys;
   keys.insert(HEADER_KEY);
@@ -1149,13 +1155,11 @@ DBObjectMap::Header DBObjectMap::lookup_parent(Header input)
     return Header();
   }
 
-  Header header = Header(new _Header(), RemoveOnDelete(this));
-  header->seq = input->parent;
   bufferlist::iterator iter = out.begin()->second.begin();
   header->decode(iter);
+  assert(header->seq == input->parent);
   dout(20) << "lookup_parent: parent seq is " << header->seq << " with parent "
        << header->parent << dendl;
-  in_use.insert(header->seq);
   return header;
 }
 
@@ -1164,10 +1168,9 @@ DBObjectMap::Header DBObjectMap::lookup_create_map_header(
   const ghobject_t &oid,
   KeyValueDB::Transaction t)
 {
-  Mutex::Locker l(header_lock);
   Header header = _lookup_map_header(hl, oid);
   if (!header) {
-    header = _generate_new_header(oid, Header());
+    header = generate_new_header(oid, Header());
     set_map_header(hl, oid, *header, t);
   }
   return header;
@@ -1205,10 +1208,7 @@ void DBObjectMap::remove_map_header(
   set<string> to_remove;
   to_remove.insert(map_header_key(oid));
   t->rmkeys(HOBJECT_TO_SEQ, to_remove);
-  {
-    Mutex::Locker l(cache_lock);
-    caches.clear(oid);
-  }
+  get_oid_shard(oid)->cache.clear(oid);
 }
 
 void DBObjectMap::set_map_header(
@@ -1223,10 +1223,7 @@ void DBObjectMap::set_map_header(
   map<string, bufferlist> to_set;
   header.encode(to_set[map_header_key(oid)]);
   t->set(HOBJECT_TO_SEQ, to_set);
-  {
-    Mutex::Locker l(cache_lock);
-    caches.add(oid, header);
-  }
+  get_oid_shard(oid)->cache.add(oid, header);
 }
 
 bool DBObjectMap::check_spos(const ghobject_t &oid,
@@ -60,17 +60,9 @@ public:
   boost::scoped_ptr<KeyValueDB> db;
 
   /**
-   * Serializes access to next_seq as well as the in_use set
+   * Serializes access to next_seq
    */
   Mutex header_lock;
-  Cond header_cond;
-  Cond map_header_cond;
-
-  /**
-   * Set of headers currently in use
-   */
-  set<uint64_t> in_use;
-  set<ghobject_t, ghobject_t::BitwiseComparator> map_header_in_use;
 
   /**
    * Takes the map_header_in_use entry in constructor, releases in
@@ -85,10 +77,11 @@ public:
   public:
     explicit MapHeaderLock(DBObjectMap *db) : db(db) {}
     MapHeaderLock(DBObjectMap *db, const ghobject_t &oid) : db(db), locked(oid) {
-      Mutex::Locker l(db->header_lock);
-      while (db->map_header_in_use.count(*locked))
-	db->map_header_cond.Wait(db->header_lock);
-      db->map_header_in_use.insert(*locked);
+      HeaderShard *shard = db->get_oid_shard(*locked);
+      Mutex::Locker l(shard->lock);
+      while (shard->map_header_in_use.count(*locked))
+	shard->map_header_cond.Wait(shard->lock);
+      shard->map_header_in_use.insert(*locked);
     }
 
     const ghobject_t &get_locked() const {
@@ -107,18 +100,28 @@ public:
 
     ~MapHeaderLock() {
       if (locked) {
-	Mutex::Locker l(db->header_lock);
-	assert(db->map_header_in_use.count(*locked));
-	db->map_header_cond.Signal();
-	db->map_header_in_use.erase(*locked);
+	HeaderShard *shard = db->get_oid_shard(*locked);
+	Mutex::Locker l(shard->lock);
+	assert(shard->map_header_in_use.count(*locked));
+	shard->map_header_cond.SignalAll();
+	shard->map_header_in_use.erase(*locked);
       }
     }
   };
 
-  explicit DBObjectMap(KeyValueDB *db) : db(db), header_lock("DBOBjectMap"),
-           	                         cache_lock("DBObjectMap::CacheLock"),
-      	                                 caches(g_conf->filestore_omap_header_cache_size)
-    {}
+  explicit DBObjectMap(KeyValueDB *db) : db(db), header_lock("DBOBjectMap") {
+    int num_shards = MAX(1, g_conf->filestore_omap_header_shards);
+    size_t cache_size = MAX(1, g_conf->filestore_omap_header_cache_size /
+			       num_shards);
+    for (int i = 0; i < num_shards; ++i)
+      shards.push_back(new HeaderShard(cache_size));
+  }
+  ~DBObjectMap() {
+    for (vector<HeaderShard*>::iterator p = shards.begin();
+	 p != shards.end();
+	 ++p)
+      delete *p;
+  }
 
   int set_keys(
     const ghobject_t &oid,
@@ -328,8 +331,43 @@ public:
 private:
   /// Implicit lock on Header->seq
   typedef ceph::shared_ptr<_Header> Header;
-  Mutex cache_lock;
-  SimpleLRU<ghobject_t, _Header, ghobject_t::BitwiseComparator> caches;
+
+  /**
+   * Header bookkeeping, split into shards so that operations on
+   * unrelated objects do not contend.  map_header_in_use and the
+   * header cache are sharded by object hash, in_use by header seq;
+   * see get_oid_shard() and get_seq_shard().  The cache has its own
+   * lock, so a cached header can be found without taking shard->lock.
+   */
+  struct HeaderShard {
+    Mutex lock;
+    Cond header_cond;      ///< signaled when an in_use seq is released
+    Cond map_header_cond;  ///< signaled when a map_header_in_use oid is released
+
+    /// Set of headers currently in use
+    set<uint64_t> in_use;
+    set<ghobject_t, ghobject_t::BitwiseComparator> map_header_in_use;
+
+    SimpleLRU<ghobject_t, _Header, ghobject_t::BitwiseComparator> cache;
+
+    explicit HeaderShard(size_t cache_size)
+      : lock("DBObjectMap::HeaderShard::lock"), cache(cache_size) {}
+  };
+  vector<HeaderShard*> shards;
+
+  HeaderShard *get_oid_shard(const ghobject_t &oid) {
+    return shards[oid.hobj.get_hash() % shards.size()];
+  }
+  HeaderShard *get_seq_shard(uint64_t seq) {
+    return shards[seq % shards.size()];
+  }
+  /// Mark seq in use; it must not already be
+  void use_seq(uint64_t seq) {
+    HeaderShard *shard = get_seq_shard(seq);
+    Mutex::Locker l(shard->lock);
+    assert(!shard->in_use.count(seq));
+    shard->in_use.insert(seq);
+  }
 
   string map_header_key(const ghobject_t &oid);
   string header_key(uint64_t seq);
@@ -466,7 +504,6 @@ private:
   Header lookup_map_header(
     const MapHeaderLock &l2,
     const ghobject_t &oid) {
-    Mutex::Locker l(header_lock);
     return _lookup_map_header(l2, oid);
   }
 
@@ -519,10 +556,13 @@ private:
     explicit RemoveOnDelete(DBObjectMap *db) :
       db(db) {}
     void operator() (_Header *header) {
-      Mutex::Locker l(db->header_lock);
-      assert(db->in_use.count(header->seq));
-      db->in_use.erase(header->seq);
-      db->header_cond.Signal();
+      HeaderShard *shard = db->get_seq_shard(header->seq);
+      {
+	Mutex::Locker l(shard->lock);
+	assert(shard->in_use.count(header->seq));
+	shard->in_use.erase(header->seq);
+	shard->header_cond.SignalAll();
+      }
       delete header;
     }
   };
@@ -458,6 +458,10 @@ int FileJournal::open(uint64_t fs_op_seq)
   dout(2) << "open " << fn << " fsid " << fsid << " fs_op_seq " << fs_op_seq << dendl;
 
   uint64_t next_seq = fs_op_seq + 1;
+  if (seq_stride > 1) {
+    // the first seq after fs_op_seq that lives in this journal
+    next_seq += (seq_phase + seq_stride - next_seq % seq_stride) % seq_stride;
+  }
 
   int err = _open(false);
   if (err)
@@ -466,6 +470,7 @@ int FileJournal::open(uint64_t fs_op_seq)
   // assume writeable, unless...
   read_pos = 0;
   write_pos = get_top();
+  read_generation = 0;
 
   // read header?
   err = read_header(&header);
@@ -547,7 +552,7 @@ int FileJournal::open(uint64_t fs_op_seq)
       read_pos = old_pos;
       break;
     }
-    seq++;  // next event should follow.
+    seq += seq_stride;  // next event should follow.
   }
 
   return 0;
@@ -1010,6 +1015,8 @@ int FileJournal::prepare_single_write(write_item &next_write, bufferlist& bl, of
   uint64_t _seq = seq;
   uint64_t _queue_pos = queue_pos;
   uint64_t magic2 = entry_header_t::make_magic(seq, orig_len, header.get_fsid64());
+  if (seq_stride > 1)
+    magic2 ^= header.generation;  // see get_entry_generation()
   headerptr.copy_in(seq_offset, sizeof(uint64_t), (char *)&_seq);
   headerptr.copy_in(magic1_offset, sizeof(uint64_t), (char *)&_queue_pos);
   headerptr.copy_in(magic2_offset, sizeof(uint64_t), (char *)&magic2);
@@ -1854,6 +1861,11 @@ int FileJournal::make_writeable()
   read_pos = 0;
 
   must_write_header = true;
+  if (seq_stride > 1) {
+    // our entries must not be written before the header carrying
+    // their generation, or replay would take them for garbage
+    write_header_sync();
+  }
   start_writer();
   return 0;
 }
@@ -1912,12 +1924,31 @@ bool FileJournal::read_entry(
   off64_t pos = read_pos;
   off64_t next_pos = pos;
   stringstream ss;
+  entry_header_t h;
   read_entry_result result = do_read_entry(
     pos,
     &next_pos,
     &bl,
     &seq,
-    &ss);
+    &ss,
+    &h);
+  if (result == SUCCESS && seq_stride > 1) {
+    // Leave read_pos at the entry in both cases below so that
+    // make_writeable() overwrites it; neither was acked.
+    uint64_t generation = get_entry_generation(h);
+    if (generation < read_generation) {
+      dout(2) << "read_entry " << pos << " : seq " << seq << " generation "
+	      << generation << " predates generation " << read_generation
+	      << ", end of journal" << dendl;
+      return false;
+    }
+    if (next_seq && next_seq % seq_stride == seq_phase && seq > next_seq) {
+      dout(2) << "read_entry " << pos << " : seq " << seq << " but expected "
+	      << next_seq << ", end of journal" << dendl;
+      return false;
+    }
+    read_generation = generation;
+  }
   if (result == SUCCESS) {
     journalq.push_back( pair<uint64_t,off64_t>(seq, pos));
     if (next_seq > seq) {
@@ -1970,7 +2001,13 @@ FileJournal::read_entry_result FileJournal::do_read_entry(
   wrap_read_bl(cur_pos, sizeof(*h), &hbl, &_next_pos);
   h = reinterpret_cast<entry_header_t *>(hbl.c_str());
 
-  if (!h->check_magic(cur_pos, header.get_fsid64())) {
+  bool magic_ok;
+  if (seq_stride > 1)
+    magic_ok = h->magic1 == (uint64_t)cur_pos &&
+      get_entry_generation(*h) <= header.generation;
+  else
+    magic_ok = h->check_magic(cur_pos, header.get_fsid64());
+  if (!magic_ok) {
     dout(25) << "read_entry " << init_pos
 	     << " : bad header magic, end of journal" << dendl;
     if (ss)
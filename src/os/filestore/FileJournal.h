@@ -138,9 +138,19 @@ public:
      */
     uint64_t start_seq;
 
+    /**
+     * generation
+     *
+     * Bumped each time a striped journal is made writeable.  Striped
+     * entries carry the generation they were written in, so that
+     * replay can tell entries left over from before a crash from the
+     * ones written since (see StripedJournal).  Always 0 otherwise.
+     */
+    uint64_t generation;
+
     header_t() :
       flags(0), block_size(0), alignment(0), max_size(0), start(0),
-      committed_up_to(0), start_seq(0) {}
+      committed_up_to(0), start_seq(0), generation(0) {}
 
     void clear() {
       start = block_size;
@@ -151,7 +161,7 @@ public:
     }
 
     void encode(bufferlist& bl) const {
-      __u32 v = 4;
+      __u32 v = 5;
       ::encode(v, bl);
       bufferlist em;
       {
@@ -163,6 +173,7 @@ public:
 	::encode(start, em);
 	::encode(committed_up_to, em);
 	::encode(start_seq, em);
+	::encode(generation, em);
       }
       ::encode(em, bl);
     }
@@ -183,6 +194,7 @@ public:
 	::decode(start, bl);
 	committed_up_to = 0;
 	start_seq = 0;
+	generation = 0;
 	return;
       }
       bufferlist em;
@@ -204,6 +216,11 @@ public:
 	::decode(start_seq, t);
       else
 	start_seq = 0;
+
+      if (v > 4)
+	::decode(generation, t);
+      else
+	generation = 0;
     }
   } header;
 
@@ -239,6 +256,13 @@ private:
   off64_t read_pos;       //
   bool discard;	  //for block journal whether support discard
 
+  /// we hold every seq_stride'th seq, those == seq_phase mod seq_stride
+  /// (see StripedJournal); 1 and 0 for a normal journal.
+  uint64_t seq_stride, seq_phase;
+  /// read_entry() stops at striped entries older than this; raised by
+  /// each entry it returns
+  uint64_t read_generation;
+
 #ifdef HAVE_LIBAIO
   /// state associated with an in-flight aio request
   /// Protected by aio_lock
@@ -342,6 +366,14 @@ private:
     off64_t *out_pos  ///< [out] next position to read, will be wrapped
     ) const;
 
+  /// striped entries xor their generation into magic2; 0 otherwise
+  uint64_t get_entry_generation(const entry_header_t &h) const {
+    if (seq_stride == 1)
+      return 0;
+    return h.magic2 ^
+      entry_header_t::make_magic(h.seq, h.len, header.get_fsid64());
+  }
+
   void do_discard(int64_t offset, int64_t end);
 
   class Writer : public Thread {
@@ -384,6 +416,7 @@ private:
     must_write_header(false),
     write_pos(0), read_pos(0),
     discard(false),
+    seq_stride(1), seq_phase(0), read_generation(0),
 #ifdef HAVE_LIBAIO
     aio_lock("FileJournal::aio_lock"),
     aio_ctx(0),
@@ -428,6 +461,30 @@ private:
   int simple_dump(ostream& out);
   int _fdump(Formatter &f, bool simple);
 
+  /// only hold seqs == offset mod stride; must be set before open()
+  void set_seq_stride(uint64_t stride, uint64_t offset) {
+    assert(stride > 0 && offset < stride);
+    seq_stride = stride;
+    seq_phase = offset;
+  }
+  uint32_t get_alignment() const {
+    return header.alignment;
+  }
+  uint64_t get_generation() const {
+    return header.generation;
+  }
+  /// entries written after the next make_writeable() carry generation g
+  void set_generation(uint64_t g) {
+    assert(seq_stride > 1 && g >= header.generation);
+    header.generation = g;
+  }
+  uint64_t get_read_generation() const {
+    return read_generation;
+  }
+  void set_read_generation(uint64_t g) {
+    read_generation = g;
+  }
+
   void flush();
 
   void throttle();
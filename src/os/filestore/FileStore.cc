@@ -54,6 +54,7 @@
 #include "common/BackTrace.h"
 #include "include/types.h"
 #include "FileJournal.h"
+#include "StripedJournal.h"
 
 #include "osd/osd_types.h"
 #include "include/color.h"
@@ -77,6 +78,7 @@ using ceph::crypto::SHA1;
 #include "include/assert.h"
 
 #include "common/config.h"
+#include "include/str_list.h"
 #include "common/blkdev.h"
 
 #ifdef WITH_LTTNG
@@ -297,6 +299,8 @@ int FileStore::lfn_open(const coll_t& cid,
           << ") in index: " << cpp_strerror(-r) << dendl;
       goto fail;
     }
+    if ((*index)->want_split_ahead())
+      queue_split_ahead(cid);
     r = chain_fsetxattr(fd, XATTR_SPILL_OUT_NAME,
                         XATTR_NO_SPILL_OUT, sizeof(XATTR_NO_SPILL_OUT), true);
     if (r < 0) {
@@ -337,6 +341,56 @@ void FileStore::lfn_close(FDRef fd)
 {
 }
 
+struct C_SplitAhead : public Context {
+  FileStore *fs;
+  coll_t cid;
+  C_SplitAhead(FileStore *fs, const coll_t& cid) : fs(fs), cid(cid) {}
+  void finish(int r) {
+    fs->_split_ahead(cid);
+  }
+};
+
+void FileStore::queue_split_ahead(const coll_t& cid)
+{
+  Mutex::Locker l(split_ahead_lock);
+  if (split_ahead_pending.insert(cid).second) {
+    dout(15) << __func__ << " " << cid << dendl;
+    split_ahead_finisher.queue(new C_SplitAhead(this, cid));
+  }
+}
+
+/*
+ * split subdirs of cid which are approaching the HashIndex split
+ * threshold, so that the split does not happen inline (and all at once)
+ * in the transaction which happens to cross it.  we drop the index lock
+ * between steps so that IO on the collection can make progress.
+ */
+void FileStore::_split_ahead(const coll_t& cid)
+{
+  {
+    Mutex::Locker l(split_ahead_lock);
+    split_ahead_pending.erase(cid);
+  }
+  Index index;
+  int r = get_index(cid, &index);
+  if (r < 0) {
+    dout(10) << __func__ << " " << cid << " get_index got "
+	     << cpp_strerror(r) << dendl;
+    return;
+  }
+  assert(NULL != index.index);
+  do {
+    RWLock::WLocker l((index.index)->access_lock);
+    r = index->split_ahead();
+  } while (r > 0);
+  if (r < 0) {
+    dout(0) << __func__ << " " << cid << " split_ahead got "
+	    << cpp_strerror(r) << dendl;
+  } else {
+    dout(15) << __func__ << " " << cid << " done" << dendl;
+  }
+}
+
 int FileStore::lfn_link(const coll_t& c, const coll_t& newcid, const ghobject_t& o, const ghobject_t& newoid)
 {
   Index index_new, index_old;
@@ -523,6 +577,8 @@ FileStore::FileStore(const std::string &base, const std::string &jdev, osflagbit
   throttle_bytes(g_ceph_context, "filestore_bytes", g_conf->filestore_queue_max_bytes),
   m_ondisk_finisher_num(g_conf->filestore_ondisk_finisher_threads),
   m_apply_finisher_num(g_conf->filestore_apply_finisher_threads),
+  split_ahead_finisher(g_ceph_context, "filestore-split", "fn_split_fstore"),
+  split_ahead_lock("FileStore::split_ahead_lock"),
   op_tp(g_ceph_context, "FileStore::op_tp", "tp_fstore_op", g_conf->filestore_op_threads, "filestore_op_threads"),
   op_wq(this, g_conf->filestore_op_thread_timeout,
 	g_conf->filestore_op_thread_suicide_timeout, &op_tp),
@@ -701,9 +757,21 @@ int FileStore::statfs(struct statfs *buf)
 void FileStore::new_journal()
 {
   if (journalpath.length()) {
-    dout(10) << "open_journal at " << journalpath << dendl;
-    journal = new FileJournal(fsid, &finisher, &sync_cond, journalpath.c_str(),
-			      m_journal_dio, m_journal_aio, m_journal_force_aio);
+    list<string> stripe_paths;
+    get_str_list(g_conf->journal_stripe_paths, stripe_paths);
+    if (stripe_paths.empty()) {
+      dout(10) << "open_journal at " << journalpath << dendl;
+      journal = new FileJournal(fsid, &finisher, &sync_cond, journalpath.c_str(),
+				m_journal_dio, m_journal_aio, m_journal_force_aio);
+    } else {
+      vector<string> paths;
+      paths.push_back(journalpath);
+      paths.insert(paths.end(), stripe_paths.begin(), stripe_paths.end());
+      dout(10) << "open_journal striped across " << paths << dendl;
+      journal = new StripedJournal(fsid, &finisher, &sync_cond, paths,
+				   m_journal_dio, m_journal_aio,
+				   m_journal_force_aio);
+    }
     if (journal)
       journal->logger = logger;
   }
@@ -717,7 +785,18 @@ int FileStore::dump_journal(ostream& out)
   if (!journalpath.length())
     return -EINVAL;
 
-  FileJournal *journal = new FileJournal(fsid, &finisher, &sync_cond, journalpath.c_str(), m_journal_dio);
+  Journal *journal;
+  list<string> stripe_paths;
+  get_str_list(g_conf->journal_stripe_paths, stripe_paths);
+  if (stripe_paths.empty()) {
+    journal = new FileJournal(fsid, &finisher, &sync_cond, journalpath.c_str(), m_journal_dio);
+  } else {
+    vector<string> paths;
+    paths.push_back(journalpath);
+    paths.insert(paths.end(), stripe_paths.begin(), stripe_paths.end());
+    journal = new StripedJournal(fsid, &finisher, &sync_cond, paths,
+				 m_journal_dio);
+  }
   r = journal->dump(out);
   delete journal;
   return r;
@@ -1631,6 +1710,7 @@ int FileStore::mount()
   for (vector<Finisher*>::iterator it = apply_finishers.begin(); it != apply_finishers.end(); ++it) {
     (*it)->start();
   }
+  split_ahead_finisher.start();
 
   timer.init();
 
@@ -1724,6 +1804,7 @@ int FileStore::umount()
   sync_thread.join();
   wbthrottle.stop();
   op_tp.stop();
+  split_ahead_finisher.stop();
 
   journal_stop();
   if (!(generic_flags & SKIP_JOURNAL_REPLAY))
@@ -347,6 +347,14 @@ private:
   vector<Finisher*> ondisk_finishers;
   vector<Finisher*> apply_finishers;
 
+  // collections with subdirs to split ahead of time, see HashIndex
+  Finisher split_ahead_finisher;
+  Mutex split_ahead_lock;
+  set<coll_t> split_ahead_pending;
+  void queue_split_ahead(const coll_t& cid);
+  void _split_ahead(const coll_t& cid);
+  friend struct C_SplitAhead;
+
   ThreadPool op_tp;
   struct OpWQ : public ThreadPool::WorkQueue<OpSequencer> {
     FileStore *store;
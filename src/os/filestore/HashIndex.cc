@@ -324,15 +324,32 @@ int HashIndex::_created(const vector<string> &path,
     return r;
 
   if (must_split(info)) {
+    split_ahead_dirs.erase(path);
     int r = initiate_split(path, info);
     if (r < 0)
       return r;
     return complete_split(path, info);
   } else {
+    if (should_split_ahead(info))
+      split_ahead_dirs.insert(path);
     return 0;
   }
 }
 
+int HashIndex::_split_ahead() {
+  while (!split_ahead_dirs.empty()) {
+    vector<string> path = *split_ahead_dirs.begin();
+    int r = split_ahead_step(path);
+    if (r <= 0)
+      split_ahead_dirs.erase(path);
+    if (r < 0)
+      return r;
+    if (r > 0)
+      break;
+  }
+  return !split_ahead_dirs.empty();
+}
+
 int HashIndex::_remove(const vector<string> &path,
 		       const ghobject_t &oid,
 		       const string &mangled_name) {
@@ -638,6 +655,108 @@ bool HashIndex::must_split(const subdir_info_s &info) {
 
 }
 
+bool HashIndex::should_split_ahead(const subdir_info_s &info) {
+  return (split_ahead_ratio > 0 &&
+	  info.hash_level < (unsigned)MAX_HASH_LEVEL &&
+	  info.objs > split_ahead_ratio * (unsigned)(abs(merge_threshold)) *
+	              16 * split_multiplier);
+}
+
+int HashIndex::split_ahead_step(const vector<string> &path) {
+  int exists;
+  int r = path_exists(path, &exists);
+  if (r < 0)
+    return r;
+  if (!exists)
+    return 0;  // merged or removed in the meantime
+  subdir_info_s info;
+  r = get_info(path, &info);
+  if (r < 0)
+    return r;
+  if (!should_split_ahead(info))
+    return 0;
+
+  int level = info.hash_level;
+  map<string, ghobject_t> objects;
+  r = list_objects(path, 0, 0, &objects);
+  if (r < 0)
+    return r;
+  vector<string> subdirs_vec;
+  r = list_subdirs(path, &subdirs_vec);
+  if (r < 0)
+    return r;
+  set<string> subdirs;
+  subdirs.insert(subdirs_vec.begin(), subdirs_vec.end());
+
+  // objects whose subdir already exists would be looked up there, so
+  // everything left in path belongs to a subdir that does not exist
+  // yet.  pick the largest group that complete_split would also move.
+  map<string, map<string, ghobject_t> > mapped;
+  for (map<string, ghobject_t>::iterator i = objects.begin();
+       i != objects.end();
+       ++i) {
+    vector<string> new_path;
+    get_path_components(i->second, &new_path);
+    mapped[new_path[level]][i->first] = i->second;
+  }
+  map<string, map<string, ghobject_t> >::iterator best = mapped.end();
+  for (map<string, map<string, ghobject_t> >::iterator i = mapped.begin();
+       i != mapped.end();
+       ++i) {
+    if (subdirs.count(i->first))
+      continue;
+    if (best == mapped.end() || i->second.size() > best->second.size())
+      best = i;
+  }
+  subdir_info_s info_new;
+  info_new.hash_level = level + 1;
+  if (best != mapped.end())
+    info_new.objs = best->second.size();
+  if (best == mapped.end() || must_merge(info_new))
+    return 0;
+
+  // tag the split so that cleanup() completes it if we crash part way
+  r = start_split(path);
+  if (r < 0)
+    return r;
+  vector<string> dst = path;
+  dst.push_back(best->first);
+  r = create_path(dst);
+  if (r < 0)
+    return r;
+  for (map<string, ghobject_t>::iterator j = best->second.begin();
+       j != best->second.end();
+       ++j) {
+    objects.erase(j->first);
+    r = link_object(path, dst, j->second, j->first);
+    if (r < 0 && r != -EEXIST)
+      return r;
+  }
+  r = fsync_dir(dst);
+  if (r < 0)
+    return r;
+  // Presence of info must imply that all objects have been copied
+  r = set_info(dst, info_new);
+  if (r < 0)
+    return r;
+  r = fsync_dir(dst);
+  if (r < 0)
+    return r;
+  r = remove_objects(path, best->second, &objects);
+  if (r < 0)
+    return r;
+  r = reset_attr(path);
+  if (r < 0)
+    return r;
+  r = fsync_dir(path);
+  if (r < 0)
+    return r;
+  r = end_split_or_merge(path);
+  if (r < 0)
+    return r;
+  return 1;
+}
+
 int HashIndex::initiate_merge(const vector<string> &path, subdir_info_s info) {
   return start_merge(path);
 }
@@ -46,6 +46,12 @@ extern string reverse_hexdigit_bits_string(string l);
  * Subdirectories are created when the number of objects in a directory
  * exceed (abs(merge_threshhold)) * 16 * split_multiplier.  The number of objects in a directory
  * is encoded as subdir_info_s in an xattr on the directory.
+ *
+ * If split_ahead_ratio is set, directories which pass that fraction of
+ * the split threshold are remembered and may be split early, one child
+ * subdir at a time, via split_ahead().  Each step leaves the directory
+ * in a consistent (partially split) state, so the caller can let IO
+ * through between steps rather than stalling on one large split.
  */
 class HashIndex : public LFNIndex {
 private:
@@ -66,6 +72,10 @@ private:
    */
   int merge_threshold;
   int split_multiplier;
+  double split_ahead_ratio;
+
+  /// subdirs which have passed the split ahead threshold
+  set<vector<string> > split_ahead_dirs;
 
   /// Encodes current subdir state for determining when to split/merge.
   struct subdir_info_s {
@@ -139,10 +149,12 @@ public:
     int merge_at,          ///< [in] Merge threshhold.
     int split_multiple,	   ///< [in] Split threshhold.
     uint32_t index_version,///< [in] Index version
-    double retry_probability=0) ///< [in] retry probability
+    double retry_probability=0, ///< [in] retry probability
+    double split_ahead=0)  ///< [in] fraction of split threshold to split ahead at
     : LFNIndex(collection, base_path, index_version, retry_probability),
       merge_threshold(merge_at),
-      split_multiplier(split_multiple) {}
+      split_multiplier(split_multiple),
+      split_ahead_ratio(split_ahead) {}
 
   /// @see CollectionIndex
   uint32_t collection_version() { return index_version; }
@@ -153,6 +165,11 @@ public:
   /// @see CollectionIndex
   int prep_delete();
 
+  /// @see CollectionIndex
+  bool want_split_ahead() {
+    return !split_ahead_dirs.empty();
+  }
+
   /// @see CollectionIndex
   int _split(
     uint32_t match,
@@ -163,6 +180,8 @@ public:
 protected:
   int _init();
 
+  int _split_ahead();
+
   int _created(
     const vector<string> &path,
     const ghobject_t &oid,
@@ -240,6 +259,16 @@ private:
     const subdir_info_s &info ///< [in] Info to check
     ); /// @return True if info must be split, False otherwise
 
+  /// Encapsulates logic for when to split ahead of must_split
+  bool should_split_ahead(
+    const subdir_info_s &info ///< [in] Info to check
+    ); /// @return True if info should be split in the background
+
+  /// Moves the largest group of objects in path into its own subdir
+  int split_ahead_step(
+    const vector<string> &path ///< [in] Subdir to split
+    ); /// @return < 0 on error, 0 if path is fully split, 1 otherwise
+
   /// Initiates merge
   int initiate_merge(
     const vector<string> &path, ///< [in] Subdir to merge
@@ -212,10 +212,21 @@ public:
       );
   }
 
+  /// @see CollectionIndex
+  int split_ahead() {
+    WRAP_RETRY(
+      r = _split_ahead();
+      goto out;
+      );
+  }
+
 
 protected:
   virtual int _init() = 0;
 
+  /// Will be called to split subdirs ahead of time @see split_ahead
+  virtual int _split_ahead() { return 0; }
+
   /// Will be called upon object creation
   virtual int _created(
     const vector<string> &path, ///< [in] Path to subdir.
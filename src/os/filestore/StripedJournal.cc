@@ -0,0 +1,286 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include "StripedJournal.h"
+#include "common/debug.h"
+#include "common/errno.h"
+
+#define dout_subsys ceph_subsys_journal
+#undef dout_prefix
+#define dout_prefix *_dout << "journal striped "
+
+struct C_StripeJournaled : public Context {
+  StripedJournal *journal;
+  uint64_t seq;
+  C_StripeJournaled(StripedJournal *j, uint64_t s) : journal(j), seq(s) {}
+  void finish(int r) {
+    journal->entry_journaled(seq);
+  }
+};
+
+StripedJournal::StripedJournal(uuid_d fsid, Finisher *fin, Cond *sync_cond,
+			       const vector<string>& paths,
+			       bool dio, bool ai, bool faio)
+  : Journal(fsid, fin, sync_cond),
+    completions_lock("StripedJournal::completions_lock"),
+    replay_seq(0),
+    replay_generation(0)
+{
+  assert(!paths.empty());
+  for (unsigned i = 0; i < paths.size(); ++i) {
+    FileJournal *j = new FileJournal(fsid, fin, sync_cond, paths[i].c_str(),
+				     dio, ai, faio);
+    j->set_seq_stride(paths.size(), i);
+    stripes.push_back(j);
+  }
+}
+
+StripedJournal::~StripedJournal()
+{
+  for (vector<FileJournal*>::iterator p = stripes.begin();
+       p != stripes.end();
+       ++p)
+    delete *p;
+}
+
+void StripedJournal::update_stripes()
+{
+  // logger and wait_on_full are set on us after construction
+  for (vector<FileJournal*>::iterator p = stripes.begin();
+       p != stripes.end();
+       ++p) {
+    (*p)->logger = logger;
+    (*p)->set_wait_on_full(wait_on_full);
+  }
+}
+
+void StripedJournal::entry_journaled(uint64_t seq)
+{
+  list<Context*> ls;
+  {
+    Mutex::Locker l(completions_lock);
+    map<uint64_t, completion_item>::iterator p = completions.find(seq);
+    assert(p != completions.end());
+    p->second.journaled = true;
+    while (!completions.empty() && completions.begin()->second.journaled) {
+      dout(20) << __func__ << " completing seq " << completions.begin()->first
+	       << dendl;
+      if (completions.begin()->second.oncommit)
+	ls.push_back(completions.begin()->second.oncommit);
+      completions.erase(completions.begin());
+    }
+  }
+  // we are already in the finisher thread, as the stripe's completion
+  // would have been.
+  finish_contexts(g_ceph_context, ls, 0);
+}
+
+int StripedJournal::check()
+{
+  for (vector<FileJournal*>::iterator p = stripes.begin();
+       p != stripes.end();
+       ++p) {
+    int r = (*p)->check();
+    if (r < 0)
+      return r;
+  }
+  return 0;
+}
+
+int StripedJournal::create()
+{
+  update_stripes();
+  for (vector<FileJournal*>::iterator p = stripes.begin();
+       p != stripes.end();
+       ++p) {
+    int r = (*p)->create();
+    if (r < 0)
+      return r;
+  }
+  return 0;
+}
+
+int StripedJournal::open(uint64_t fs_op_seq)
+{
+  dout(2) << __func__ << " " << stripes.size() << " stripes, fs_op_seq "
+	  << fs_op_seq << dendl;
+  update_stripes();
+  replay_seq = fs_op_seq;
+  for (unsigned i = 0; i < stripes.size(); ++i) {
+    int r = stripes[i]->open(fs_op_seq);
+    if (r < 0) {
+      while (i-- > 0)
+	stripes[i]->close();
+      return r;
+    }
+  }
+  // prepare_entry() pads entries before we know their stripe
+  for (unsigned i = 1; i < stripes.size(); ++i) {
+    if (stripes[i]->get_alignment() != stripes[0]->get_alignment()) {
+      derr << __func__ << " stripe " << i << " alignment "
+	   << stripes[i]->get_alignment() << " != stripe 0 alignment "
+	   << stripes[0]->get_alignment() << dendl;
+      for (unsigned j = 0; j < stripes.size(); ++j)
+	stripes[j]->close();
+      return -EINVAL;
+    }
+  }
+  // the stripes have read past the committed entries
+  replay_generation = 0;
+  for (unsigned i = 0; i < stripes.size(); ++i)
+    replay_generation = MAX(replay_generation,
+			    stripes[i]->get_read_generation());
+  return 0;
+}
+
+void StripedJournal::close()
+{
+  for (vector<FileJournal*>::iterator p = stripes.begin();
+       p != stripes.end();
+       ++p)
+    (*p)->close();
+}
+
+void StripedJournal::flush()
+{
+  for (vector<FileJournal*>::iterator p = stripes.begin();
+       p != stripes.end();
+       ++p)
+    (*p)->flush();
+}
+
+void StripedJournal::throttle()
+{
+  for (vector<FileJournal*>::iterator p = stripes.begin();
+       p != stripes.end();
+       ++p)
+    (*p)->throttle();
+}
+
+int StripedJournal::dump(ostream& out)
+{
+  for (vector<FileJournal*>::iterator p = stripes.begin();
+       p != stripes.end();
+       ++p) {
+    int r = (*p)->dump(out);
+    if (r < 0)
+      return r;
+  }
+  return 0;
+}
+
+bool StripedJournal::is_writeable()
+{
+  for (vector<FileJournal*>::iterator p = stripes.begin();
+       p != stripes.end();
+       ++p)
+    if (!(*p)->is_writeable())
+      return false;
+  return true;
+}
+
+int StripedJournal::make_writeable()
+{
+  update_stripes();
+  // anything the stripes hold past replay_seq is from an older
+  // generation than what we are about to write
+  uint64_t generation = 0;
+  for (vector<FileJournal*>::iterator p = stripes.begin();
+       p != stripes.end();
+       ++p)
+    generation = MAX(generation, (*p)->get_generation());
+  ++generation;
+  dout(2) << __func__ << " replayed thru " << replay_seq
+	  << ", generation " << generation << dendl;
+  for (vector<FileJournal*>::iterator p = stripes.begin();
+       p != stripes.end();
+       ++p) {
+    (*p)->set_generation(generation);
+    int r = (*p)->make_writeable();
+    if (r < 0)
+      return r;
+  }
+  return 0;
+}
+
+void StripedJournal::submit_entry(uint64_t seq, bufferlist& e,
+				  uint32_t orig_len, Context *oncommit,
+				  TrackedOpRef osd_op)
+{
+  dout(5) << __func__ << " seq " << seq << " to stripe "
+	  << (seq % stripes.size()) << dendl;
+  {
+    Mutex::Locker l(completions_lock);
+    assert(completions.empty() || completions.rbegin()->first < seq);
+    completions.insert(make_pair(seq, completion_item(oncommit)));
+  }
+  get_stripe(seq)->submit_entry(seq, e, orig_len,
+				new C_StripeJournaled(this, seq), osd_op);
+}
+
+void StripedJournal::commit_start(uint64_t seq)
+{
+  for (vector<FileJournal*>::iterator p = stripes.begin();
+       p != stripes.end();
+       ++p)
+    (*p)->commit_start(seq);
+}
+
+void StripedJournal::committed_thru(uint64_t seq)
+{
+  for (vector<FileJournal*>::iterator p = stripes.begin();
+       p != stripes.end();
+       ++p)
+    (*p)->committed_thru(seq);
+}
+
+bool StripedJournal::read_entry(bufferlist &bl, uint64_t &seq)
+{
+  uint64_t want = MAX(seq, replay_seq + 1);
+  uint64_t got = want;
+  FileJournal *stripe = get_stripe(want);
+  // an entry older than one we already returned was never acked
+  stripe->set_read_generation(replay_generation);
+  if (!stripe->read_entry(bl, got)) {
+    dout(10) << __func__ << " no seq " << want << " in stripe "
+	     << (want % stripes.size()) << ", end of journal" << dendl;
+    return false;
+  }
+  if (got != want) {
+    // a torn entry; nothing past it was acked
+    dout(2) << __func__ << " expected seq " << want << " in stripe "
+	    << (want % stripes.size()) << ", found " << got
+	    << ", end of journal" << dendl;
+    return false;
+  }
+  replay_seq = got;
+  replay_generation = stripe->get_read_generation();
+  seq = got;
+  return true;
+}
+
+bool StripedJournal::should_commit_now()
+{
+  for (vector<FileJournal*>::iterator p = stripes.begin();
+       p != stripes.end();
+       ++p)
+    if ((*p)->should_commit_now())
+      return true;
+  return false;
+}
+
+int StripedJournal::prepare_entry(vector<ObjectStore::Transaction>& tls,
+				  bufferlist* tbl)
+{
+  // every stripe has the same alignment; see open()
+  return stripes[0]->prepare_entry(tls, tbl);
+}
@@ -0,0 +1,101 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+
+#ifndef CEPH_STRIPEDJOURNAL_H
+#define CEPH_STRIPEDJOURNAL_H
+
+#include <map>
+#include <vector>
+
+#include "Journal.h"
+#include "FileJournal.h"
+#include "common/Mutex.h"
+
+/**
+ * Stripes journal entries across several FileJournals.
+ *
+ * Entry seq lives in stripe (seq % num_stripes), so each stripe is an
+ * ordinary FileJournal holding every num_stripes'th entry, with its own
+ * write thread and aio context.  Replay reads the stripes round robin
+ * and so returns entries in seq order; it stops at the first seq
+ * missing from its stripe, even if later entries made it to other
+ * stripes, which is fine because those were never acked.  Those later
+ * entries must not be replayed once new entries fill the gap, so
+ * make_writeable() bumps a generation kept in the stripe headers and
+ * stamped into each entry; replay stops at an entry older than one it
+ * has already returned.  A stripe that stops on such an entry (or on a
+ * seq past the one expected) leaves it to be overwritten.
+ *
+ * Stripes may complete entries out of order.  We hold the caller's
+ * oncommit contexts and complete them in seq order, so that FileStore
+ * sees the same ordering as with a single journal.  commit_start and
+ * committed_thru are passed to every stripe.
+ *
+ * All stripes must have the same alignment (prepare_entry pads the
+ * entry before we know which stripe it goes to; open() checks), and the
+ * number of stripes must not change without recreating the journals.
+ */
+class StripedJournal : public Journal {
+  vector<FileJournal*> stripes;
+
+  struct completion_item {
+    Context *oncommit;
+    bool journaled;
+    explicit completion_item(Context *c) : oncommit(c), journaled(false) {}
+  };
+  Mutex completions_lock;
+  map<uint64_t, completion_item> completions;  ///< by seq
+
+  uint64_t replay_seq;  ///< last seq returned by read_entry
+  uint64_t replay_generation;  ///< newest generation read_entry returned
+
+  FileJournal *get_stripe(uint64_t seq) {
+    return stripes[seq % stripes.size()];
+  }
+  void update_stripes();
+
+public:
+  StripedJournal(uuid_d fsid, Finisher *fin, Cond *sync_cond,
+		 const vector<string>& paths,
+		 bool dio=false, bool ai=true, bool faio=false);
+  ~StripedJournal();
+
+  /// called (via the finisher) when a stripe has journaled seq
+  void entry_journaled(uint64_t seq);
+
+  int check();
+  int create();
+  int open(uint64_t fs_op_seq);
+  void close();
+
+  void flush();
+  void throttle();
+
+  int dump(ostream& out);
+
+  bool is_writeable();
+  int make_writeable();
+  void submit_entry(uint64_t seq, bufferlist& e, uint32_t orig_len,
+		    Context *oncommit,
+		    TrackedOpRef osd_op = TrackedOpRef());
+  void commit_start(uint64_t seq);
+  void committed_thru(uint64_t seq);
+
+  bool read_entry(bufferlist &bl, uint64_t &seq);
+
+  bool should_commit_now();
+
+  int prepare_entry(vector<ObjectStore::Transaction>& tls, bufferlist* tbl);
+};
+
+#endif
@@ -2792,16 +2792,23 @@ PG *OSD::_open_lock_pg(
   assert(osd_lock.is_locked());
 
   PG* pg = _make_pg(createmap, pgid);
-  {
-    RWLock::WLocker l(pg_map_lock);
-    pg->lock(no_lockdep_check);
-    pg_map[pgid] = pg;
-    pg->get("PGMap");  // because it's in pg_map
-    service.pg_add_epoch(pg->info.pgid, createmap->get_epoch());
-  }
+  _register_lock_pg(createmap, pg, no_lockdep_check);
   return pg;
 }
 
+void OSD::_register_lock_pg(
+  OSDMapRef createmap,
+  PG *pg, bool no_lockdep_check)
+{
+  assert(osd_lock.is_locked());
+
+  RWLock::WLocker l(pg_map_lock);
+  pg->lock(no_lockdep_check);
+  pg_map[pg->pg_id] = pg;
+  pg->get("PGMap");  // because it's in pg_map
+  service.pg_add_epoch(pg->info.pgid, createmap->get_epoch());
+}
+
 PG* OSD::_make_pg(
   OSDMapRef createmap,
   spg_t pgid)
@@ -3023,6 +3030,8 @@ void OSD::load_pgs()
   }
 
   bool has_upgraded = false;
+  list<pair<PG*, bufferlist> > to_read;
+  map<PG*, OSDMapRef> createmaps;
 
   for (vector<coll_t>::iterator it = ls.begin();
        it != ls.end();
@@ -3074,16 +3083,30 @@ void OSD::load_pgs()
 	  assert(0 == "Missing map in load_pgs");
 	}
       }
-      pg = _open_lock_pg(pgosdmap, pgid);
+      pg = _make_pg(pgosdmap, pgid);
+      createmaps[pg] = pgosdmap;
     } else {
-      pg = _open_lock_pg(osdmap, pgid);
+      pg = _make_pg(osdmap, pgid);
+      createmaps[pg] = osdmap;
     }
-    // there can be no waiters here, so we don't call wake_pg_waiters
 
     pg->ch = store->open_collection(pg->coll);
+    to_read.push_back(make_pair(pg, bl));
+  }
 
-    // read pg state, log
-    pg->read_state(store, bl);
+  // read pg state, log.  this is where most of the time goes.  the pgs
+  // are not in pg_map yet, so nothing else can see them and they need
+  // not be locked.
+  read_pg_states(to_read);
+
+  for (list<pair<PG*, bufferlist> >::iterator p = to_read.begin();
+       p != to_read.end();
+       ++p) {
+    PG *pg = p->first;
+    spg_t pgid = pg->pg_id;
+
+    _register_lock_pg(createmaps[pg], pg);
+    // there can be no waiters here, so we don't call wake_pg_waiters
 
     if (pg->must_upgrade()) {
       if (!pg->can_upgrade()) {
@@ -3144,6 +3167,48 @@ void OSD::load_pgs()
   build_past_intervals_parallel();
 }
 
+struct C_ReadPGState : public Context {
+  PG *pg;
+  ObjectStore *store;
+  bufferlist bl;
+  C_ReadPGState(PG *pg, ObjectStore *store, const bufferlist& bl)
+    : pg(pg), store(store), bl(bl) {}
+  void finish(int r) {
+    pg->read_state(store, bl);
+  }
+};
+
+/*
+ * read the info and log for each newly made pg.  the pgs are
+ * independent, so spread the reads over osd_load_pgs_threads threads;
+ * this dominates startup time for osds with many pgs and long logs.
+ * the pgs are not registered in pg_map until all reads are complete,
+ * so no pg lock is needed (or held) here.
+ */
+void OSD::read_pg_states(list<pair<PG*, bufferlist> >& pgs)
+{
+  int num_threads = MIN(cct->_conf->osd_load_pgs_threads, (int)pgs.size());
+  if (num_threads <= 1) {
+    for (list<pair<PG*, bufferlist> >::iterator p = pgs.begin();
+	 p != pgs.end();
+	 ++p)
+      p->first->read_state(store, p->second);
+    return;
+  }
+
+  dout(10) << __func__ << " reading " << pgs.size() << " pgs with "
+	   << num_threads << " threads" << dendl;
+  ThreadPool tp(cct, "OSD::load_pgs_tp", "tp_osd_load", num_threads);
+  ContextWQ wq("OSD::load_pgs_wq", cct->_conf->osd_op_thread_timeout, &tp);
+  for (list<pair<PG*, bufferlist> >::iterator p = pgs.begin();
+       p != pgs.end();
+       ++p)
+    wq.queue(new C_ReadPGState(p->first, store, p->second));
+  tp.start();
+  wq.drain();
+  tp.stop();
+}
+
 
 /*
  * build past_intervals efficiently on old, degraded, and buried
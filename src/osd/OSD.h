@@ -1904,6 +1904,8 @@ protected:
   PG   *_lookup_pg(spg_t pgid);
   PG   *_open_lock_pg(OSDMapRef createmap,
 		      spg_t pg, bool no_lockdep_check=false);
+  void _register_lock_pg(OSDMapRef createmap,
+			 PG *pg, bool no_lockdep_check=false);
   enum res_result {
     RES_PARENT,    // resurrected a parent
     RES_SELF,      // resurrected self
@@ -1943,6 +1945,7 @@ protected:
     PG::CephPeeringEvtRef evt);
   
   void load_pgs();
+  void read_pg_states(list<pair<PG*, bufferlist> >& pgs);
   void build_past_intervals_parallel();
 
   /// project pg history from from to now
@@ -2627,6 +2627,133 @@ bool OSDMap::crush_ruleset_in_use(int ruleset) const
   return false;
 }
 
+int OSDMap::calc_pg_balance_weights(const set<int64_t>& only_pools,
+				    int max_iterations, float max_change,
+				    map<int,unsigned> *new_weights,
+				    ostream *ss) const
+{
+  if (max_iterations < 1 || max_change <= 0 || max_change >= 1) {
+    *ss << "max_iterations must be >= 1 and max_change in (0, 1)";
+    return -EINVAL;
+  }
+
+  // expected pg copies per osd, summed over the pools
+  vector<double> target(max_osd, 0);
+  set<int64_t> balance_pools;
+  for (map<int64_t,pg_pool_t>::const_iterator p = pools.begin();
+       p != pools.end(); ++p) {
+    if (!only_pools.empty() && only_pools.count(p->first) == 0)
+      continue;
+    int ruleno = crush->find_rule(p->second.get_crush_ruleset(),
+				  p->second.get_type(),
+				  p->second.get_size());
+    if (ruleno < 0)
+      continue;
+    map<int,float> wm;
+    if (crush->get_rule_weight_osd_map(ruleno, &wm) < 0)
+      continue;
+    double sum = 0;
+    for (map<int,float>::iterator q = wm.begin(); q != wm.end(); ++q) {
+      if (q->first < max_osd && is_in(q->first))
+	sum += q->second;
+    }
+    if (sum <= 0)
+      continue;
+    double copies = (double)p->second.get_pg_num() * p->second.get_size();
+    for (map<int,float>::iterator q = wm.begin(); q != wm.end(); ++q) {
+      if (q->first < max_osd && is_in(q->first))
+	target[q->first] += copies * q->second / sum;
+    }
+    balance_pools.insert(p->first);
+  }
+  if (balance_pools.empty()) {
+    *ss << "no pools to balance";
+    return -ENOENT;
+  }
+
+  int num_osds = 0;
+  for (int o = 0; o < max_osd; ++o) {
+    if (target[o] > 0)
+      ++num_osds;
+  }
+
+  OSDMap tmp;
+  tmp.deepish_copy_from(*this);
+  vector<unsigned> weights(osd_weight.begin(), osd_weight.end());
+  vector<unsigned> best_weights = weights;
+  double orig_dev = 0, best_dev = 0;
+  int best_iteration = 0;
+
+  for (int iteration = 0; ; ++iteration) {
+    for (int o = 0; o < max_osd; ++o) {
+      if (target[o] > 0)
+	tmp.set_weight(o, weights[o]);
+    }
+
+    // raw crush placement is what the reweights steer; ignore up/down
+    // state and temp mappings so the result is stable offline
+    vector<int> count(max_osd, 0);
+    for (set<int64_t>::iterator p = balance_pools.begin();
+	 p != balance_pools.end(); ++p) {
+      const pg_pool_t *pool = tmp.get_pg_pool(*p);
+      for (ps_t ps = 0; ps < pool->get_pg_num(); ++ps) {
+	vector<int> raw;
+	int primary;
+	tmp.pg_to_osds(pg_t(ps, *p, -1), &raw, &primary);
+	for (vector<int>::iterator q = raw.begin(); q != raw.end(); ++q) {
+	  if (*q >= 0 && *q < max_osd)
+	    ++count[*q];
+	}
+      }
+    }
+
+    double dev = 0;
+    for (int o = 0; o < max_osd; ++o) {
+      if (target[o] > 0)
+	dev += (count[o] - target[o]) * (count[o] - target[o]);
+    }
+    dev = sqrt(dev / num_osds);
+    if (iteration == 0) {
+      orig_dev = best_dev = dev;
+    } else if (dev < best_dev) {
+      best_dev = dev;
+      best_weights = weights;
+      best_iteration = iteration;
+    }
+    if (iteration == max_iterations)
+      break;
+
+    unsigned max_weight = 0;
+    for (int o = 0; o < max_osd; ++o) {
+      if (target[o] <= 0)
+	continue;
+      double ratio = count[o] ? target[o] / count[o] : 1.0 + max_change;
+      ratio = MAX(1.0 - max_change, MIN(1.0 + max_change, ratio));
+      double w = (double)weights[o] * ratio;
+      weights[o] = (unsigned)MAX(1.0, MIN((double)CEPH_OSD_IN * 2, w));
+      max_weight = MAX(max_weight, weights[o]);
+    }
+    // only the ratios matter to crush, but reweights cannot exceed 1.0 and
+    // lower ones make crush retry more: keep the largest at 1.0
+    if (max_weight != CEPH_OSD_IN) {
+      for (int o = 0; o < max_osd; ++o) {
+	if (target[o] > 0)
+	  weights[o] = MAX(1, (uint64_t)weights[o] * CEPH_OSD_IN / max_weight);
+      }
+    }
+  }
+
+  new_weights->clear();
+  for (int o = 0; o < max_osd; ++o) {
+    if (target[o] > 0 && best_weights[o] != osd_weight[o])
+      (*new_weights)[o] = best_weights[o];
+  }
+  *ss << "pg count stddev " << orig_dev << " -> " << best_dev
+      << " after " << best_iteration << "/" << max_iterations
+      << " iterations, " << new_weights->size() << " osds reweighted";
+  return new_weights->size();
+}
+
 int OSDMap::build_simple(CephContext *cct, epoch_t e, uuid_d &fsid,
 			  int nosd, int pg_bits, int pgp_bits)
 {
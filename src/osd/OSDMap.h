@@ -577,6 +577,20 @@ public:
    */
   uint64_t get_up_osd_features() const;
 
+  /**
+   * get the subset of feature bits that affect how an OSDMap or
+   * Incremental is encoded.  peers that agree on these can be sent
+   * the same encoded buffers.
+   */
+  static uint64_t get_significant_features(uint64_t features) {
+    if (features & CEPH_FEATURE_OSDMAP_ENC)
+      return CEPH_FEATURE_OSDMAP_ENC;   // canonical encoding
+    return features & (CEPH_FEATURE_PGID64 |
+		       CEPH_FEATURE_PGPOOL3 |
+		       CEPH_FEATURE_OSDENC |
+		       CEPH_FEATURE_OSD_POOLRESEND);
+  }
+
   int apply_incremental(const Incremental &inc);
 
   /// try to re-use/reference addrs in oldmap from newmap
@@ -853,6 +867,28 @@ public:
 
   bool crush_ruleset_in_use(int ruleset) const;
 
+  /**
+   * search for osd reweight values that even out the pg distribution
+   *
+   * Starting from the current reweights, repeatedly map every pg of
+   * the selected pools through CRUSH and scale each in osd's reweight
+   * by the ratio of its expected pg count (from its crush weight share
+   * of each pool's rule) to its mapped pg count.  No step changes a
+   * reweight by more than max_change, and reweights are renormalized
+   * so the largest is 1.0.  The best set of weights seen is returned.
+   *
+   * @param only_pools [in] pools to balance, or empty for all pools
+   * @param max_iterations [in] number of adjustment rounds
+   * @param max_change [in] max fractional reweight change per round
+   * @param new_weights [out] osds whose reweight should change
+   * @param ss [out] human readable summary
+   * @return number of osds in new_weights, or negative error code
+   */
+  int calc_pg_balance_weights(const set<int64_t>& only_pools,
+			      int max_iterations, float max_change,
+			      map<int,unsigned> *new_weights,
+			      ostream *ss) const;
+
   void clear_temp() {
     pg_temp->clear();
     primary_temp->clear();
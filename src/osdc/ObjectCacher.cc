@@ -745,7 +745,7 @@ void ObjectCacher::bh_read_finish(int64_t poolid, sobject_t oid,
       //   reply to unrelated 3~1 -> !exists
       //   read 1~1 -> immediate ENOENT
       //   reply to first 1~1 -> ooo ENOENT
-      bool allzero = true;
+      bool allzero = ob->is_all_zero_or_rx();
       for (map<loff_t, BufferHead*>::iterator p = ob->data.begin();
 	   p != ob->data.end(); ++p) {
 	BufferHead *bh = p->second;
@@ -755,8 +755,6 @@ void ObjectCacher::bh_read_finish(int64_t poolid, sobject_t oid,
 	     ++p)
 	  ls.splice(ls.end(), p->second);
 	bh->waitfor_read.clear();
-	if (!bh->is_zero() && !bh->is_rx())
-	  allzero = false;
       }
 
       // just pass through and retry all waiters if we don't trust
@@ -1277,7 +1275,8 @@ int ObjectCacher::_readx(OSDRead *rd, ObjectSet *oset, Context *onfinish,
       ldout(cct, 10) << "readx  object !exists, 1 extent..." << dendl;
 
       // should we worry about COW underneath us?
-      if (writeback_handler.may_copy_on_write(soid.oid, ex_it->offset,
+      if (o->dirty_or_tx &&
+	  writeback_handler.may_copy_on_write(soid.oid, ex_it->offset,
 					      ex_it->length, soid.snap)) {
 	ldout(cct, 20) << "readx  may copy on write" << dendl;
 	bool wait = false;
@@ -1310,17 +1309,7 @@ int ObjectCacher::_readx(OSDRead *rd, ObjectSet *oset, Context *onfinish,
       }
 
       // can we return ENOENT?
-      bool allzero = true;
-      for (map<loff_t, BufferHead*>::iterator bh_it = o->data.begin();
-	   bh_it != o->data.end();
-	   ++bh_it) {
-	ldout(cct, 20) << "readx  ob has bh " << *bh_it->second << dendl;
-	if (!bh_it->second->is_zero() && !bh_it->second->is_rx()) {
-	  allzero = false;
-	  break;
-	}
-      }
-      if (allzero) {
+      if (o->is_all_zero_or_rx()) {
 	ldout(cct, 10) << "readx  ob has all zero|rx, returning ENOENT"
 		       << dendl;
 	delete rd;
@@ -1835,13 +1824,8 @@ bool ObjectCacher::set_is_cached(ObjectSet *oset)
   for (xlist<Object*>::iterator p = oset->objects.begin();
        !p.end(); ++p) {
     Object *ob = *p;
-    for (map<loff_t,BufferHead*>::iterator q = ob->data.begin();
-	 q != ob->data.end();
-	 ++q) {
-      BufferHead *bh = q->second;
-      if (!bh->is_dirty() && !bh->is_tx())
-	return true;
-    }
+    if (ob->has_clean_bytes())
+      return true;
   }
 
   return false;
@@ -1850,23 +1834,7 @@ bool ObjectCacher::set_is_cached(ObjectSet *oset)
 bool ObjectCacher::set_is_dirty_or_committing(ObjectSet *oset)
 {
   assert(lock.is_locked());
-  if (oset->objects.empty())
-    return false;
-
-  for (xlist<Object*>::iterator i = oset->objects.begin();
-       !i.end(); ++i) {
-    Object *ob = *i;
-
-    for (map<loff_t,BufferHead*>::iterator p = ob->data.begin();
-	 p != ob->data.end();
-	 ++p) {
-      BufferHead *bh = p->second;
-      if (bh->is_dirty() || bh->is_tx())
-	return true;
-    }
-  }
-
-  return false;
+  return oset->dirty_or_tx > 0;
 }
 
 
@@ -2349,10 +2317,14 @@ void ObjectCacher::verify_stats() const
 	 p != i->end();
 	 ++p) {
       Object *ob = p->second;
+      loff_t ob_bytes = 0, ob_zero_or_rx = 0;
       for (map<loff_t, BufferHead*>::const_iterator q = ob->data.begin();
 	   q != ob->data.end();
 	  ++q) {
 	BufferHead *bh = q->second;
+	ob_bytes += bh->length();
+	if (bh->is_zero() || bh->is_rx())
+	  ob_zero_or_rx += bh->length();
 	switch (bh->get_state()) {
 	case BufferHead::STATE_MISSING:
 	  missing += bh->length();
@@ -2379,6 +2351,8 @@ void ObjectCacher::verify_stats() const
 	  assert(0);
 	}
       }
+      assert(ob_bytes == ob->bytes);
+      assert(ob_zero_or_rx == ob->zero_or_rx);
     }
   }
 
@@ -2406,6 +2380,7 @@ void ObjectCacher::bh_stat_add(BufferHead *bh)
     break;
   case BufferHead::STATE_ZERO:
     stat_zero += bh->length();
+    bh->ob->zero_or_rx += bh->length();
     break;
   case BufferHead::STATE_DIRTY:
     stat_dirty += bh->length();
@@ -2419,6 +2394,7 @@ void ObjectCacher::bh_stat_add(BufferHead *bh)
     break;
   case BufferHead::STATE_RX:
     stat_rx += bh->length();
+    bh->ob->zero_or_rx += bh->length();
     break;
   case BufferHead::STATE_ERROR:
     stat_error += bh->length();
@@ -2426,6 +2402,7 @@ void ObjectCacher::bh_stat_add(BufferHead *bh)
   default:
     assert(0 == "bh_stat_add: invalid bufferhead state");
   }
+  bh->ob->bytes += bh->length();
   if (get_stat_dirty_waiting() > 0)
     stat_cond.Signal();
 }
@@ -2442,6 +2419,7 @@ void ObjectCacher::bh_stat_sub(BufferHead *bh)
     break;
   case BufferHead::STATE_ZERO:
     stat_zero -= bh->length();
+    bh->ob->zero_or_rx -= bh->length();
     break;
   case BufferHead::STATE_DIRTY:
     stat_dirty -= bh->length();
@@ -2455,6 +2433,7 @@ void ObjectCacher::bh_stat_sub(BufferHead *bh)
     break;
   case BufferHead::STATE_RX:
     stat_rx -= bh->length();
+    bh->ob->zero_or_rx -= bh->length();
     break;
   case BufferHead::STATE_ERROR:
     stat_error -= bh->length();
@@ -2462,6 +2441,7 @@ void ObjectCacher::bh_stat_sub(BufferHead *bh)
   default:
     assert(0 == "bh_stat_sub: invalid bufferhead state");
   }
+  bh->ob->bytes -= bh->length();
 }
 
 void ObjectCacher::bh_set_state(BufferHead *bh, int s)
@@ -249,6 +249,8 @@ class ObjectCacher {
     ceph_tid_t last_commit_tid; // last update commited.
 
     int dirty_or_tx;
+    loff_t zero_or_rx;  ///< bytes in zero or rx bhs
+    loff_t bytes;       ///< bytes in all bhs
 
     map< ceph_tid_t, list<Context*> > waitfor_commit;
     xlist<C_ReadFinish*> reads;
@@ -265,7 +267,7 @@ class ObjectCacher {
       truncate_size(ts), truncate_seq(tq),
       complete(false), exists(true),
       last_write_tid(0), last_commit_tid(0),
-      dirty_or_tx(0) {
+      dirty_or_tx(0), zero_or_rx(0), bytes(0) {
       // add to set
       os->objects.push_back(&set_item);
     }
@@ -274,6 +276,8 @@ class ObjectCacher {
       assert(ref == 0);
       assert(data.empty());
       assert(dirty_or_tx == 0);
+      assert(zero_or_rx == 0);
+      assert(bytes == 0);
       set_item.remove_myself();
     }
 
@@ -338,6 +342,11 @@ class ObjectCacher {
 
     bool is_empty() { return data.empty(); }
 
+    /// true if every bh is zero or rx (or there are none)
+    bool is_all_zero_or_rx() const { return bytes == zero_or_rx; }
+    /// true if any bh is neither dirty nor tx
+    bool has_clean_bytes() const { return bytes > dirty_or_tx; }
+
     // mid-level
     BufferHead *split(BufferHead *bh, loff_t off);
     void merge_left(BufferHead *left, BufferHead *right);
@@ -459,8 +468,6 @@ class ObjectCacher {
   loff_t stat_error;
   loff_t stat_dirty_waiting;   // bytes that writers are waiting on to write
 
-  void verify_stats() const;
-
   void bh_stat_add(BufferHead *bh);
   void bh_stat_sub(BufferHead *bh);
   loff_t get_stat_tx() { return stat_tx; }
@@ -560,6 +567,8 @@ class ObjectCacher {
 		       vector<pair<loff_t, uint64_t> >& ranges,
 		       ceph_tid_t t, int r);
 
+  /// assert that the byte counters (and each Object's) match its bhs
+  void verify_stats() const;
 
   class C_ReadFinish : public Context {
     ObjectCacher *oc;
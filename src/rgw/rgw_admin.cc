@@ -70,6 +70,7 @@ void _usage()
   cout << "  bucket stats               returns bucket statistics\n";
   cout << "  bucket rm                  remove bucket\n";
   cout << "  bucket check               check bucket index\n";
+  cout << "  bucket reshard             reshard bucket index\n";
   cout << "  object rm                  remove object\n";
   cout << "  object unlink              unlink object from bucket index\n";
   cout << "  objects expire             run expired objects cleanup\n";
@@ -202,6 +203,8 @@ void _usage()
   cout << "   --fix                     besides checking bucket index, will also fix it\n";
   cout << "   --check-objects           bucket check: rebuilds bucket index according to\n";
   cout << "                             actual objects state\n";
+  cout << "   --allow-unordered         bucket list: list objects in no particular order,\n";
+  cout << "                             faster on buckets with many index shards\n";
   cout << "   --format=<format>         specify output format for certain operations: xml,\n";
   cout << "                             json\n";
   cout << "   --purge-data              when specified, user removal will also purge all the\n";
@@ -231,6 +234,10 @@ void _usage()
   cout << "   --max-objects             specify max objects (negative value to disable)\n";
   cout << "   --max-size                specify max size (in bytes, negative value to disable)\n";
   cout << "   --quota-scope             scope of quota (bucket, user)\n";
+  cout << "\nBucket reshard options:\n";
+  cout << "   --num-shards              new number of bucket index shards, a multiple of\n";
+  cout << "                             the current one (default: sized for\n";
+  cout << "                             rgw_max_objs_per_shard objects per shard)\n";
   cout << "\nOrphans search options:\n";
   cout << "   --pool                    data pool to scan for leaked rados objects in\n";
   cout << "   --num-shards              num of shards to use for keeping the temporary scan info\n";
@@ -275,6 +282,7 @@ enum {
   OPT_BUCKET_SYNC_RUN,
   OPT_BUCKET_RM,
   OPT_BUCKET_REWRITE,
+  OPT_BUCKET_RESHARD,
   OPT_POLICY,
   OPT_POOL_ADD,
   OPT_POOL_RM,
@@ -471,6 +479,8 @@ static int get_cmd(const char *cmd, const char *prev_cmd, const char *prev_prev_
       return OPT_BUCKET_REWRITE;
     if (strcmp(cmd, "check") == 0)
       return OPT_BUCKET_CHECK;
+    if (strcmp(cmd, "reshard") == 0)
+      return OPT_BUCKET_RESHARD;
     if (strcmp(cmd, "sync") == 0) {
       *need_more = true;
       return 0;
@@ -1628,6 +1638,7 @@ int main(int argc, char **argv)
   map<string, bool> categories;
   string caps;
   int check_objects = false;
+  int allow_unordered = false;
   RGWUserAdminOpState user_op;
   RGWBucketAdminOpState bucket_op;
   string infile;
@@ -1863,6 +1874,8 @@ int main(int argc, char **argv)
       // do nothing
     } else if (ceph_argparse_binary_flag(args, i, &check_objects, NULL, "--check-objects", (char*)NULL)) {
      // do nothing
+    } else if (ceph_argparse_binary_flag(args, i, &allow_unordered, NULL, "--allow-unordered", (char*)NULL)) {
+     // do nothing
     } else if (ceph_argparse_binary_flag(args, i, &sync_stats, NULL, "--sync-stats", (char*)NULL)) {
      // do nothing
     } else if (ceph_argparse_binary_flag(args, i, &include_all, NULL, "--include-all", (char*)NULL)) {
@@ -3505,6 +3518,7 @@ int main(int argc, char **argv)
       list_op.params.ns = ns;
       list_op.params.enforce_ns = false;
       list_op.params.list_versions = true;
+      list_op.params.allow_unordered = !!allow_unordered;
       
       do {
         ret = list_op.list_objects(max_entries - count, &result, &common_prefixes, &truncated);
@@ -4184,6 +4198,62 @@ next:
     RGWBucketAdminOp::remove_bucket(store, bucket_op);
   }
 
+  if (opt_cmd == OPT_BUCKET_RESHARD) {
+    if (bucket_name.empty()) {
+      cerr << "ERROR: bucket not specified" << std::endl;
+      return EINVAL;
+    }
+    RGWBucketInfo bucket_info;
+    map<string, bufferlist> attrs;
+    RGWObjectCtx obj_ctx(store);
+    int ret = store->get_bucket_info(obj_ctx, tenant, bucket_name, bucket_info, NULL, &attrs);
+    if (ret < 0) {
+      cerr << "ERROR: could not get bucket info for bucket=" << bucket_name << ": " << cpp_strerror(-ret) << std::endl;
+      return -ret;
+    }
+
+    uint32_t old_num_shards = bucket_info.num_shards;
+    if (num_shards <= 0) {
+      map<RGWObjCategory, RGWStorageStats> stats;
+      string bucket_ver, master_ver;
+      ret = store->get_bucket_stats(bucket_info.bucket, RGW_NO_SHARD, &bucket_ver, &master_ver, stats, NULL);
+      if (ret < 0) {
+        cerr << "ERROR: could not get bucket stats: " << cpp_strerror(-ret) << std::endl;
+        return -ret;
+      }
+      uint64_t num_objects = 0;
+      for (map<RGWObjCategory, RGWStorageStats>::iterator iter = stats.begin(); iter != stats.end(); ++iter) {
+        num_objects += iter->second.num_objects;
+      }
+      uint64_t max_objs_per_shard = MAX(g_conf->rgw_max_objs_per_shard, 1);
+      uint64_t wanted = (num_objects + max_objs_per_shard - 1) / max_objs_per_shard;
+      if (old_num_shards == 0) {
+        // a single shard is no better than an unsharded index
+        num_shards = (wanted > 1 ? wanted : 0);
+      } else {
+        // the new count must be a multiple of the current one
+        uint64_t factor = (wanted + old_num_shards - 1) / old_num_shards;
+        num_shards = old_num_shards * MAX(factor, (uint64_t)1);
+      }
+      if ((uint32_t)num_shards <= old_num_shards) {
+        cout << "bucket " << bucket_name << " has " << num_objects << " objects in "
+             << old_num_shards << " index shards, no need to reshard" << std::endl;
+        // still finishes a reshard that was interrupted
+        num_shards = old_num_shards;
+      }
+    }
+
+    if ((uint32_t)num_shards != old_num_shards) {
+      cout << "resharding bucket " << bucket_name << " index from " << old_num_shards
+           << " to " << num_shards << " shards" << std::endl;
+    }
+    ret = store->bucket_reshard(bucket_info, attrs, num_shards);
+    if (ret < 0) {
+      cerr << "ERROR: bucket reshard returned " << cpp_strerror(-ret) << std::endl;
+      return -ret;
+    }
+  }
+
   if (opt_cmd == OPT_GC_LIST) {
     int index = 0;
     bool truncated;
@@ -0,0 +1,433 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <string.h>
+
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/buffers_iterator.hpp>
+#include <boost/asio/read_until.hpp>
+
+#include "common/strtol.h"
+#include "rgw_asio_client.h"
+
+#define dout_subsys ceph_subsys_rgw
+
+#define TIME_BUF_SIZE 128
+
+int RGWAsioRequest::parse(const string& header)
+{
+  if (header.size() > ASIO_MAX_HEADER_SIZE)
+    return -E2BIG;
+
+  // request line: method SP request-target SP http-version
+  size_t pos = header.find("\r\n");
+  if (pos == string::npos)
+    return -EINVAL;
+  size_t sp1 = header.find(' ');
+  size_t sp2 = header.rfind(' ', pos);
+  if (sp1 == string::npos || sp1 == 0 || sp1 >= pos || sp2 == sp1)
+    return -EINVAL;
+
+  method = header.substr(0, sp1);
+  string target = header.substr(sp1 + 1, sp2 - sp1 - 1);
+  string version = header.substr(sp2 + 1, pos - sp2 - 1);
+  if (version.size() != 8 || version.compare(0, 5, "HTTP/") != 0 ||
+      !isdigit(version[5]) || version[6] != '.' || !isdigit(version[7]))
+    return -EINVAL;
+  version_major = version[5] - '0';
+  version_minor = version[7] - '0';
+
+  if (target.find_first_of(" \t") != string::npos)
+    return -EINVAL;
+  size_t q = target.find('?');
+  if (q == string::npos) {
+    uri = target;
+  } else {
+    uri = target.substr(0, q);
+    query_string = target.substr(q + 1);
+  }
+  if (uri.empty())
+    return -EINVAL;
+
+  // header fields, one per line, up to the blank line
+  while (true) {
+    size_t start = pos + 2;
+    pos = header.find("\r\n", start);
+    if (pos == string::npos || pos == start)
+      break;
+
+    size_t vstart, vend;
+    if (header[start] == ' ' || header[start] == '\t') {
+      // obsolete line folding continues the previous field's value
+      if (headers.empty())
+	return -EINVAL;
+      vstart = header.find_first_not_of(" \t", start);
+    } else {
+      size_t colon = header.find(':', start);
+      if (colon == string::npos || colon >= pos || colon == start)
+	return -EINVAL;
+      // no whitespace is allowed between the field name and colon
+      if (header[colon - 1] == ' ' || header[colon - 1] == '\t')
+	return -EINVAL;
+      headers.push_back(make_pair(header.substr(start, colon - start),
+				  string()));
+      vstart = header.find_first_not_of(" \t", colon + 1);
+    }
+    if (vstart < pos) {
+      vend = header.find_last_not_of(" \t", pos - 1);
+      string& value = headers.back().second;
+      if (!value.empty())
+	value.push_back(' ');
+      value.append(header, vstart, vend + 1 - vstart);
+    }
+  }
+  if (pos == string::npos)
+    return -EINVAL;  // no blank line
+
+  for (vector<pair<string, string> >::iterator p = headers.begin();
+       p != headers.end();
+       ++p) {
+    const string& name = p->first;
+    const string& value = p->second;
+    if (strcasecmp(name.c_str(), "content-length") == 0) {
+      string err;
+      long long len = strict_strtoll(value.c_str(), 10, &err);
+      if (!err.empty() || len < 0)
+	return -EINVAL;
+      if (has_content_length && content_length != (uint64_t)len)
+	return -EINVAL;
+      has_content_length = true;
+      content_length = len;
+    } else if (strcasecmp(name.c_str(), "transfer-encoding") == 0) {
+      // we only know how to take the chunked framing off
+      if (strcasecmp(value.c_str(), "chunked") == 0)
+	chunked = true;
+      else if (strcasecmp(value.c_str(), "identity") != 0)
+	return -ENOTSUP;
+    } else if (strcasecmp(name.c_str(), "connection") == 0) {
+      explicit_keepalive = (strcasecmp(value.c_str(), "keep-alive") == 0);
+      explicit_conn_close = (strcasecmp(value.c_str(), "close") == 0);
+    } else if (strcasecmp(name.c_str(), "expect") == 0) {
+      expect_continue = (strcasecmp(value.c_str(), "100-continue") == 0);
+    }
+  }
+  if (chunked) {
+    // the chunked framing wins over any content-length (rfc7230 3.3.3)
+    has_content_length = false;
+    content_length = 0;
+  }
+  return 0;
+}
+
+bool RGWAsioRequest::keepalive() const
+{
+  if (explicit_conn_close)
+    return false;
+  // before http/1.1, connections close unless asked otherwise
+  if (version_major < 1 || (version_major == 1 && version_minor < 1))
+    return explicit_keepalive;
+  return true;
+}
+
+RGWAsioClientIO::RGWAsioClientIO(tcp::socket& socket,
+				 boost::asio::streambuf& buffer,
+				 boost::asio::streambuf& body,
+				 RGWAsioRequest& request,
+				 RGWAsioOutput& output, int port)
+  : socket(socket), buffer(buffer), body(body), request(request),
+    output(output), port(port),
+    left_to_read(request.content_length), chunk_left(0),
+    chunked_done(false), io_error(false),
+    status_num(0), header_done(false), sent_header(false),
+    has_content_length(false)
+{
+}
+
+void RGWAsioClientIO::init_env(CephContext *cct)
+{
+  env.init(cct);
+
+  for (vector<pair<string, string> >::iterator p = request.headers.begin();
+       p != request.headers.end();
+       ++p) {
+    const string& name = p->first;
+    const string& value = p->second;
+
+    if (strcasecmp(name.c_str(), "content-length") == 0) {
+      if (!request.chunked)
+	env.set("CONTENT_LENGTH", value.c_str());
+      continue;
+    }
+    if (strcasecmp(name.c_str(), "content-type") == 0) {
+      env.set("CONTENT_TYPE", value.c_str());
+      continue;
+    }
+
+    string buf = "HTTP_";
+    buf.reserve(5 + name.size());
+    for (string::const_iterator c = name.begin(); c != name.end(); ++c) {
+      if (*c == '-')
+	buf.push_back('_');
+      else
+	buf.push_back(toupper(*c));
+    }
+    env.set(buf.c_str(), value.c_str());
+  }
+
+  env.set("REQUEST_METHOD", request.method.c_str());
+  env.set("REQUEST_URI", request.uri.c_str());
+  env.set("QUERY_STRING", request.query_string.c_str());
+  env.set("SCRIPT_URI", request.uri.c_str()); /* FIXME */
+
+  char port_buf[16];
+  snprintf(port_buf, sizeof(port_buf), "%d", port);
+  env.set("SERVER_PORT", port_buf);
+}
+
+int RGWAsioClientIO::write_data(const char *buf, int len)
+{
+  if (!header_done) {
+    header_data.append(buf, len);
+    return len;
+  }
+  if (!sent_header) {
+    data.append(buf, len);
+    return len;
+  }
+  bufferlist bl;
+  bl.append(buf, len);
+  int r = output.write(bl);
+  if (r < 0) {
+    dout(4) << "write_data failed" << dendl;
+    io_error = true;
+    return r;
+  }
+  return len;
+}
+
+int RGWAsioClientIO::read_raw(char *buf, size_t len)
+{
+  size_t bytes;
+  if (buffer.size()) {
+    // the frontend may have read part of the body along with the header
+    bytes = boost::asio::buffer_copy(boost::asio::buffer(buf, len),
+				     buffer.data());
+    buffer.consume(bytes);
+  } else if (body.size()) {
+    bytes = boost::asio::buffer_copy(boost::asio::buffer(buf, len),
+				     body.data());
+    body.consume(bytes);
+  } else {
+    if (output.wait_written() < 0) {
+      io_error = true;
+      return -EIO;
+    }
+    boost::system::error_code ec;
+    bytes = socket.read_some(boost::asio::buffer(buf, len), ec);
+    if (ec) {
+      dout(4) << "read_data failed: " << ec.message() << dendl;
+      io_error = true;
+      return -EIO;
+    }
+  }
+  return bytes;
+}
+
+int RGWAsioClientIO::read_line(string *line)
+{
+  if (output.wait_written() < 0) {
+    io_error = true;
+    return -EIO;
+  }
+  boost::system::error_code ec;
+  size_t bytes = boost::asio::read_until(socket, buffer, "\r\n", ec);
+  if (ec) {
+    dout(4) << "read_line failed: " << ec.message() << dendl;
+    io_error = true;
+    return -EIO;
+  }
+  line->assign(boost::asio::buffers_begin(buffer.data()),
+	       boost::asio::buffers_begin(buffer.data()) + bytes - 2);
+  buffer.consume(bytes);
+  return 0;
+}
+
+int RGWAsioClientIO::read_chunked(char *buf, int max)
+{
+  if (chunked_done)
+    return 0;
+
+  string line;
+  if (chunk_left == 0) {
+    // chunk-size [ chunk-ext ] CRLF
+    int r = read_line(&line);
+    if (r < 0)
+      return r;
+    string size = line.substr(0, line.find(';'));
+    size_t end = size.find_last_not_of(" \t");
+    size.resize(end == string::npos ? 0 : end + 1);
+    string err;
+    long long len = strict_strtoll(size.c_str(), 16, &err);
+    if (!err.empty() || len < 0) {
+      dout(4) << "bad chunk size line: " << line << dendl;
+      io_error = true;
+      return -EINVAL;
+    }
+    if (len == 0) {
+      // the last chunk; skip the trailer, up to the blank line
+      do {
+	r = read_line(&line);
+	if (r < 0)
+	  return r;
+      } while (!line.empty());
+      chunked_done = true;
+      return 0;
+    }
+    chunk_left = len;
+  }
+
+  int r = read_raw(buf, MIN((uint64_t)max, chunk_left));
+  if (r < 0)
+    return r;
+  chunk_left -= r;
+  if (chunk_left == 0) {
+    // each chunk's data ends with CRLF
+    int ret = read_line(&line);
+    if (ret < 0)
+      return ret;
+    if (!line.empty()) {
+      dout(4) << "chunk data longer than its size" << dendl;
+      io_error = true;
+      return -EINVAL;
+    }
+  }
+  return r;
+}
+
+int RGWAsioClientIO::read_data(char *buf, int max)
+{
+  if (request.chunked)
+    return read_chunked(buf, max);
+  if (left_to_read == 0)
+    return 0;
+
+  int r = read_raw(buf, MIN((uint64_t)max, left_to_read));
+  if (r > 0)
+    left_to_read -= r;
+  return r;
+}
+
+void RGWAsioClientIO::flush()
+{
+}
+
+int RGWAsioClientIO::complete_request()
+{
+  if (!sent_header) {
+    if (!has_content_length) {
+      header_done = false; /* let's go back to writing the header */
+
+      /*
+       * Status 204 should not include a content-length header
+       * RFC7230 says so
+       */
+      if (status_num == 204) {
+	has_content_length = true;
+      } else {
+	int r = send_content_length(data.length());
+	if (r < 0)
+	  return r;
+      }
+    }
+
+    complete_header();
+  }
+
+  if (data.length()) {
+    int r = write_data(data.c_str(), data.length());
+    if (r < 0)
+      return r;
+    data.clear();
+  }
+
+  return 0;
+}
+
+int RGWAsioClientIO::send_status(int status, const char *status_name)
+{
+  char buf[128];
+
+  if (!status_name)
+    status_name = "";
+
+  snprintf(buf, sizeof(buf), "HTTP/1.1 %d %s\r\n", status, status_name);
+
+  bufferlist bl;
+  bl.append(buf);
+  bl.append(header_data);
+  header_data = bl;
+
+  status_num = status;
+
+  return 0;
+}
+
+int RGWAsioClientIO::send_100_continue()
+{
+  char buf[] = "HTTP/1.1 100 CONTINUE\r\n\r\n";
+
+  bufferlist bl;
+  bl.append(buf, sizeof(buf) - 1);
+  int r = output.write(bl);
+  if (r < 0) {
+    dout(4) << "send_100_continue failed" << dendl;
+    io_error = true;
+    return r;
+  }
+  return sizeof(buf) - 1;
+}
+
+static void dump_date_header(bufferlist &out)
+{
+  char timestr[TIME_BUF_SIZE];
+  const time_t gtime = time(NULL);
+  struct tm result;
+  struct tm const * const tmp = gmtime_r(&gtime, &result);
+
+  if (tmp == NULL)
+    return;
+
+  if (strftime(timestr, sizeof(timestr),
+	       "Date: %a, %d %b %Y %H:%M:%S %Z\r\n", tmp))
+    out.append(timestr);
+}
+
+int RGWAsioClientIO::complete_header()
+{
+  header_done = true;
+
+  if (!has_content_length) {
+    return 0;
+  }
+
+  dump_date_header(header_data);
+
+  if (request.explicit_keepalive)
+    header_data.append("Connection: Keep-Alive\r\n");
+  else if (request.explicit_conn_close)
+    header_data.append("Connection: close\r\n");
+
+  header_data.append("\r\n");
+
+  sent_header = true;
+
+  return write_data(header_data.c_str(), header_data.length());
+}
+
+int RGWAsioClientIO::send_content_length(uint64_t len)
+{
+  has_content_length = true;
+  char buf[21];
+  snprintf(buf, sizeof(buf), "%" PRIu64, len);
+  return print("Content-Length: %s\r\n", buf);
+}
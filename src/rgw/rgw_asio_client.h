@@ -0,0 +1,126 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef RGW_ASIO_CLIENT_H
+#define RGW_ASIO_CLIENT_H
+
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/streambuf.hpp>
+
+#include "rgw_client_io.h"
+
+/* requests with a larger header are rejected */
+#define ASIO_MAX_HEADER_SIZE (64 * 1024)
+
+/// request line and headers of an http request, as read by the frontend
+struct RGWAsioRequest {
+  string method;
+  string uri;
+  string query_string;
+  int version_major;
+  int version_minor;
+  vector<pair<string, string> > headers;
+
+  bool has_content_length;
+  uint64_t content_length;
+  bool explicit_keepalive;
+  bool explicit_conn_close;
+  bool chunked;
+  bool expect_continue;  ///< the client waits for a 100 before the body
+
+  RGWAsioRequest()
+    : version_major(1), version_minor(1),
+      has_content_length(false), content_length(0),
+      explicit_keepalive(false), explicit_conn_close(false),
+      chunked(false), expect_continue(false) {}
+
+  /**
+   * parse the request line and headers, up to and including the blank
+   * line.  Folded header lines are joined with a space.
+   *
+   * @return 0, -E2BIG if longer than ASIO_MAX_HEADER_SIZE, -ENOTSUP for
+   * a transfer-coding other than chunked, or -EINVAL if malformed
+   */
+  int parse(const string& header);
+
+  /// true if the client expects the connection to stay open
+  bool keepalive() const;
+};
+
+/// where RGWAsioClientIO sends the response
+class RGWAsioOutput {
+public:
+  virtual ~RGWAsioOutput() {}
+
+  /**
+   * queue data to be sent to the client
+   *
+   * @return 0, or -EIO if sending earlier data failed
+   */
+  virtual int write(bufferlist& bl) = 0;
+  /// wait until all the queued data was sent
+  virtual int wait_written() = 0;
+};
+
+/**
+ * Client io for a connection accepted by the asio frontend.
+ *
+ * The frontend reads the request header asynchronously and hands us the
+ * socket only once a whole header is buffered, along with the body if it
+ * is small enough.  The rest of the body is read with blocking calls from
+ * the worker thread.  The response is handed to output, which sends it
+ * asynchronously; the socket is only read once all of it was sent, so
+ * that we never use it concurrently with the frontend.
+ */
+class RGWAsioClientIO : public RGWStreamIO {
+  typedef boost::asio::ip::tcp tcp;
+
+  tcp::socket& socket;
+  boost::asio::streambuf& buffer;  ///< body bytes read along with the header
+  boost::asio::streambuf& body;    ///< the rest of the body, if prefetched
+  RGWAsioRequest& request;
+  RGWAsioOutput& output;
+  int port;
+
+  uint64_t left_to_read;
+  uint64_t chunk_left;  ///< of the current chunk of a chunked body
+  bool chunked_done;    ///< read the last chunk and the trailer
+  bool io_error;
+
+  bufferlist header_data;
+  bufferlist data;
+
+  int status_num;
+  bool header_done;
+  bool sent_header;
+  bool has_content_length;
+
+  int read_raw(char *buf, size_t len);
+  int read_line(string *line);
+  int read_chunked(char *buf, int max);
+
+public:
+  RGWAsioClientIO(tcp::socket& socket, boost::asio::streambuf& buffer,
+		  boost::asio::streambuf& body, RGWAsioRequest& request,
+		  RGWAsioOutput& output, int port);
+
+  void init_env(CephContext *cct);
+
+  int write_data(const char *buf, int len);
+  int read_data(char *buf, int max);
+
+  int send_status(int status, const char *status_name);
+  int send_100_continue();
+  int complete_header();
+  int complete_request();
+  int send_content_length(uint64_t len);
+  void flush();
+
+  /// true if another request can be read from the connection
+  bool get_conn_keepalive() const {
+    return request.keepalive() && (!request.chunked || chunked_done) &&
+      !io_error && left_to_read == 0;
+  }
+};
+
+#endif // RGW_ASIO_CLIENT_H
@@ -0,0 +1,513 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <deque>
+#include <thread>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include "common/Cond.h"
+#include "common/Mutex.h"
+#include "rgw_asio_client.h"
+#include "rgw_asio_frontend.h"
+
+#include "rgw_boost_asio_coroutine.h"
+#include "rgw_boost_asio_yield.h"
+
+#define dout_subsys ceph_subsys_rgw
+
+#undef dout_prefix
+#define dout_prefix (*_dout << "asio: ")
+
+typedef boost::asio::ip::tcp tcp;
+
+class AsioConnection;
+typedef std::shared_ptr<AsioConnection> AsioConnectionRef;
+
+class AsioFrontend {
+  RGWProcessEnv env;
+  RGWFrontendConfig* conf;
+
+  boost::asio::io_service service;
+  tcp::acceptor acceptor;
+  tcp::socket peer_socket;
+  std::vector<std::thread> threads;
+  int port;
+  int write_buffer_size;   ///< unsent response data a worker may leave behind
+  int body_prefetch_size;  ///< largest body read before queueing a request
+
+  ThreadPool worker_tp;
+
+  struct ConnectionWQ : public ThreadPool::WorkQueueVal<AsioConnectionRef> {
+    AsioFrontend *frontend;
+    std::deque<AsioConnectionRef> conns;
+
+    ConnectionWQ(AsioFrontend *f, time_t timeout, time_t suicide_timeout,
+		 ThreadPool *tp)
+      : ThreadPool::WorkQueueVal<AsioConnectionRef>("AsioConnectionWQ",
+						    timeout, suicide_timeout,
+						    tp),
+	frontend(f) {}
+
+    void _enqueue(AsioConnectionRef c) {
+      conns.push_back(c);
+      perfcounter->inc(l_rgw_qlen);
+    }
+    void _enqueue_front(AsioConnectionRef c) {
+      conns.push_front(c);
+      perfcounter->inc(l_rgw_qlen);
+    }
+    bool _empty() {
+      return conns.empty();
+    }
+    AsioConnectionRef _dequeue() {
+      assert(!conns.empty());
+      AsioConnectionRef c = conns.front();
+      conns.pop_front();
+      perfcounter->inc(l_rgw_qlen, -1);
+      return c;
+    }
+    void _process(AsioConnectionRef c, ThreadPool::TPHandle &) {
+      perfcounter->inc(l_rgw_qactive);
+      frontend->process(c);
+      perfcounter->inc(l_rgw_qactive, -1);
+    }
+  } worker_wq;
+
+  void accept(boost::system::error_code ec);
+
+public:
+  AsioFrontend(RGWProcessEnv& env, RGWFrontendConfig* conf, int num_threads)
+    : env(env), conf(conf), acceptor(service), peer_socket(service),
+      port(0), write_buffer_size(0), body_prefetch_size(0),
+      worker_tp(g_ceph_context, "AsioFrontend::worker_tp", "tp_rgw_asio",
+		num_threads),
+      worker_wq(this, g_conf->rgw_op_thread_timeout,
+		g_conf->rgw_op_thread_suicide_timeout, &worker_tp) {}
+
+  int init();
+  int run();
+  void stop();
+  void join();
+  void pause();
+  void unpause(RGWRados *store);
+
+  boost::asio::io_service& get_io_service() { return service; }
+  size_t get_write_buffer_size() const { return write_buffer_size; }
+  size_t get_body_prefetch_size() const { return body_prefetch_size; }
+
+  /// hand a connection with a complete request header to the workers
+  void queue(AsioConnectionRef c) {
+    worker_wq.queue(c);
+  }
+  /// process the connection's request; called from a worker thread
+  void process(AsioConnectionRef c);
+};
+
+/**
+ * A client connection.
+ *
+ * The connection is a stackless coroutine that alternates between
+ * reading a request header (and a small body) on a reactor thread and
+ * waiting for a worker to process the request.  At any time either one
+ * async read is outstanding or the connection is queued or being
+ * processed by a worker, never both.
+ *
+ * The worker hands the response to write(), which queues it to be sent
+ * asynchronously from a reactor thread, and only blocks while more than
+ * write_buffer_size bytes are unsent.  It reads the socket only once the
+ * queue is empty.  When the worker is done, finish() continues with the
+ * next request, or closes the connection, once the rest of the response
+ * is sent; a slow client therefore holds a worker only for the part of
+ * a response that exceeds the buffer.  The connection goes away with the
+ * last handler referencing it.
+ */
+class AsioConnection : public std::enable_shared_from_this<AsioConnection>,
+		       public boost::asio::coroutine,
+		       public RGWAsioOutput {
+  AsioFrontend *frontend;
+  tcp::socket socket;
+  boost::asio::streambuf buffer;
+  boost::asio::streambuf body;
+  RGWAsioRequest request;
+  const char *reply;  ///< error reply to send before closing
+  size_t reply_len;
+
+  enum AfterWrite {
+    AFTER_WRITE_NONE,
+    AFTER_WRITE_REQUEUE,
+    AFTER_WRITE_CLOSE,
+  };
+
+  Mutex out_lock;
+  Cond out_cond;
+  std::deque<bufferlist> out_queue;  ///< the front one is being written
+  size_t out_pending;
+  bool out_error;
+  AfterWrite after_write;
+
+  struct WriteHandler {
+    AsioConnectionRef conn;
+    explicit WriteHandler(AsioConnectionRef c) : conn(c) {}
+    void operator()(boost::system::error_code ec, size_t bytes) {
+      conn->handle_write(ec);
+    }
+  };
+
+  void start_write();
+  void handle_write(boost::system::error_code ec);
+  void do_after_write(AfterWrite what);
+
+  struct Handler {
+    AsioConnectionRef conn;
+    explicit Handler(AsioConnectionRef c) : conn(c) {}
+    void operator()(boost::system::error_code ec = boost::system::error_code(),
+		    size_t bytes = 0) {
+      conn->resume(ec, bytes);
+    }
+  };
+
+public:
+  AsioConnection(AsioFrontend *f, tcp::socket&& s)
+    : frontend(f), socket(std::move(s)), buffer(ASIO_MAX_HEADER_SIZE),
+      reply(NULL), reply_len(0), out_lock("AsioConnection::out_lock"),
+      out_pending(0), out_error(false), after_write(AFTER_WRITE_NONE) {}
+
+  tcp::socket& get_socket() { return socket; }
+  boost::asio::streambuf& get_buffer() { return buffer; }
+  boost::asio::streambuf& get_body() { return body; }
+  RGWAsioRequest& get_request() { return request; }
+
+  void resume(boost::system::error_code ec = boost::system::error_code(),
+	      size_t bytes = 0);
+
+  int write(bufferlist& bl) override;
+  int wait_written() override;
+
+  /**
+   * once the response is sent, continue with the next request on this
+   * connection, or close it
+   */
+  void finish(bool keepalive);
+};
+
+static const char header_too_large[] =
+  "HTTP/1.1 431 Request Header Fields Too Large\r\n"
+  "Connection: close\r\nContent-Length: 0\r\n\r\n";
+static const char bad_request[] =
+  "HTTP/1.1 400 Bad Request\r\n"
+  "Connection: close\r\nContent-Length: 0\r\n\r\n";
+// a transfer-coding we cannot decode
+static const char not_implemented[] =
+  "HTTP/1.1 501 Not Implemented\r\n"
+  "Connection: close\r\nContent-Length: 0\r\n\r\n";
+
+#define SET_REPLY(r) do { reply = r; reply_len = sizeof(r) - 1; } while (0)
+
+void AsioConnection::resume(boost::system::error_code ec, size_t bytes)
+{
+  reenter(this) {
+    for (;;) {
+      reply = NULL;
+      yield boost::asio::async_read_until(socket, buffer, "\r\n\r\n",
+					  Handler(shared_from_this()));
+      if (ec) {
+	if (ec != boost::asio::error::eof &&
+	    ec != boost::asio::error::operation_aborted) {
+	  dout(10) << "failed to read request header: " << ec.message()
+		   << dendl;
+	}
+	if (ec != boost::asio::error::not_found)
+	  return;
+	// exceeded ASIO_MAX_HEADER_SIZE
+	SET_REPLY(header_too_large);
+      } else {
+	string header(boost::asio::buffers_begin(buffer.data()),
+		      boost::asio::buffers_begin(buffer.data()) + bytes);
+	buffer.consume(bytes);
+	request = RGWAsioRequest();
+	int r = request.parse(header);
+	if (r < 0) {
+	  dout(10) << "failed to parse request header" << dendl;
+	  if (r == -E2BIG)
+	    SET_REPLY(header_too_large);
+	  else if (r == -ENOTSUP)
+	    SET_REPLY(not_implemented);
+	  else
+	    SET_REPLY(bad_request);
+	}
+      }
+      if (reply) {
+	// don't block the reactor on a client that doesn't read
+	yield boost::asio::async_write(socket,
+				       boost::asio::buffer(reply, reply_len),
+				       Handler(shared_from_this()));
+	return;
+      }
+
+      // read a small body here, rather than from a worker, unless the
+      // client waits for a 100 that only the worker can send
+      body.consume(body.size());
+      if (!request.chunked && !request.expect_continue &&
+	  request.content_length > buffer.size() &&
+	  request.content_length <= frontend->get_body_prefetch_size()) {
+	yield boost::asio::async_read(
+	  socket, body,
+	  boost::asio::transfer_exactly(request.content_length - buffer.size()),
+	  Handler(shared_from_this()));
+	if (ec) {
+	  dout(10) << "failed to read request body: " << ec.message() << dendl;
+	  return;
+	}
+      }
+
+      // a worker resumes us via finish() if the connection stays open
+      yield frontend->queue(shared_from_this());
+    }
+  }
+}
+
+int AsioConnection::write(bufferlist& bl)
+{
+  Mutex::Locker l(out_lock);
+  if (out_error)
+    return -EIO;
+  out_pending += bl.length();
+  out_queue.push_back(bufferlist());
+  out_queue.back().claim(bl);
+  if (out_queue.size() == 1) {
+    // writes are started from a reactor thread, like the reads
+    AsioConnectionRef c = shared_from_this();
+    frontend->get_io_service().post([c] {
+	Mutex::Locker l(c->out_lock);
+	c->start_write();
+      });
+  }
+  while (out_pending > frontend->get_write_buffer_size() && !out_error)
+    out_cond.Wait(out_lock);
+  return out_error ? -EIO : 0;
+}
+
+int AsioConnection::wait_written()
+{
+  Mutex::Locker l(out_lock);
+  while (out_pending > 0 && !out_error)
+    out_cond.Wait(out_lock);
+  return out_error ? -EIO : 0;
+}
+
+void AsioConnection::start_write()
+{
+  assert(out_lock.is_locked());
+  if (out_queue.empty())
+    return;
+  std::vector<boost::asio::const_buffer> bufs;
+  const std::list<bufferptr>& ptrs = out_queue.front().buffers();
+  for (std::list<bufferptr>::const_iterator p = ptrs.begin();
+       p != ptrs.end();
+       ++p)
+    bufs.push_back(boost::asio::buffer(p->c_str(), p->length()));
+  boost::asio::async_write(socket, bufs, WriteHandler(shared_from_this()));
+}
+
+void AsioConnection::handle_write(boost::system::error_code ec)
+{
+  AfterWrite what = AFTER_WRITE_NONE;
+  {
+    Mutex::Locker l(out_lock);
+    if (ec) {
+      if (ec != boost::asio::error::operation_aborted)
+	dout(4) << "write failed: " << ec.message() << dendl;
+      out_error = true;
+      out_queue.clear();
+      out_pending = 0;
+    } else {
+      out_pending -= out_queue.front().length();
+      out_queue.pop_front();
+      start_write();
+    }
+    if (out_queue.empty()) {
+      what = after_write;
+      after_write = AFTER_WRITE_NONE;
+    }
+    out_cond.Signal();
+  }
+  if (what != AFTER_WRITE_NONE)
+    do_after_write(out_error ? AFTER_WRITE_CLOSE : what);
+}
+
+void AsioConnection::finish(bool keepalive)
+{
+  AfterWrite what = keepalive ? AFTER_WRITE_REQUEUE : AFTER_WRITE_CLOSE;
+  {
+    Mutex::Locker l(out_lock);
+    if (out_error) {
+      what = AFTER_WRITE_CLOSE;
+    } else if (!out_queue.empty()) {
+      after_write = what;
+      return;
+    }
+  }
+  do_after_write(what);
+}
+
+void AsioConnection::do_after_write(AfterWrite what)
+{
+  if (what == AFTER_WRITE_REQUEUE) {
+    frontend->get_io_service().post(Handler(shared_from_this()));
+  } else {
+    // dropping the last reference closes the socket
+    boost::system::error_code ec;
+    socket.shutdown(tcp::socket::shutdown_both, ec);
+  }
+}
+
+int AsioFrontend::init()
+{
+  conf->get_val("port", 80, &port);
+  conf->get_val("write_buffer_size", 1024 * 1024, &write_buffer_size);
+  conf->get_val("body_prefetch_size", 256 * 1024, &body_prefetch_size);
+  if (write_buffer_size < 0)
+    write_buffer_size = 0;
+  if (body_prefetch_size < 0)
+    body_prefetch_size = 0;
+
+  boost::system::error_code ec;
+  tcp::endpoint endpoint(tcp::v4(), port);
+  acceptor.open(endpoint.protocol(), ec);
+  if (!ec)
+    acceptor.set_option(tcp::acceptor::reuse_address(true), ec);
+  if (!ec)
+    acceptor.bind(endpoint, ec);
+  if (!ec)
+    acceptor.listen(SOCKET_BACKLOG, ec);
+  if (ec) {
+    derr << "failed to listen on port " << port << ": " << ec.message()
+	 << dendl;
+    return -ec.value();
+  }
+  return 0;
+}
+
+void AsioFrontend::accept(boost::system::error_code ec)
+{
+  if (!acceptor.is_open() || ec == boost::asio::error::operation_aborted)
+    return;
+  if (ec) {
+    dout(1) << "accept failed: " << ec.message() << dendl;
+  } else {
+    peer_socket.set_option(tcp::no_delay(true), ec);
+    AsioConnectionRef conn = std::make_shared<AsioConnection>(
+      this, std::move(peer_socket));
+    conn->resume();
+  }
+  acceptor.async_accept(peer_socket,
+			[this] (boost::system::error_code ec) {
+			  accept(ec);
+			});
+}
+
+int AsioFrontend::run()
+{
+  int num_reactors;
+  conf->get_val("reactor_threads", 2, &num_reactors);
+  if (num_reactors < 1)
+    num_reactors = 1;
+
+  dout(4) << "starting " << num_reactors << " reactor threads" << dendl;
+  worker_tp.start();
+
+  acceptor.async_accept(peer_socket,
+			[this] (boost::system::error_code ec) {
+			  accept(ec);
+			});
+  threads.reserve(num_reactors);
+  for (int i = 0; i < num_reactors; i++) {
+    threads.emplace_back([this] { service.run(); });
+  }
+  return 0;
+}
+
+void AsioFrontend::process(AsioConnectionRef c)
+{
+  RGWRequest req(env.store->get_new_req_id());
+  RGWAsioClientIO client_io(c->get_socket(), c->get_buffer(), c->get_body(),
+			    c->get_request(), *c, port);
+
+  int ret = process_request(env.store, env.rest, &req, &client_io, env.olog);
+  if (ret < 0) {
+    /* we don't really care about return code */
+    dout(20) << "process_request() returned " << ret << dendl;
+  }
+
+  c->finish(client_io.get_conn_keepalive());
+}
+
+void AsioFrontend::stop()
+{
+  dout(4) << "stopping" << dendl;
+  boost::system::error_code ec;
+  acceptor.close(ec);
+  service.stop();
+}
+
+void AsioFrontend::join()
+{
+  for (std::thread& t : threads)
+    t.join();
+  threads.clear();
+  worker_tp.stop();
+}
+
+void AsioFrontend::pause()
+{
+  // wait for requests in progress; new ones queue up until unpause
+  worker_tp.pause();
+}
+
+void AsioFrontend::unpause(RGWRados *store)
+{
+  env.store = store;
+  worker_tp.unpause();
+}
+
+
+RGWAsioFrontend::RGWAsioFrontend(RGWProcessEnv& env, RGWFrontendConfig* conf)
+{
+  int num_threads;
+  conf->get_val("num_threads", g_conf->rgw_thread_pool_size, &num_threads);
+  impl.reset(new AsioFrontend(env, conf, num_threads));
+}
+
+RGWAsioFrontend::~RGWAsioFrontend() = default;
+
+int RGWAsioFrontend::init()
+{
+  return impl->init();
+}
+
+int RGWAsioFrontend::run()
+{
+  return impl->run();
+}
+
+void RGWAsioFrontend::stop()
+{
+  impl->stop();
+}
+
+void RGWAsioFrontend::join()
+{
+  impl->join();
+}
+
+void RGWAsioFrontend::pause_for_new_config()
+{
+  impl->pause();
+}
+
+void RGWAsioFrontend::unpause_with_new_config(RGWRados *store)
+{
+  impl->unpause(store);
+}
@@ -0,0 +1,47 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef RGW_ASIO_FRONTEND_H
+#define RGW_ASIO_FRONTEND_H
+
+#include <memory>
+
+#include "rgw_frontend.h"
+
+class AsioFrontend;
+
+/**
+ * Frontend built on boost::asio.
+ *
+ * A few reactor threads accept connections and read request headers
+ * asynchronously, so idle keep-alive connections and clients that are
+ * slow to send a request do not hold a thread.  Once a header is read,
+ * along with a body of up to body_prefetch_size bytes, the connection is
+ * queued to a pool of rgw_thread_pool_size workers that process the
+ * request, and then goes back to the reactor to wait for the next one.
+ * The reactor sends the responses; a worker only waits for a slow client
+ * while more than write_buffer_size bytes of a response are unsent.
+ *
+ * Request processing is still synchronous: a worker is held while the
+ * request waits on librados, and while it reads a larger body.
+ *
+ * Config: "asio port=<port> reactor_threads=<n> num_threads=<n>
+ * write_buffer_size=<bytes> body_prefetch_size=<bytes>".
+ */
+class RGWAsioFrontend : public RGWFrontend {
+  std::unique_ptr<AsioFrontend> impl;
+
+public:
+  RGWAsioFrontend(RGWProcessEnv& env, RGWFrontendConfig* conf);
+  ~RGWAsioFrontend();
+
+  int init() override;
+  int run() override;
+  void stop() override;
+  void join() override;
+
+  void pause_for_new_config() override;
+  void unpause_with_new_config(RGWRados *store) override;
+};
+
+#endif // RGW_ASIO_FRONTEND_H
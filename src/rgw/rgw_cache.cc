@@ -4,21 +4,86 @@
 #include "rgw_cache.h"
 
 #include <errno.h>
+#include <set>
+
+#include "common/Clock.h"
 
 #define dout_subsys ceph_subsys_rgw
 
 using namespace std;
 
+/* drops a shard lock taken with lock_read() or lock_write() */
+struct ShardUnlocker {
+  RWLock& lock;
+  explicit ShardUnlocker(RWLock& l) : lock(l) {}
+  ~ShardUnlocker() {
+    lock.unlock();
+  }
+};
+
+ObjectCache::~ObjectCache()
+{
+  for (vector<Shard *>::iterator iter = shards.begin(); iter != shards.end(); ++iter) {
+    delete *iter;
+  }
+}
+
+void ObjectCache::set_ctx(CephContext *_cct)
+{
+  cct = _cct;
+
+  int num_shards = cct->_conf->rgw_cache_num_shards;
+  if (num_shards < 1)
+    num_shards = 1;
+  /* called before the cache is shared, so the shards can be replaced; what
+   * they hold is dropped */
+  if ((size_t)num_shards != shards.size()) {
+    bool enabled = shards[0]->enabled;
+    for (vector<Shard *>::iterator iter = shards.begin(); iter != shards.end(); ++iter) {
+      delete *iter;
+    }
+    shards.clear();
+    for (int i = 0; i < num_shards; i++) {
+      shards.push_back(new Shard);
+      shards.back()->enabled = enabled;
+    }
+  }
+  shard_lru_size = cct->_conf->rgw_cache_lru_size / num_shards;
+  if (shard_lru_size < 1)
+    shard_lru_size = 1;
+}
+
+/* only a lock we had to wait for is timed */
+void ObjectCache::lock_read(Shard& shard)
+{
+  if (shard.lock.try_get_read())
+    return;
+  utime_t start = ceph_clock_now(cct);
+  shard.lock.get_read();
+  if (perfcounter) perfcounter->tinc(l_rgw_cache_lock_wait, ceph_clock_now(cct) - start);
+}
+
+void ObjectCache::lock_write(Shard& shard)
+{
+  if (shard.lock.try_get_write())
+    return;
+  utime_t start = ceph_clock_now(cct);
+  shard.lock.get_write();
+  if (perfcounter) perfcounter->tinc(l_rgw_cache_lock_wait, ceph_clock_now(cct) - start);
+}
+
 int ObjectCache::get(string& name, ObjectCacheInfo& info, uint32_t mask, rgw_cache_entry_info *cache_info)
 {
-  RWLock::RLocker l(lock);
+  Shard& shard = get_shard(name);
+  lock_read(shard);
+  ShardUnlocker l(shard.lock);
 
-  if (!enabled) {
+  if (!shard.enabled) {
     return -ENOENT;
   }
 
-  map<string, ObjectCacheEntry>::iterator iter = cache_map.find(name);
-  if (iter == cache_map.end()) {
+  unordered_map<string, ObjectCacheEntry>::iterator iter = shard.cache_map.find(name);
+  if (iter == shard.cache_map.end()) {
     ldout(cct, 10) << "cache get: name=" << name << " : miss" << dendl;
     if(perfcounter) perfcounter->inc(l_rgw_cache_miss);
     return -ENOENT;
@@ -26,27 +91,7 @@ int ObjectCache::get(string& name, ObjectCacheInfo& info, uint32_t mask, rgw_cac
 
   ObjectCacheEntry *entry = &iter->second;
 
-  if (lru_counter - entry->lru_promotion_ts > lru_window) {
-    ldout(cct, 20) << "cache get: touching lru, lru_counter=" << lru_counter << " promotion_ts=" << entry->lru_promotion_ts << dendl;
-    lock.unlock();
-    lock.get_write(); /* promote lock to writer */
-
-    /* need to redo this because entry might have dropped off the cache */
-    iter = cache_map.find(name);
-    if (iter == cache_map.end()) {
-      ldout(cct, 10) << "lost race! cache get: name=" << name << " : miss" << dendl;
-      if(perfcounter) perfcounter->inc(l_rgw_cache_miss);
-      return -ENOENT;
-    }
-
-    entry = &iter->second;
-    /* check again, we might have lost a race here */
-    if (lru_counter - entry->lru_promotion_ts > lru_window) {
-      touch_lru(name, *entry, iter->second.lru_iter);
-    }
-  }
-
-  ObjectCacheInfo& src = iter->second.info;
+  ObjectCacheInfo& src = entry->info;
   if ((src.flags & mask) != mask) {
     ldout(cct, 10) << "cache get: name=" << name << " : type miss (requested=" << mask << ", cached=" << src.flags << ")" << dendl;
     if(perfcounter) perfcounter->inc(l_rgw_cache_miss);
@@ -54,6 +99,8 @@ int ObjectCache::get(string& name, ObjectCacheInfo& info, uint32_t mask, rgw_cac
   }
   ldout(cct, 10) << "cache get: name=" << name << " : hit" << dendl;
 
+  entry->referenced = true;
+
   info = src;
   if (cache_info) {
     cache_info->cache_locator = name;
@@ -66,12 +113,29 @@ int ObjectCache::get(string& name, ObjectCacheInfo& info, uint32_t mask, rgw_cac
 
 bool ObjectCache::chain_cache_entry(list<rgw_cache_entry_info *>& cache_info_entries, RGWChainedCache::Entry *chained_entry)
 {
-  RWLock::WLocker l(lock);
+  /* the entries may live in different shards; lock them all, in order */
+  set<unsigned> shard_ids;
+  list<rgw_cache_entry_info *>::iterator citer;
+  for (citer = cache_info_entries.begin(); citer != cache_info_entries.end(); ++citer) {
+    shard_ids.insert(shard_index((*citer)->cache_locator));
+  }
+
+  set<unsigned>::iterator siter;
+  for (siter = shard_ids.begin(); siter != shard_ids.end(); ++siter) {
+    lock_write(*shards[*siter]);
+  }
+
+  bool ret = do_chain_cache_entry(cache_info_entries, chained_entry);
 
-  if (!enabled) {
-    return false;
+  for (siter = shard_ids.begin(); siter != shard_ids.end(); ++siter) {
+    shards[*siter]->lock.unlock();
   }
 
+  return ret;
+}
+
+bool ObjectCache::do_chain_cache_entry(list<rgw_cache_entry_info *>& cache_info_entries, RGWChainedCache::Entry *chained_entry)
+{
   list<rgw_cache_entry_info *>::iterator citer;
 
   list<ObjectCacheEntry *> cache_entry_list;
@@ -79,10 +143,15 @@ bool ObjectCache::chain_cache_entry(list<rgw_cache_entry_info *>& cache_info_ent
   /* first verify that all entries are still valid */
   for (citer = cache_info_entries.begin(); citer != cache_info_entries.end(); ++citer) {
     rgw_cache_entry_info *cache_info = *citer;
+    Shard& shard = get_shard(cache_info->cache_locator);
+
+    if (!shard.enabled) {
+      return false;
+    }
 
     ldout(cct, 10) << "chain_cache_entry: cache_locator=" << cache_info->cache_locator << dendl;
-    map<string, ObjectCacheEntry>::iterator iter = cache_map.find(cache_info->cache_locator);
-    if (iter == cache_map.end()) {
+    unordered_map<string, ObjectCacheEntry>::iterator iter = shard.cache_map.find(cache_info->cache_locator);
+    if (iter == shard.cache_map.end()) {
       ldout(cct, 20) << "chain_cache_entry: couldn't find cachce locator" << dendl;
       return false;
     }
@@ -111,35 +180,42 @@ bool ObjectCache::chain_cache_entry(list<rgw_cache_entry_info *>& cache_info_ent
   return true;
 }
 
+void ObjectCache::invalidate_chained_entries(ObjectCacheEntry& entry)
+{
+  for (list<pair<RGWChainedCache *, string> >::iterator iiter = entry.chained_entries.begin();
+       iiter != entry.chained_entries.end(); ++iiter) {
+    RGWChainedCache *chained_cache = iiter->first;
+    chained_cache->invalidate(iiter->second);
+  }
+
+  entry.chained_entries.clear();
+}
+
 void ObjectCache::put(string& name, ObjectCacheInfo& info, rgw_cache_entry_info *cache_info)
 {
-  RWLock::WLocker l(lock);
+  Shard& shard = get_shard(name);
+  lock_write(shard);
+  ShardUnlocker l(shard.lock);
 
-  if (!enabled) {
+  if (!shard.enabled) {
     return;
   }
 
   ldout(cct, 10) << "cache put: name=" << name << dendl;
-  map<string, ObjectCacheEntry>::iterator iter = cache_map.find(name);
-  if (iter == cache_map.end()) {
-    ObjectCacheEntry entry;
-    entry.lru_iter = lru.end();
-    cache_map.insert(pair<string, ObjectCacheEntry>(name, entry));
-    iter = cache_map.find(name);
+  unordered_map<string, ObjectCacheEntry>::iterator iter = shard.cache_map.find(name);
+  if (iter == shard.cache_map.end()) {
+    iter = shard.cache_map.emplace(std::piecewise_construct,
+                                   std::forward_as_tuple(name),
+                                   std::forward_as_tuple()).first;
+    iter->second.lru_iter = shard.lru.end();
   }
   ObjectCacheEntry& entry = iter->second;
   ObjectCacheInfo& target = entry.info;
 
-  for (list<pair<RGWChainedCache *, string> >::iterator iiter = entry.chained_entries.begin();
-       iiter != entry.chained_entries.end(); ++iiter) {
-    RGWChainedCache *chained_cache = iiter->first;
-    chained_cache->invalidate(iiter->second);
-  }
-
-  entry.chained_entries.clear();
+  invalidate_chained_entries(entry);
   entry.gen++;
 
-  touch_lru(name, entry, entry.lru_iter);
+  touch_lru(shard, name, entry);
 
   target.status = info.status;
 
@@ -189,33 +265,35 @@ void ObjectCache::put(string& name, ObjectCacheInfo& info, rgw_cache_entry_info
 
 void ObjectCache::remove(string& name)
 {
-  RWLock::WLocker l(lock);
+  Shard& shard = get_shard(name);
+  lock_write(shard);
+  ShardUnlocker l(shard.lock);
 
-  if (!enabled) {
+  if (!shard.enabled) {
     return;
   }
 
-  map<string, ObjectCacheEntry>::iterator iter = cache_map.find(name);
-  if (iter == cache_map.end())
+  unordered_map<string, ObjectCacheEntry>::iterator iter = shard.cache_map.find(name);
+  if (iter == shard.cache_map.end())
     return;
 
   ldout(cct, 10) << "removing " << name << " from cache" << dendl;
   ObjectCacheEntry& entry = iter->second;
 
-  for (list<pair<RGWChainedCache *, string> >::iterator iiter = entry.chained_entries.begin();
-       iiter != entry.chained_entries.end(); ++iiter) {
-    RGWChainedCache *chained_cache = iiter->first;
-    chained_cache->invalidate(iiter->second);
-  }
+  invalidate_chained_entries(entry);
 
-  remove_lru(name, iter->second.lru_iter);
-  cache_map.erase(iter);
+  remove_lru(shard, entry.lru_iter);
+  shard.cache_map.erase(iter);
 }
 
-void ObjectCache::touch_lru(string& name, ObjectCacheEntry& entry, std::list<string>::iterator& lru_iter)
+void ObjectCache::touch_lru(Shard& shard, const string& name, ObjectCacheEntry& entry)
 {
-  while (lru_size > (size_t)cct->_conf->rgw_cache_lru_size) {
-    list<string>::iterator iter = lru.begin();
+  /* entries hit since they last came up get another round, but each at
+   * most once per call, so that we always make progress */
+  unsigned long second_chances = shard.lru_size;
+
+  while (shard.lru_size > shard_lru_size) {
+    list<string>::iterator iter = shard.lru.begin();
     if ((*iter).compare(name) == 0) {
       /*
        * if the entry we're touching happens to be at the lru end, don't remove it,
@@ -223,75 +301,86 @@ void ObjectCache::touch_lru(string& name, ObjectCacheEntry& entry, std::list<str
        */
       break;
     }
-    map<string, ObjectCacheEntry>::iterator map_iter = cache_map.find(*iter);
+    unordered_map<string, ObjectCacheEntry>::iterator map_iter = shard.cache_map.find(*iter);
+    if (map_iter != shard.cache_map.end() &&
+        map_iter->second.referenced && second_chances > 0) {
+      map_iter->second.referenced = false;
+      shard.lru.splice(shard.lru.end(), shard.lru, iter);
+      second_chances--;
+      continue;
+    }
     ldout(cct, 10) << "removing entry: name=" << *iter << " from cache LRU" << dendl;
-    if (map_iter != cache_map.end())
-      cache_map.erase(map_iter);
-    lru.pop_front();
-    lru_size--;
+    if (map_iter != shard.cache_map.end()) {
+      invalidate_chained_entries(map_iter->second);
+      shard.cache_map.erase(map_iter);
+    }
+    shard.lru.pop_front();
+    shard.lru_size--;
   }
 
-  if (lru_iter == lru.end()) {
-    lru.push_back(name);
-    lru_size++;
-    lru_iter--;
+  if (entry.lru_iter == shard.lru.end()) {
+    shard.lru.push_back(name);
+    shard.lru_size++;
+    entry.lru_iter = --shard.lru.end();
     ldout(cct, 10) << "adding " << name << " to cache LRU end" << dendl;
   } else {
     ldout(cct, 10) << "moving " << name << " to cache LRU end" << dendl;
-    lru.erase(lru_iter);
-    lru.push_back(name);
-    lru_iter = lru.end();
-    --lru_iter;
+    shard.lru.splice(shard.lru.end(), shard.lru, entry.lru_iter);
   }
 
-  lru_counter++;
-  entry.lru_promotion_ts = lru_counter;
+  entry.referenced = false;
 }
 
-void ObjectCache::remove_lru(string& name, std::list<string>::iterator& lru_iter)
+void ObjectCache::remove_lru(Shard& shard, std::list<string>::iterator& lru_iter)
 {
-  if (lru_iter == lru.end())
+  if (lru_iter == shard.lru.end())
     return;
 
-  lru.erase(lru_iter);
-  lru_size--;
-  lru_iter = lru.end();
+  shard.lru.erase(lru_iter);
+  shard.lru_size--;
+  lru_iter = shard.lru.end();
 }
 
 void ObjectCache::set_enabled(bool status)
 {
-  RWLock::WLocker l(lock);
+  for (vector<Shard *>::iterator iter = shards.begin(); iter != shards.end(); ++iter) {
+    Shard& shard = **iter;
+    lock_write(shard);
+    ShardUnlocker l(shard.lock);
 
-  enabled = status;
+    shard.enabled = status;
+  }
 
-  if (!enabled) {
-    do_invalidate_all();
+  if (!status) {
+    invalidate_all();
   }
 }
 
 void ObjectCache::invalidate_all()
 {
-  RWLock::WLocker l(lock);
+  for (vector<Shard *>::iterator iter = shards.begin(); iter != shards.end(); ++iter) {
+    Shard& shard = **iter;
+    lock_write(shard);
+    ShardUnlocker l(shard.lock);
 
-  do_invalidate_all();
-}
-
-void ObjectCache::do_invalidate_all()
-{
-  cache_map.clear();
-  lru.clear();
-
-  lru_size = 0;
-  lru_counter = 0;
-  lru_window = 0;
+    do_invalidate_all(shard);
+  }
 
+  Mutex::Locker l(chained_lock);
   for (list<RGWChainedCache *>::iterator iter = chained_cache.begin(); iter != chained_cache.end(); ++iter) {
     (*iter)->invalidate_all();
   }
 }
 
+void ObjectCache::do_invalidate_all(Shard& shard)
+{
+  shard.cache_map.clear();
+  shard.lru.clear();
+
+  shard.lru_size = 0;
+}
+
 void ObjectCache::chain_cache(RGWChainedCache *cache) {
-  RWLock::WLocker l(lock);
+  Mutex::Locker l(chained_lock);
   chained_cache.push_back(cache);
 }
-
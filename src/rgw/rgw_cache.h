@@ -5,12 +5,15 @@
 #define CEPH_RGWCACHE_H
 
 #include "rgw_rados.h"
+#include <atomic>
 #include <string>
 #include <map>
+#include <unordered_map>
 #include "include/types.h"
 #include "include/utime.h"
 #include "include/assert.h"
 #include "common/RWLock.h"
+#include "common/Mutex.h"
 
 enum {
   UPDATE_OBJ,
@@ -130,39 +133,61 @@ WRITE_CLASS_ENCODER(RGWCacheNotifyInfo)
 struct ObjectCacheEntry {
   ObjectCacheInfo info;
   std::list<string>::iterator lru_iter;
-  uint64_t lru_promotion_ts;
+  std::atomic<bool> referenced; /* hit since it last came up for eviction */
   uint64_t gen;
   std::list<pair<RGWChainedCache *, string> > chained_entries;
 
-  ObjectCacheEntry() : lru_promotion_ts(0), gen(0) {}
+  ObjectCacheEntry() : referenced(false), gen(0) {}
 };
 
 class ObjectCache {
-  std::map<string, ObjectCacheEntry> cache_map;
-  std::list<string> lru;
-  unsigned long lru_size;
-  unsigned long lru_counter;
-  unsigned long lru_window;
-  RWLock lock;
+  /*
+   * Entries are spread over shards by name hash.  Each shard has its own
+   * lock and lru, so that lookups of different objects don't contend.
+   * A hit only marks the entry under the read lock; the lru is reordered
+   * when entries are added, giving marked entries a second chance.
+   */
+  struct Shard {
+    std::unordered_map<string, ObjectCacheEntry> cache_map;
+    std::list<string> lru;
+    unsigned long lru_size;
+    RWLock lock;
+    bool enabled;
+
+    Shard() : lru_size(0), lock("ObjectCache::Shard::lock"), enabled(false) {}
+  };
+
+  vector<Shard *> shards;
+  unsigned long shard_lru_size;
   CephContext *cct;
 
+  Mutex chained_lock;
   list<RGWChainedCache *> chained_cache;
 
-  bool enabled;
+  unsigned shard_index(const string& name) const {
+    return std::hash<string>()(name) % shards.size();
+  }
+  Shard& get_shard(const string& name) {
+    return *shards[shard_index(name)];
+  }
+  void lock_read(Shard& shard);
+  void lock_write(Shard& shard);
 
-  void touch_lru(string& name, ObjectCacheEntry& entry, std::list<string>::iterator& lru_iter);
-  void remove_lru(string& name, std::list<string>::iterator& lru_iter);
+  void touch_lru(Shard& shard, const string& name, ObjectCacheEntry& entry);
+  void remove_lru(Shard& shard, std::list<string>::iterator& lru_iter);
+  void invalidate_chained_entries(ObjectCacheEntry& entry);
+  bool do_chain_cache_entry(list<rgw_cache_entry_info *>& cache_info_entries, RGWChainedCache::Entry *chained_entry);
 
-  void do_invalidate_all();
+  void do_invalidate_all(Shard& shard);
 public:
-  ObjectCache() : lru_size(0), lru_counter(0), lru_window(0), lock("ObjectCache"), cct(NULL), enabled(false) { }
+  /* a single shard until set_ctx() tells how many to use */
+  ObjectCache() : shards(1, new Shard), shard_lru_size(1), cct(NULL),
+                  chained_lock("ObjectCache::chained_lock") { }
+  ~ObjectCache();
   int get(std::string& name, ObjectCacheInfo& bl, uint32_t mask, rgw_cache_entry_info *cache_info);
   void put(std::string& name, ObjectCacheInfo& bl, rgw_cache_entry_info *cache_info);
   void remove(std::string& name);
-  void set_ctx(CephContext *_cct) {
-    cct = _cct;
-    lru_window = cct->_conf->rgw_cache_lru_size / 2;
-  }
+  void set_ctx(CephContext *_cct);
   bool chain_cache_entry(list<rgw_cache_entry_info *>& cache_info_entries, RGWChainedCache::Entry *chained_entry);
 
   void set_enabled(bool status);
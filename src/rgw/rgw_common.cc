@@ -47,10 +47,18 @@ int rgw_perf_start(CephContext *cct)
 
   plb.add_u64_counter(l_rgw_cache_hit, "cache_hit", "Cache hits");
   plb.add_u64_counter(l_rgw_cache_miss, "cache_miss", "Cache miss");
+  plb.add_time_avg(l_rgw_cache_lock_wait, "cache_lock_wait", "Cache shard lock wait");
+
+  plb.add_u64_counter(l_rgw_data_cache_hit, "data_cache_hit", "Data cache hits");
+  plb.add_u64_counter(l_rgw_data_cache_miss, "data_cache_miss", "Data cache miss");
 
   plb.add_u64_counter(l_rgw_keystone_token_cache_hit, "keystone_token_cache_hit", "Keystone token cache hits");
   plb.add_u64_counter(l_rgw_keystone_token_cache_miss, "keystone_token_cache_miss", "Keystone token cache miss");
 
+  plb.add_u64_counter(l_rgw_gc_chains, "gc_chains", "Garbage collection entries processed");
+  plb.add_u64_counter(l_rgw_gc_objs, "gc_objs", "Tail objects removed by garbage collection");
+  plb.add_u64(l_rgw_gc_backlog, "gc_backlog", "Expired garbage collection entries left by the last pass");
+
   perfcounter = plb.create_perf_counters();
   cct->get_perfcounters_collection()->add(perfcounter);
   return 0;
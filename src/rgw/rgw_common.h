@@ -84,6 +84,7 @@ using ceph::crypto::MD5;
 
 #define RGW_ATTR_PG_VER 	RGW_ATTR_PREFIX "pg_ver"
 #define RGW_ATTR_SOURCE_ZONE    RGW_ATTR_PREFIX "source_zone"
+#define RGW_ATTR_COMPRESSION    RGW_ATTR_PREFIX "compression"
 
 #define RGW_ATTR_TEMPURL_KEY1   RGW_ATTR_META_PREFIX "temp-url-key"
 #define RGW_ATTR_TEMPURL_KEY2   RGW_ATTR_META_PREFIX "temp-url-key-2"
@@ -179,6 +180,7 @@ using ceph::crypto::MD5;
 #define ERR_USER_SUSPENDED       2100
 #define ERR_INTERNAL_ERROR       2200
 #define ERR_NOT_IMPLEMENTED      2201
+#define ERR_BUSY_RESHARDING      CLS_RGW_ERR_BUSY_RESHARDING
 
 #ifndef UINT32_MAX
 #define UINT32_MAX (0xffffffffu)
@@ -212,10 +214,18 @@ enum {
 
   l_rgw_cache_hit,
   l_rgw_cache_miss,
+  l_rgw_cache_lock_wait,
+
+  l_rgw_data_cache_hit,
+  l_rgw_data_cache_miss,
 
   l_rgw_keystone_token_cache_hit,
   l_rgw_keystone_token_cache_miss,
 
+  l_rgw_gc_chains,
+  l_rgw_gc_objs,
+  l_rgw_gc_backlog,
+
   l_rgw_last,
 };
 
@@ -1608,6 +1618,68 @@ struct rgw_cache_entry_info {
   rgw_cache_entry_info() : gen(0) {}
 };
 
+/* where a compressed block of object data went */
+struct compression_block {
+  uint64_t old_ofs; /* offset in the original data */
+  uint64_t new_ofs; /* offset in the stored data */
+  uint64_t len;     /* compressed length */
+  string compression_type; /* empty if that of the object, "none" if stored as is */
+
+  compression_block() : old_ofs(0), new_ofs(0), len(0) {}
+
+  void encode(bufferlist& bl) const {
+    ENCODE_START(2, 1, bl);
+    ::encode(old_ofs, bl);
+    ::encode(new_ofs, bl);
+    ::encode(len, bl);
+    ::encode(compression_type, bl);
+    ENCODE_FINISH(bl);
+  }
+
+  void decode(bufferlist::iterator& bl) {
+    DECODE_START(2, bl);
+    ::decode(old_ofs, bl);
+    ::decode(new_ofs, bl);
+    ::decode(len, bl);
+    if (struct_v >= 2) {
+      ::decode(compression_type, bl);
+    }
+    DECODE_FINISH(bl);
+  }
+  void dump(Formatter *f) const;
+};
+WRITE_CLASS_ENCODER(compression_block)
+
+struct RGWCompressionInfo {
+  string compression_type;
+  uint64_t orig_size;
+  vector<compression_block> blocks;
+
+  RGWCompressionInfo() : compression_type("none"), orig_size(0) {}
+
+  bool is_compressed() const {
+    return compression_type != "none";
+  }
+
+  void encode(bufferlist& bl) const {
+    ENCODE_START(1, 1, bl);
+    ::encode(compression_type, bl);
+    ::encode(orig_size, bl);
+    ::encode(blocks, bl);
+    ENCODE_FINISH(bl);
+  }
+
+  void decode(bufferlist::iterator& bl) {
+    DECODE_START(1, bl);
+    ::decode(compression_type, bl);
+    ::decode(orig_size, bl);
+    ::decode(blocks, bl);
+    DECODE_FINISH(bl);
+  }
+  void dump(Formatter *f) const;
+};
+WRITE_CLASS_ENCODER(RGWCompressionInfo)
+
 inline ostream& operator<<(ostream& out, const rgw_obj &o) {
   return out << o.bucket.name << ":" << o.get_object();
 }
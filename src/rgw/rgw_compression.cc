@@ -0,0 +1,214 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "rgw_compression.h"
+
+#define dout_subsys ceph_subsys_rgw
+
+int rgw_compression_info_from_attrset(map<string, bufferlist>& attrs,
+                                      bool& need_decompress,
+                                      RGWCompressionInfo& cs_info)
+{
+  map<string, bufferlist>::iterator iter = attrs.find(RGW_ATTR_COMPRESSION);
+  if (iter == attrs.end()) {
+    need_decompress = false;
+    return 0;
+  }
+
+  bufferlist::iterator bliter = iter->second.begin();
+  try {
+    ::decode(cs_info, bliter);
+  } catch (buffer::error& err) {
+    return -EIO;
+  }
+  need_decompress = cs_info.is_compressed();
+  return 0;
+}
+
+int RGWPutObj_Compress::handle_data(bufferlist& bl, off_t& ofs)
+{
+  if (!compressed || !bl.length()) {
+    return 0;
+  }
+
+  bufferlist out;
+  int r = compressor->compress(bl, out);
+  if (r < 0) {
+    if (ofs == 0) {
+      /* nothing was stored compressed yet, so just don't */
+      ldout(cct, 5) << "NOTICE: failed to compress the first block, storing the object uncompressed" << dendl;
+      compressed = false;
+      return 0;
+    }
+    lderr(cct) << "ERROR: failed to compress data at ofs=" << ofs << " r=" << r << dendl;
+    return -EIO;
+  }
+
+  compression_block block;
+  block.old_ofs = ofs;
+  block.new_ofs = stored_len;
+  block.len = out.length();
+  blocks.push_back(block);
+
+  ofs = stored_len;
+  stored_len += out.length();
+  bl.swap(out);
+  return 0;
+}
+
+void RGWPutObj_Compress::get_attrs(const string& compression_type,
+                                   uint64_t orig_size,
+                                   map<string, bufferlist>& attrs)
+{
+  if (!compressed) {
+    return;
+  }
+
+  RGWCompressionInfo cs_info;
+  cs_info.compression_type = compression_type;
+  cs_info.orig_size = orig_size;
+  cs_info.blocks = blocks;
+
+  bufferlist bl;
+  ::encode(cs_info, bl);
+  attrs[RGW_ATTR_COMPRESSION] = bl;
+
+  ldout(cct, 20) << "compressed " << orig_size << " bytes to " << stored_len
+                 << " bytes with " << compression_type << dendl;
+}
+
+int rgw_compression_get_compressor(CephContext *cct,
+                                   const RGWCompressionInfo& cs_info,
+                                   CompressorRef *compressor)
+{
+  *compressor = Compressor::create(cct, cs_info.compression_type);
+  if (!*compressor) {
+    lderr(cct) << "ERROR: cannot load compressor " << cs_info.compression_type
+               << " to read object data" << dendl;
+    return -EIO;
+  }
+  return 0;
+}
+
+void rgw_compression_add_part(RGWCompressionInfo& cs_info,
+                              const RGWCompressionInfo& part_info,
+                              uint64_t part_size, uint64_t ofs,
+                              uint64_t stored_ofs, uint64_t max_block_size)
+{
+  if (!part_info.is_compressed()) {
+    for (uint64_t o = 0; o < part_size; o += max_block_size) {
+      compression_block block;
+      block.old_ofs = ofs + o;
+      block.new_ofs = stored_ofs + o;
+      block.len = MIN(max_block_size, part_size - o);
+      block.compression_type = "none";
+      cs_info.blocks.push_back(block);
+    }
+    return;
+  }
+
+  /* the first compressed part decides the type of the object */
+  if (!cs_info.is_compressed()) {
+    cs_info.compression_type = part_info.compression_type;
+  }
+
+  vector<compression_block>::const_iterator iter;
+  for (iter = part_info.blocks.begin(); iter != part_info.blocks.end(); ++iter) {
+    compression_block block = *iter;
+    block.old_ofs += ofs;
+    block.new_ofs += stored_ofs;
+    if (block.compression_type.empty() &&
+        part_info.compression_type != cs_info.compression_type) {
+      block.compression_type = part_info.compression_type;
+    }
+    cs_info.blocks.push_back(block);
+  }
+}
+
+/* the index of the block holding the given offset of the original data */
+static size_t find_block(const vector<compression_block>& blocks, uint64_t ofs)
+{
+  size_t first = 0, last = blocks.size();
+  while (last - first > 1) {
+    size_t mid = first + (last - first) / 2;
+    if (blocks[mid].old_ofs <= ofs) {
+      first = mid;
+    } else {
+      last = mid;
+    }
+  }
+  return first;
+}
+
+void RGWGetObj_Decompress::fixup_range(off_t& ofs, off_t& end)
+{
+  const vector<compression_block>& blocks = cs_info->blocks;
+  if (blocks.empty()) {
+    return;
+  }
+
+  size_t first = find_block(blocks, ofs);
+  size_t last = find_block(blocks, end);
+
+  cur_block = first;
+  q_ofs = ofs - blocks[first].old_ofs;
+  q_len = end + 1 - ofs;
+
+  ofs = blocks[first].new_ofs;
+  end = blocks[last].new_ofs + blocks[last].len - 1;
+}
+
+int RGWGetObj_Decompress::decompress_block(const compression_block& block,
+                                           bufferlist& in, bufferlist& out)
+{
+  if (block.compression_type.empty()) {
+    return compressor->decompress(in, out);
+  }
+  if (block.compression_type == "none") {
+    out.claim(in);
+    return 0;
+  }
+
+  CompressorRef& c = other_compressors[block.compression_type];
+  if (!c) {
+    RGWCompressionInfo info;
+    info.compression_type = block.compression_type;
+    int r = rgw_compression_get_compressor(cct, info, &c);
+    if (r < 0) {
+      return r;
+    }
+  }
+  return c->decompress(in, out);
+}
+
+int RGWGetObj_Decompress::handle_data(bufferlist& bl, off_t bl_ofs, off_t bl_len)
+{
+  const vector<compression_block>& blocks = cs_info->blocks;
+
+  bufferlist in;
+  in.substr_of(bl, bl_ofs, bl_len);
+  waiting.claim_append(in);
+
+  while (q_len > 0 && cur_block < blocks.size() &&
+         waiting.length() >= blocks[cur_block].len) {
+    bufferlist block, out;
+    waiting.splice(0, blocks[cur_block].len, &block);
+
+    int r = decompress_block(blocks[cur_block], block, out);
+    if (r < 0 || out.length() <= q_ofs) {
+      lderr(cct) << "ERROR: failed to decompress block at ofs="
+                 << blocks[cur_block].old_ofs << " r=" << r << dendl;
+      return -EIO;
+    }
+
+    uint64_t len = MIN(q_len, out.length() - q_ofs);
+    r = next->handle_data(out, q_ofs, len);
+    if (r < 0) {
+      return r;
+    }
+    q_ofs = 0;
+    q_len -= len;
+    ++cur_block;
+  }
+  return 0;
+}
@@ -0,0 +1,131 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_RGW_COMPRESSION_H
+#define CEPH_RGW_COMPRESSION_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "compressor/Compressor.h"
+#include "rgw_common.h"
+#include "rgw_rados.h"
+
+/**
+ * read the compression info of an object
+ *
+ * @param attrs the object's attrs
+ * @param need_decompress set if the object data is stored compressed
+ * @param cs_info the compression info, if it is
+ * @return 0, or -EIO if the info can't be decoded
+ */
+int rgw_compression_info_from_attrset(map<string, bufferlist>& attrs,
+                                      bool& need_decompress,
+                                      RGWCompressionInfo& cs_info);
+
+/**
+ * load the compressor an object's data was compressed with
+ *
+ * @return 0, or -EIO if it is not available
+ */
+int rgw_compression_get_compressor(CephContext *cct,
+                                   const RGWCompressionInfo& cs_info,
+                                   CompressorRef *compressor);
+
+/**
+ * add a multipart part to the compression info of the completed object
+ *
+ * Parts may be compressed differently from each other, or not at all; the
+ * blocks of the part keep their own compression type, and the data of an
+ * uncompressed part is described by blocks stored as is.
+ *
+ * @param cs_info the info of the object so far
+ * @param part_info the compression info of the part
+ * @param part_size the original size of the part
+ * @param ofs the offset of the part in the original data
+ * @param stored_ofs the offset of the part in the stored data
+ * @param max_block_size the size to split uncompressed parts in
+ */
+void rgw_compression_add_part(RGWCompressionInfo& cs_info,
+                              const RGWCompressionInfo& part_info,
+                              uint64_t part_size, uint64_t ofs,
+                              uint64_t stored_ofs, uint64_t max_block_size);
+
+/**
+ * Compresses the data of an upload.
+ *
+ * Each block of data handed in is compressed on its own, so that a ranged
+ * read only needs to decompress the blocks it touches.  If the first block
+ * can't be compressed the object is stored as is.
+ */
+class RGWPutObj_Compress {
+  CephContext *cct;
+  CompressorRef compressor;
+  bool compressed;
+  std::vector<compression_block> blocks;
+  uint64_t stored_len; /* how much compressed data we handed out */
+
+public:
+  RGWPutObj_Compress(CephContext *_cct, CompressorRef _compressor)
+    : cct(_cct), compressor(_compressor), compressed(true), stored_len(0) {}
+
+  /**
+   * compress the next block of data
+   *
+   * @param bl the data at ofs in the object; replaced by the data to store
+   * @param ofs the offset of the data in the object; replaced by the
+   *            offset to store it at
+   */
+  int handle_data(bufferlist& bl, off_t& ofs);
+
+  bool is_compressed() const {
+    return compressed;
+  }
+
+  /// add the layout of the stored data to the object's attrs
+  void get_attrs(const std::string& compression_type, uint64_t orig_size,
+                 map<string, bufferlist>& attrs);
+};
+
+/**
+ * Decompresses the data read from a compressed object.
+ *
+ * Call fixup_range() to find out which stored data to read for a range of
+ * the original data, then feed what was read to handle_data(); the
+ * requested range is handed to the next callback.
+ */
+class RGWGetObj_Decompress : public RGWGetDataCB {
+  CephContext *cct;
+  RGWCompressionInfo *cs_info;
+  RGWGetDataCB *next;
+  CompressorRef compressor;
+  std::map<std::string, CompressorRef> other_compressors; /* for blocks of other types */
+  size_t cur_block; /* the next block to decompress */
+  uint64_t q_ofs;   /* where the range starts in that block */
+  uint64_t q_len;   /* how much of the range is left */
+  bufferlist waiting;
+
+  int decompress_block(const compression_block& block, bufferlist& in,
+                       bufferlist& out);
+
+public:
+  RGWGetObj_Decompress(CephContext *_cct, RGWCompressionInfo *_cs_info,
+                       CompressorRef _compressor, RGWGetDataCB *_next)
+    : cct(_cct), cs_info(_cs_info), next(_next), compressor(_compressor),
+      cur_block(0), q_ofs(0), q_len(0) {}
+
+  /**
+   * map a range of the original data to the stored data to read
+   *
+   * @param ofs the first byte of the range, replaced by the first stored
+   *            byte to read
+   * @param end the last byte of the range, replaced by the last stored
+   *            byte to read
+   */
+  void fixup_range(off_t& ofs, off_t& end);
+
+  int handle_data(bufferlist& bl, off_t bl_ofs, off_t bl_len);
+};
+
+#endif
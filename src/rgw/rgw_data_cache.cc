@@ -0,0 +1,299 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "common/ceph_context.h"
+#include "common/debug.h"
+#include "common/errno.h"
+
+#include "rgw_common.h"
+#include "rgw_data_cache.h"
+
+#define dout_subsys ceph_subsys_rgw
+
+#undef dout_prefix
+#define dout_prefix (*_dout << "data cache: ")
+
+#define DATA_CACHE_FILE_PREFIX "obj."
+
+using namespace std;
+
+RGWDataCache::RGWDataCache(CephContext *_cct)
+  : cct(_cct), lock("RGWDataCache::lock"),
+    size(0), max_size(cct->_conf->rgw_data_cache_size),
+    max_obj_size(cct->_conf->rgw_data_cache_max_obj_size),
+    path(cct->_conf->rgw_data_cache_path),
+    file_size(0), max_file_size(cct->_conf->rgw_data_cache_path_size),
+    next_file_id(0)
+{
+}
+
+RGWDataCache::~RGWDataCache()
+{
+  list<uint64_t> ids;
+  for (map<string, FileEntry>::iterator iter = file_entries.begin();
+       iter != file_entries.end(); ++iter) {
+    ids.push_back(iter->second.id);
+  }
+  unlink_files(ids);
+}
+
+int RGWDataCache::init()
+{
+  if (path.empty())
+    return 0;
+
+  /* gateways may share the configured directory; each keeps its files in
+   * its own subdirectory, named after the instance */
+  string dirs[2] = { path, path + "/" + cct->_conf->name.to_str() };
+  for (int i = 0; i < 2; i++) {
+    if (::mkdir(dirs[i].c_str(), 0700) < 0 && errno != EEXIST) {
+      int r = -errno;
+      lderr(cct) << "failed to create " << dirs[i] << ": " << cpp_strerror(r)
+		 << dendl;
+      return r;
+    }
+  }
+  path = dirs[1];
+
+  /* we don't know the tags of what an earlier run of this instance left
+   * behind */
+  DIR *dir = ::opendir(path.c_str());
+  if (!dir) {
+    int r = -errno;
+    lderr(cct) << "failed to open " << path << ": " << cpp_strerror(r)
+	       << dendl;
+    return r;
+  }
+  struct dirent *de;
+  while ((de = ::readdir(dir)) != NULL) {
+    if (strncmp(de->d_name, DATA_CACHE_FILE_PREFIX,
+		sizeof(DATA_CACHE_FILE_PREFIX) - 1) != 0)
+      continue;
+    string fn = path + "/" + de->d_name;
+    if (::unlink(fn.c_str()) < 0) {
+      ldout(cct, 0) << "WARNING: failed to remove stale " << fn << ": "
+		    << cpp_strerror(errno) << dendl;
+    }
+  }
+  ::closedir(dir);
+
+  ldout(cct, 1) << "caching up to " << max_size << " bytes in memory and "
+		<< max_file_size << " bytes under " << path << dendl;
+  return 0;
+}
+
+string RGWDataCache::file_name(uint64_t id) const
+{
+  char buf[32];
+  snprintf(buf, sizeof(buf), DATA_CACHE_FILE_PREFIX "%llx",
+	   (unsigned long long)id);
+  return path + "/" + buf;
+}
+
+void RGWDataCache::remove_entry(map<string, Entry>::iterator iter)
+{
+  assert(lock.is_locked());
+  size -= iter->second.data.length();
+  lru.erase(iter->second.lru_iter);
+  entries.erase(iter);
+}
+
+void RGWDataCache::remove_file_entry(map<string, FileEntry>::iterator iter,
+				     list<uint64_t> *unlink_ids)
+{
+  assert(lock.is_locked());
+  file_size -= iter->second.size;
+  file_lru.erase(iter->second.lru_iter);
+  unlink_ids->push_back(iter->second.id);
+  file_entries.erase(iter);
+}
+
+void RGWDataCache::unlink_files(const list<uint64_t>& ids)
+{
+  for (list<uint64_t>::const_iterator iter = ids.begin();
+       iter != ids.end(); ++iter) {
+    string fn = file_name(*iter);
+    if (::unlink(fn.c_str()) < 0 && errno != ENOENT) {
+      ldout(cct, 0) << "WARNING: failed to remove " << fn << ": "
+		    << cpp_strerror(errno) << dendl;
+    }
+  }
+}
+
+bool RGWDataCache::get(const string& name, const bufferlist& tag,
+		       bufferlist& bl)
+{
+  bool in_file = false;
+  uint64_t id = 0;
+  uint64_t len = 0;
+  list<uint64_t> unlink_ids;
+  {
+    Mutex::Locker l(lock);
+
+    map<string, Entry>::iterator iter = entries.find(name);
+    if (iter != entries.end()) {
+      if (iter->second.tag.contents_equal(tag)) {
+	lru.splice(lru.end(), lru, iter->second.lru_iter);
+	bl = iter->second.data;
+	ldout(cct, 20) << "get " << name << ": hit" << dendl;
+	if (perfcounter) perfcounter->inc(l_rgw_data_cache_hit);
+	return true;
+      }
+      ldout(cct, 20) << "get " << name << ": stale" << dendl;
+      remove_entry(iter);
+    }
+
+    map<string, FileEntry>::iterator fiter = file_entries.find(name);
+    if (fiter != file_entries.end()) {
+      if (fiter->second.tag.contents_equal(tag)) {
+	file_lru.splice(file_lru.end(), file_lru, fiter->second.lru_iter);
+	in_file = true;
+	id = fiter->second.id;
+	len = fiter->second.size;
+      } else {
+	remove_file_entry(fiter, &unlink_ids);
+      }
+    }
+  }
+  unlink_files(unlink_ids);
+
+  if (in_file) {
+    /* the file may go away under us if the entry is evicted meanwhile;
+     * that is just a miss */
+    string err;
+    bufferlist data;
+    int r = data.read_file(file_name(id).c_str(), &err);
+    if (r >= 0 && data.length() == len) {
+      ldout(cct, 20) << "get " << name << ": hit in file " << id << dendl;
+      if (perfcounter) perfcounter->inc(l_rgw_data_cache_hit);
+      put(name, tag, data);
+      bl.claim(data);
+      return true;
+    }
+    ldout(cct, 10) << "get " << name << ": failed to read file " << id
+		   << ": " << err << dendl;
+  }
+
+  ldout(cct, 20) << "get " << name << ": miss" << dendl;
+  if (perfcounter) perfcounter->inc(l_rgw_data_cache_miss);
+  return false;
+}
+
+void RGWDataCache::put(const string& name, const bufferlist& tag,
+		       const bufferlist& bl)
+{
+  if (bl.length() > max_obj_size || !tag.length())
+    return;
+
+  list<pair<string, Entry> > evicted;
+  {
+    Mutex::Locker l(lock);
+
+    map<string, Entry>::iterator iter = entries.find(name);
+    if (iter != entries.end()) {
+      remove_entry(iter);
+    }
+
+    Entry& e = entries[name];
+    e.tag = tag;
+    /* the data may share large read buffers; keep only what we account for */
+    e.data = bl;
+    e.data.rebuild();
+    e.lru_iter = lru.insert(lru.end(), name);
+    size += e.data.length();
+
+    while (size > max_size && !lru.empty()) {
+      iter = entries.find(lru.front());
+      assert(iter != entries.end());
+      if (!path.empty()) {
+	map<string, FileEntry>::iterator fiter = file_entries.find(iter->first);
+	if (fiter == file_entries.end() ||
+	    !fiter->second.tag.contents_equal(iter->second.tag)) {
+	  evicted.push_back(make_pair(iter->first, iter->second));
+	}
+      }
+      remove_entry(iter);
+    }
+  }
+
+  for (list<pair<string, Entry> >::iterator iter = evicted.begin();
+       iter != evicted.end(); ++iter) {
+    file_put(iter->first, iter->second.tag, iter->second.data);
+  }
+}
+
+void RGWDataCache::file_put(const string& name, const bufferlist& tag,
+			    bufferlist& data)
+{
+  if (data.length() > max_file_size)
+    return;
+
+  uint64_t id;
+  {
+    Mutex::Locker l(lock);
+    id = next_file_id++;
+  }
+
+  /* write under a fresh name, so a reader never sees a partial file */
+  string fn = file_name(id);
+  int r = data.write_file(fn.c_str(), 0600);
+  if (r < 0) {
+    ldout(cct, 0) << "WARNING: failed to write " << fn << ": "
+		  << cpp_strerror(r) << dendl;
+    return;
+  }
+
+  list<uint64_t> unlink_ids;
+  {
+    Mutex::Locker l(lock);
+
+    map<string, FileEntry>::iterator iter = file_entries.find(name);
+    if (iter != file_entries.end()) {
+      remove_file_entry(iter, &unlink_ids);
+    }
+
+    FileEntry& e = file_entries[name];
+    e.tag = tag;
+    e.size = data.length();
+    e.id = id;
+    e.lru_iter = file_lru.insert(file_lru.end(), name);
+    file_size += e.size;
+
+    while (file_size > max_file_size && !file_lru.empty()) {
+      iter = file_entries.find(file_lru.front());
+      assert(iter != file_entries.end());
+      remove_file_entry(iter, &unlink_ids);
+    }
+  }
+  unlink_files(unlink_ids);
+}
+
+void RGWDataCache::remove(const string& name)
+{
+  list<uint64_t> unlink_ids;
+  {
+    Mutex::Locker l(lock);
+
+    map<string, Entry>::iterator iter = entries.find(name);
+    if (iter != entries.end()) {
+      remove_entry(iter);
+    }
+    map<string, FileEntry>::iterator fiter = file_entries.find(name);
+    if (fiter != file_entries.end()) {
+      remove_file_entry(fiter, &unlink_ids);
+    }
+  }
+  unlink_files(unlink_ids);
+}
+
+bool RGWDataCache::contains(const string& name)
+{
+  Mutex::Locker l(lock);
+  return entries.count(name) || file_entries.count(name);
+}
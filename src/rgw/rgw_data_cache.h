@@ -0,0 +1,103 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_RGW_DATA_CACHE_H
+#define CEPH_RGW_DATA_CACHE_H
+
+#include <list>
+#include <map>
+#include <string>
+
+#include "include/buffer.h"
+#include "common/Mutex.h"
+
+class CephContext;
+
+/**
+ * Gateway-local cache of object data.
+ *
+ * Keeps the data of small objects in memory, and, if rgw_data_cache_path
+ * is set, entries that fall out of memory in files under it (typically on
+ * a local ssd).  Entries are keyed by the object's rados location and
+ * tagged with its id tag, which changes whenever the object is rewritten:
+ * a lookup with a tag fresh from the head object never returns stale
+ * data, on this or any other gateway.  Entries found stale are dropped.
+ */
+class RGWDataCache {
+  struct Entry {
+    bufferlist tag;
+    bufferlist data;
+    std::list<std::string>::iterator lru_iter;
+  };
+
+  struct FileEntry {
+    bufferlist tag;
+    uint64_t size;
+    uint64_t id;        ///< names the file under path
+    std::list<std::string>::iterator lru_iter;
+
+    FileEntry() : size(0), id(0) {}
+  };
+
+  CephContext *cct;
+  Mutex lock;
+
+  std::map<std::string, Entry> entries;
+  std::list<std::string> lru;
+  uint64_t size;
+  uint64_t max_size;
+  uint64_t max_obj_size;
+
+  std::string path;
+  std::map<std::string, FileEntry> file_entries;
+  std::list<std::string> file_lru;
+  uint64_t file_size;
+  uint64_t max_file_size;
+  uint64_t next_file_id;
+
+  std::string file_name(uint64_t id) const;
+  void remove_entry(std::map<std::string, Entry>::iterator iter);
+  void remove_file_entry(std::map<std::string, FileEntry>::iterator iter,
+			 std::list<uint64_t> *unlink_ids);
+  void unlink_files(const std::list<uint64_t>& ids);
+
+  /// add entries evicted from memory to the file tier
+  void file_put(const std::string& name, const bufferlist& tag,
+		bufferlist& data);
+
+public:
+  explicit RGWDataCache(CephContext *_cct);
+  ~RGWDataCache();
+
+  /**
+   * set up the file tier, if any, in a subdirectory of rgw_data_cache_path
+   * named after this instance; files an earlier run left there are removed
+   */
+  int init();
+
+  uint64_t get_max_obj_size() const {
+    return max_obj_size;
+  }
+
+  /**
+   * look up an object's data
+   *
+   * @param name the object's rados location
+   * @param tag the object's current id tag
+   * @param bl the cached data, if found
+   * @return true on a hit
+   */
+  bool get(const std::string& name, const bufferlist& tag, bufferlist& bl);
+
+  /// cache the whole data of an object, unless it is too large
+  void put(const std::string& name, const bufferlist& tag,
+	   const bufferlist& bl);
+
+  /// drop an object's data from both tiers
+  void remove(const std::string& name);
+
+  /// true if some version of the object's data is cached
+  bool contains(const std::string& name);
+};
+
+#endif
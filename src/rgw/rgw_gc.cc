@@ -37,6 +37,8 @@ void RGWGC::initialize(CephContext *_cct, RGWRados *_store) {
     snprintf(buf, 32, ".%d", i);
     obj_names[i].append(buf);
   }
+
+  backlog.resize(max_objs);
 }
 
 void RGWGC::finalize()
@@ -128,6 +130,123 @@ int RGWGC::list(int *index, string& marker, uint32_t max, bool expired_only, std
   return 0;
 }
 
+void RGWGC::update_backlog(int index, uint64_t left)
+{
+  Mutex::Locker l(backlog_lock);
+  backlog[index] = left;
+  if (perfcounter) {
+    uint64_t total = 0;
+    for (vector<uint64_t>::iterator iter = backlog.begin(); iter != backlog.end(); ++iter) {
+      total += *iter;
+    }
+    perfcounter->set(l_rgw_gc_backlog, total);
+  }
+}
+
+RGWGCIOManager::RGWGCIOManager(CephContext *_cct, RGWGC *_gc, int _index)
+  : cct(_cct), gc(_gc), index(_index),
+    max_aio(MAX(1, cct->_conf->rgw_gc_max_concurrent_io)),
+    chains_removed(0)
+{
+}
+
+RGWGCIOManager::~RGWGCIOManager()
+{
+  drain();
+}
+
+void RGWGCIOManager::start_tag(const string& tag)
+{
+  tag_refs[tag]++;
+}
+
+void RGWGCIOManager::schedule_io(IoCtx *ctx, const string& oid,
+                                 ObjectWriteOperation *op, const string& tag)
+{
+  while (ios.size() >= max_aio) {
+    handle_next_completion();
+  }
+
+  librados::AioCompletion *c = librados::Rados::aio_create_completion(NULL, NULL, NULL);
+  int ret = ctx->aio_operate(oid, c, op);
+  if (ret < 0) {
+    c->release();
+    dout(0) << "failed to remove " << oid << " ret=" << ret << dendl;
+    failed_tags.insert(tag);
+    return;
+  }
+  IO io = { c, tag };
+  ios.push_back(io);
+  tag_refs[tag]++;
+}
+
+void RGWGCIOManager::fail_tag(const string& tag)
+{
+  failed_tags.insert(tag);
+}
+
+void RGWGCIOManager::put_tag(const string& tag)
+{
+  map<string, int>::iterator iter = tag_refs.find(tag);
+  assert(iter != tag_refs.end());
+  if (--iter->second > 0) {
+    return;
+  }
+  tag_refs.erase(iter);
+
+  set<string>::iterator fiter = failed_tags.find(tag);
+  if (fiter != failed_tags.end()) {
+    failed_tags.erase(fiter);
+    return;
+  }
+  remove_tags.push_back(tag);
+  ++chains_removed;
+  if (perfcounter) {
+    perfcounter->inc(l_rgw_gc_chains);
+  }
+#define MAX_REMOVE_CHUNK 16
+  if (remove_tags.size() > MAX_REMOVE_CHUNK) {
+    flush_remove_tags();
+  }
+}
+
+void RGWGCIOManager::handle_next_completion()
+{
+  IO& io = ios.front();
+  io.c->wait_for_safe();
+  int ret = io.c->get_return_value();
+  io.c->release();
+  if (ret == -ENOENT) {
+    ret = 0;
+  }
+  if (ret < 0) {
+    dout(0) << "failed to remove a tail object of gc entry " << io.tag << " ret=" << ret << dendl;
+    failed_tags.insert(io.tag);
+  } else if (perfcounter) {
+    perfcounter->inc(l_rgw_gc_objs);
+  }
+  string tag = io.tag;
+  ios.pop_front();
+  put_tag(tag);
+}
+
+void RGWGCIOManager::flush_remove_tags()
+{
+  if (remove_tags.empty()) {
+    return;
+  }
+  gc->remove(index, remove_tags);
+  remove_tags.clear();
+}
+
+void RGWGCIOManager::drain()
+{
+  while (!ios.empty()) {
+    handle_next_completion();
+  }
+  flush_remove_tags();
+}
+
 int RGWGC::process(int index, int max_secs)
 {
   rados::cls::lock::Lock l(gc_index_lock_name);
@@ -155,7 +274,9 @@ int RGWGC::process(int index, int max_secs)
 
   string marker;
   bool truncated;
-  IoCtx *ctx = new IoCtx;
+  uint64_t listed = 0;
+  map<string, IoCtx> ctxs; /* by pool, they must outlive the ios */
+  RGWGCIOManager io_manager(cct, this, index);
   do {
     int max = 100;
     std::list<cls_rgw_gc_obj_info> entries;
@@ -167,10 +288,10 @@ int RGWGC::process(int index, int max_secs)
     if (ret < 0)
       goto done;
 
-    string last_pool;
+    listed += entries.size();
+
     std::list<cls_rgw_gc_obj_info>::iterator iter;
     for (iter = entries.begin(); iter != entries.end(); ++iter) {
-      bool remove_tag;
       cls_rgw_gc_obj_info& info = *iter;
       std::list<cls_rgw_obj>::iterator liter;
       cls_rgw_obj_chain& chain = info.chain;
@@ -179,60 +300,57 @@ int RGWGC::process(int index, int max_secs)
       if (now >= end)
         goto done;
 
-      remove_tag = true;
+      io_manager.start_tag(info.tag);
       for (liter = chain.objs.begin(); liter != chain.objs.end(); ++liter) {
         cls_rgw_obj& obj = *liter;
 
-        if (obj.pool != last_pool) {
-          delete ctx;
-          ctx = new IoCtx;
-	  ret = store->get_rados_handle()->ioctx_create(obj.pool.c_str(), *ctx);
+        map<string, IoCtx>::iterator citer = ctxs.find(obj.pool);
+        if (citer == ctxs.end()) {
+          IoCtx ctx;
+	  ret = store->get_rados_handle()->ioctx_create(obj.pool.c_str(), ctx);
 	  if (ret < 0) {
 	    dout(0) << "ERROR: failed to create ioctx pool=" << obj.pool << dendl;
+            io_manager.fail_tag(info.tag);
 	    continue;
 	  }
-          last_pool = obj.pool;
+          citer = ctxs.insert(make_pair(obj.pool, ctx)).first;
         }
+        IoCtx *ctx = &citer->second;
 
         ctx->locator_set_key(obj.loc);
         rgw_obj key_obj;
         key_obj.set_obj(obj.key.name);
         key_obj.set_instance(obj.key.instance);
 
-	dout(0) << "gc::process: removing " << obj.pool << ":" << key_obj.get_object() << dendl;
+	dout(5) << "gc::process: removing " << obj.pool << ":" << key_obj.get_object() << dendl;
 	ObjectWriteOperation op;
 	cls_refcount_put(op, info.tag, true);
-        ret = ctx->operate(key_obj.get_object(), &op);
-	if (ret == -ENOENT)
-	  ret = 0;
-        if (ret < 0) {
-          remove_tag = false;
-          dout(0) << "failed to remove " << obj.pool << ":" << key_obj.get_object() << "@" << obj.loc << dendl;
-        }
+        io_manager.schedule_io(ctx, key_obj.get_object(), &op, info.tag);
 
-        if (going_down()) // leave early, even if tag isn't removed, it's ok
-          goto done;
-      }
-      if (remove_tag) {
-        remove_tags.push_back(info.tag);
-#define MAX_REMOVE_CHUNK 16
-        if (remove_tags.size() > MAX_REMOVE_CHUNK) {
-          RGWGC::remove(index, remove_tags);
-          remove_tags.clear();
+        if (going_down()) { // leave early, and keep the entry for next time
+          io_manager.fail_tag(info.tag);
+          break;
         }
       }
+      io_manager.put_tag(info.tag);
+
+      if (going_down())
+        goto done;
     }
   } while (truncated);
 
 done:
-  if (!remove_tags.empty())
-    RGWGC::remove(index, remove_tags);
+  io_manager.drain();
   l.unlock(&store->gc_pool_ctx, obj_names[index]);
-  delete ctx;
+  update_backlog(index, listed - MIN(listed, io_manager.chains_removed));
   return 0;
 }
 
-int RGWGC::process()
+/*
+ * Processes the gc objects that belong to worker, out of num_workers
+ * dividing them, starting at a random one.
+ */
+int RGWGC::process_share(int worker, int num_workers)
 {
   int max_secs = cct->_conf->rgw_gc_processor_max_time;
 
@@ -243,6 +361,8 @@ int RGWGC::process()
 
   for (int i = 0; i < max_objs; i++) {
     int index = (i + start) % max_objs;
+    if (index % num_workers != worker)
+      continue;
     ret = process(index, max_secs);
     if (ret < 0)
       return ret;
@@ -258,26 +378,32 @@ bool RGWGC::going_down()
 
 void RGWGC::start_processor()
 {
-  worker = new GCWorker(cct, this);
-  worker->create("rgw_gc");
+  int num_workers = MAX(1, MIN(cct->_conf->rgw_gc_processor_threads, max_objs));
+  for (int i = 0; i < num_workers; i++) {
+    GCWorker *worker = new GCWorker(cct, this, i, num_workers);
+    worker->create("rgw_gc");
+    workers.push_back(worker);
+  }
 }
 
 void RGWGC::stop_processor()
 {
   down_flag.set(1);
-  if (worker) {
-    worker->stop();
-    worker->join();
+  for (vector<GCWorker *>::iterator iter = workers.begin(); iter != workers.end(); ++iter) {
+    (*iter)->stop();
+  }
+  for (vector<GCWorker *>::iterator iter = workers.begin(); iter != workers.end(); ++iter) {
+    (*iter)->join();
+    delete *iter;
   }
-  delete worker;
-  worker = NULL;
+  workers.clear();
 }
 
 void *RGWGC::GCWorker::entry() {
   do {
     utime_t start = ceph_clock_now(cct);
     dout(2) << "garbage collection: start" << dendl;
-    int r = gc->process();
+    int r = gc->process_share(id, num_workers);
     if (r < 0) {
       dout(0) << "ERROR: garbage collection process() returned error r=" << r << dendl;
     }
@@ -4,6 +4,7 @@
 #ifndef CEPH_RGW_GC_H
 #define CEPH_RGW_GC_H
 
+#include <deque>
 
 #include "include/types.h"
 #include "include/atomic.h"
@@ -22,24 +23,31 @@ class RGWGC {
   string *obj_names;
   atomic_t down_flag;
 
+  Mutex backlog_lock;
+  vector<uint64_t> backlog; /* expired entries left behind, per gc object */
+
   int tag_index(const string& tag);
+  void update_backlog(int index, uint64_t left);
 
   class GCWorker : public Thread {
     CephContext *cct;
     RGWGC *gc;
+    int id;
+    int num_workers;
     Mutex lock;
     Cond cond;
 
   public:
-    GCWorker(CephContext *_cct, RGWGC *_gc) : cct(_cct), gc(_gc), lock("GCWorker") {}
+    GCWorker(CephContext *_cct, RGWGC *_gc, int _id, int _num_workers)
+      : cct(_cct), gc(_gc), id(_id), num_workers(_num_workers), lock("GCWorker") {}
     void *entry();
     void stop();
   };
 
-  GCWorker *worker;
+  vector<GCWorker *> workers;
 public:
-  RGWGC() : cct(NULL), store(NULL), max_objs(0), obj_names(NULL), worker(NULL) {}
-  ~RGWGC() {
+  RGWGC() : cct(NULL), store(NULL), max_objs(0), obj_names(NULL), backlog_lock("RGWGC::backlog_lock") {}
+  virtual ~RGWGC() {
     stop_processor();
     finalize();
   }
@@ -47,7 +55,7 @@ public:
   void add_chain(librados::ObjectWriteOperation& op, cls_rgw_obj_chain& chain, const string& tag);
   int send_chain(cls_rgw_obj_chain& chain, const string& tag, bool sync);
   int defer_chain(const string& tag, bool sync);
-  int remove(int index, const std::list<string>& tags);
+  virtual int remove(int index, const std::list<string>& tags);
 
   void initialize(CephContext *_cct, RGWRados *_store);
   void finalize();
@@ -55,12 +63,53 @@ public:
   int list(int *index, string& marker, uint32_t max, bool expired_only, std::list<cls_rgw_gc_obj_info>& result, bool *truncated);
   void list_init(int *index) { *index = 0; }
   int process(int index, int process_max_secs);
-  int process();
+  int process_share(int worker, int num_workers);
+  int process() { return process_share(0, 1); }
 
   bool going_down();
   void start_processor();
   void stop_processor();
 };
 
+/*
+ * Removes the tail objects of the gc entries of one gc object for
+ * RGWGC::process(), keeping up to rgw_gc_max_concurrent_io removals in
+ * flight.  An entry is trimmed once all of its objects are gone; one
+ * marked failed is left for the next pass.
+ */
+class RGWGCIOManager {
+  CephContext *cct;
+  RGWGC *gc;
+  int index;
+  size_t max_aio;
+
+  struct IO {
+    librados::AioCompletion *c;
+    string tag;
+  };
+  std::deque<IO> ios;
+  map<string, int> tag_refs; /* removals pending per entry, +1 while scheduling */
+  set<string> failed_tags;
+  std::list<string> remove_tags;
+
+  void handle_next_completion();
+  void flush_remove_tags();
+
+public:
+  uint64_t chains_removed;
+
+  RGWGCIOManager(CephContext *_cct, RGWGC *_gc, int _index);
+  ~RGWGCIOManager();
+
+  /// start scheduling the removals of an entry's objects
+  void start_tag(const string& tag);
+  void schedule_io(librados::IoCtx *ctx, const string& oid,
+                   librados::ObjectWriteOperation *op, const string& tag);
+  /// keep the entry, whatever happens to its objects
+  void fail_tag(const string& tag);
+  /// done scheduling, or one removal completed
+  void put_tag(const string& tag);
+  void drain();
+};
 
 #endif
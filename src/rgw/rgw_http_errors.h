@@ -66,6 +66,7 @@ const static struct rgw_http_errors RGW_HTTP_ERRORS[] = {
     { ERR_LOCKED, 423, "Locked" },
     { ERR_INTERNAL_ERROR, 500, "InternalError" },
     { ERR_NOT_IMPLEMENTED, 501, "NotImplemented" },
+    { ERR_BUSY_RESHARDING, 503, "ServiceUnavailable" },
 };
 
 const static struct rgw_http_errors RGW_HTTP_SWIFT_ERRORS[] = {
@@ -122,6 +123,7 @@ const static struct rgw_http_status_code http_codes[] = {
   { 422, "Unprocessable Entity" },
   { 500, "Internal Server Error" },
   { 501, "Not Implemented" },
+  { 503, "Service Unavailable" },
   { 0, NULL },
 };
 
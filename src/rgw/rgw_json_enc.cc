@@ -699,6 +699,22 @@ void RGWUploadPartInfo::dump(Formatter *f) const
   encode_json("size", size, f);
   encode_json("etag", etag, f);
   encode_json("modified", modified, f);
+  encode_json("cs_info", cs_info, f);
+}
+
+void compression_block::dump(Formatter *f) const
+{
+  encode_json("old_ofs", old_ofs, f);
+  encode_json("new_ofs", new_ofs, f);
+  encode_json("len", len, f);
+  encode_json("compression_type", compression_type, f);
+}
+
+void RGWCompressionInfo::dump(Formatter *f) const
+{
+  encode_json("compression_type", compression_type, f);
+  encode_json("orig_size", orig_size, f);
+  encode_json("blocks", blocks, f);
 }
 
 void rgw_obj::dump(Formatter *f) const
@@ -808,6 +824,7 @@ void RGWZonePlacementInfo::dump(Formatter *f) const
   encode_json("index_pool", index_pool, f);
   encode_json("data_pool", data_pool, f);
   encode_json("data_extra_pool", data_extra_pool, f);
+  encode_json("compression", compression_type, f);
 }
 
 void RGWZonePlacementInfo::decode_json(JSONObj *obj)
@@ -815,6 +832,7 @@ void RGWZonePlacementInfo::decode_json(JSONObj *obj)
   JSONDecoder::decode_json("index_pool", index_pool, obj);
   JSONDecoder::decode_json("data_pool", data_pool, obj);
   JSONDecoder::decode_json("data_extra_pool", data_extra_pool, obj);
+  JSONDecoder::decode_json("compression", compression_type, obj);
 }
 
 void RGWZoneParams::decode_json(JSONObj *obj)
@@ -26,6 +26,7 @@
 #include "rgw_cors.h"
 #include "rgw_cors_s3.h"
 #include "rgw_rest_conn.h"
+#include "rgw_compression.h"
 
 #include "rgw_client_io.h"
 
@@ -426,7 +427,7 @@ int RGWGetObj::verify_permission()
 {
   obj = rgw_obj(s->bucket, s->object);
   store->set_atomic(s->obj_ctx, obj);
-  if (get_data)
+  if (get_data && !store->obj_data_cached(s->obj_ctx, obj))
     store->set_prefetch_data(s->obj_ctx, obj);
 
   if (!verify_object_permission(s, RGW_PERM_READ))
@@ -649,6 +650,8 @@ int RGWGetObj::read_user_manifest_part(rgw_bucket& bucket,
   uint64_t obj_size;
   RGWObjectCtx obj_ctx(store);
   RGWAccessControlPolicy obj_policy(s->cct);
+  bool need_decompress;
+  RGWCompressionInfo cs_info;
 
   ldout(s->cct, 20) << "reading obj=" << part << " ofs=" << cur_ofs << " end=" << cur_end << dendl;
 
@@ -663,7 +666,20 @@ int RGWGetObj::read_user_manifest_part(rgw_bucket& bucket,
   read_op.params.obj_size = &obj_size;
   read_op.params.perr = &s->err;
 
-  op_ret = read_op.prepare(&cur_ofs, &cur_end);
+  op_ret = read_op.prepare(NULL, NULL);
+  if (op_ret < 0)
+    return op_ret;
+
+  op_ret = rgw_compression_info_from_attrset(attrs, need_decompress, cs_info);
+  if (op_ret < 0) {
+    ldout(s->cct, 0) << "ERROR: failed to decode compression info of " << part << dendl;
+    return op_ret;
+  }
+  if (need_decompress) {
+    obj_size = cs_info.orig_size;
+  }
+
+  op_ret = read_op.range_to_ofs(obj_size, cur_ofs, cur_end);
   if (op_ret < 0)
     return op_ret;
 
@@ -682,6 +698,24 @@ int RGWGetObj::read_user_manifest_part(rgw_bucket& bucket,
   }
 
   perfcounter->inc(l_rgw_get_b, cur_end - cur_ofs);
+
+  if (need_decompress) {
+    if (cur_ofs > cur_end)
+      return 0;
+
+    CompressorRef compressor;
+    op_ret = rgw_compression_get_compressor(s->cct, cs_info, &compressor);
+    if (op_ret < 0)
+      return op_ret;
+
+    RGWGetObj_CB cb(this);
+    RGWGetObj_Decompress decompress(s->cct, &cs_info, compressor, &cb);
+    off_t ofs_x = cur_ofs;
+    off_t end_x = cur_end;
+    decompress.fixup_range(ofs_x, end_x);
+    return read_op.iterate(ofs_x, end_x, &decompress);
+  }
+
   while (cur_ofs <= cur_end) {
     bufferlist bl;
     op_ret = read_op.read(cur_ofs, cur_end, bl);
@@ -1095,6 +1129,12 @@ bool RGWGetObj::prefetch_data()
     }
   }
 
+  /* the data is likely served from the local cache */
+  if (prefetch_first_chunk) {
+    rgw_obj obj(s->bucket, s->object);
+    prefetch_first_chunk = !store->obj_data_cached(s->obj_ctx, obj);
+  }
+
   return get_data && prefetch_first_chunk;
 }
 void RGWGetObj::pre_exec()
@@ -1129,6 +1169,12 @@ void RGWGetObj::execute()
   gc_invalidate_time += (s->cct->_conf->rgw_gc_obj_min_wait / 2);
 
   RGWGetObj_CB cb(this);
+  RGWGetDataCB *filter = &cb;
+  bool need_decompress;
+  RGWCompressionInfo cs_info;
+  CompressorRef compressor;
+  std::unique_ptr<RGWGetObj_Decompress> decompress;
+  off_t ofs_x, end_x;
 
   map<string, bufferlist>::iterator attr_iter;
 
@@ -1146,9 +1192,6 @@ void RGWGetObj::execute()
   if (op_ret < 0)
     goto done_err;
 
-  new_ofs = ofs;
-  new_end = end;
-
   read_op.conds.mod_ptr = mod_ptr;
   read_op.conds.unmod_ptr = unmod_ptr;
   read_op.conds.mod_zone_id = mod_zone_id;
@@ -1157,11 +1200,10 @@ void RGWGetObj::execute()
   read_op.conds.if_nomatch = if_nomatch;
   read_op.params.attrs = &attrs;
   read_op.params.lastmod = &lastmod;
-  read_op.params.read_size = &total_len;
   read_op.params.obj_size = &s->obj_size;
   read_op.params.perr = &s->err;
 
-  op_ret = read_op.prepare(&new_ofs, &new_end);
+  op_ret = read_op.prepare(NULL, NULL);
   if (op_ret < 0)
     goto done_err;
 
@@ -1193,8 +1235,25 @@ void RGWGetObj::execute()
     goto done_err;
   }
 
+  /* the range refers to the data as it was uploaded */
+  op_ret = rgw_compression_info_from_attrset(attrs, need_decompress, cs_info);
+  if (op_ret < 0) {
+    ldout(s->cct, 0) << "ERROR: failed to decode compression info of " << obj << dendl;
+    goto done_err;
+  }
+  if (need_decompress) {
+    s->obj_size = cs_info.orig_size;
+  }
+
+  new_ofs = ofs;
+  new_end = end;
+  op_ret = read_op.range_to_ofs(s->obj_size, new_ofs, new_end);
+  if (op_ret < 0)
+    goto done_err;
+
   ofs = new_ofs;
   end = new_end;
+  total_len = (ofs <= end ? end + 1 - ofs : 0);
 
   start = ofs;
 
@@ -1207,7 +1266,18 @@ void RGWGetObj::execute()
 
   perfcounter->inc(l_rgw_get_b, end - ofs);
 
-  op_ret = read_op.iterate(ofs, end, &cb);
+  ofs_x = ofs;
+  end_x = end;
+  if (need_decompress) {
+    op_ret = rgw_compression_get_compressor(s->cct, cs_info, &compressor);
+    if (op_ret < 0)
+      goto done_err;
+    decompress.reset(new RGWGetObj_Decompress(s->cct, &cs_info, compressor, &cb));
+    decompress->fixup_range(ofs_x, end_x);
+    filter = decompress.get();
+  }
+
+  op_ret = read_op.iterate(ofs_x, end_x, filter);
 
   perfcounter->tinc(l_rgw_get_lat,
                    (ceph_clock_now(s->cct) - start_time));
@@ -1612,9 +1682,10 @@ void RGWListBucket::execute()
   list_op.params.marker = marker;
   list_op.params.end_marker = end_marker;
   list_op.params.list_versions = list_versions;
+  list_op.params.allow_unordered = allow_unordered;
 
   op_ret = list_op.list_objects(max, &objs, &common_prefixes, &is_truncated);
-  if (op_ret >= 0 && !delimiter.empty()) {
+  if (op_ret >= 0 && (!delimiter.empty() || allow_unordered)) {
     next_marker = list_op.get_next_marker();
   }
 }
@@ -2054,6 +2125,14 @@ int RGWPutObjProcessor_Multipart::do_complete(string& etag, time_t *mtime, time_
   info.size = s->obj_size;
   info.modified = ceph_clock_now(store->ctx());
   info.manifest = manifest;
+
+  bool compressed;
+  r = rgw_compression_info_from_attrset(attrs, compressed, info.cs_info);
+  if (r < 0) {
+    ldout(s->cct, 0) << "ERROR: cannot get compression info of part " << part_num << dendl;
+    return r;
+  }
+
   ::encode(info, bl);
 
   string multipart_meta_obj = mp.get_meta();
@@ -2114,6 +2193,8 @@ void RGWPutObj::execute()
   int len;
   map<string, string>::iterator iter;
   bool multipart;
+  std::unique_ptr<RGWPutObj_Compress> compressor;
+  string compression_type;
 
   bool need_calc_md5 = (dlo_manifest == NULL) && (slo_info == NULL);
 
@@ -2182,6 +2263,17 @@ void RGWPutObj::execute()
     goto done;
   }
 
+  compression_type = store->get_compression_type(s->bucket_info.placement_rule);
+  if (compression_type != "none") {
+    CompressorRef plugin = Compressor::create(s->cct, compression_type);
+    if (!plugin) {
+      ldout(s->cct, 1) << "WARNING: cannot load compressor " << compression_type
+		       << ", storing the object uncompressed" << dendl;
+    } else {
+      compressor.reset(new RGWPutObj_Compress(s->cct, plugin));
+    }
+  }
+
   do {
     bufferlist data;
     len = get_data(data);
@@ -2192,6 +2284,19 @@ void RGWPutObj::execute()
     if (!len)
       break;
 
+    /* with compression the data lands elsewhere, and the processor only
+     * sees what gets stored, so we hash it here */
+    off_t stored_ofs = ofs;
+    if (compressor) {
+      if (need_calc_md5) {
+	hash.Update((const byte *)data.c_str(), data.length());
+      }
+      op_ret = compressor->handle_data(data, stored_ofs);
+      if (op_ret < 0) {
+	goto done;
+      }
+    }
+
     /* do we need this operation to be synchronous? if we're dealing with an object with immutable
      * head, e.g., multipart object we need to make sure we're the first one writing to this object
      */
@@ -2203,8 +2308,9 @@ void RGWPutObj::execute()
       orig_data = data;
     }
 
-    op_ret = put_data_and_throttle(processor, data, ofs,
-				  (need_calc_md5 ? &hash : NULL), need_to_wait);
+    op_ret = put_data_and_throttle(processor, data, stored_ofs,
+				  (need_calc_md5 && !compressor ? &hash : NULL),
+				  need_to_wait);
     if (op_ret < 0) {
       if (!need_to_wait || op_ret != -EEXIST) {
         ldout(s->cct, 20) << "processor->thottle_data() returned ret="
@@ -2234,7 +2340,7 @@ void RGWPutObj::execute()
         goto done;
       }
 
-      op_ret = put_data_and_throttle(processor, data, ofs, NULL, false);
+      op_ret = put_data_and_throttle(processor, data, stored_ofs, NULL, false);
       if (op_ret < 0) {
         goto done;
       }
@@ -2259,7 +2365,7 @@ void RGWPutObj::execute()
     goto done;
   }
 
-  if (need_calc_md5) {
+  if (need_calc_md5 && !compressor) {
     processor->complete_hash(&hash);
   }
   hash.Final(m);
@@ -2313,6 +2419,10 @@ void RGWPutObj::execute()
   rgw_get_request_metadata(s->cct, s->info, attrs);
   encode_delete_at_attr(delete_at, attrs);
 
+  if (compressor) {
+    compressor->get_attrs(compression_type, s->obj_size, attrs);
+  }
+
   /* Add a custom metadata to expose the information whether an object
    * is an SLO or not. Appending the attribute must be performed AFTER
    * processing any input from user in order to prohibit overwriting. */
@@ -2365,6 +2475,8 @@ void RGWPostObj::execute()
   MD5 hash;
   bufferlist bl, aclbl;
   int len = 0;
+  std::unique_ptr<RGWPutObj_Compress> compressor;
+  string compression_type;
 
   // read in the data from the POST form
   op_ret = get_params();
@@ -2392,6 +2504,17 @@ void RGWPostObj::execute()
   if (op_ret < 0)
     goto done;
 
+  compression_type = store->get_compression_type(s->bucket_info.placement_rule);
+  if (compression_type != "none") {
+    CompressorRef plugin = Compressor::create(s->cct, compression_type);
+    if (!plugin) {
+      ldout(s->cct, 1) << "WARNING: cannot load compressor " << compression_type
+		       << ", storing the object uncompressed" << dendl;
+    } else {
+      compressor.reset(new RGWPutObj_Compress(s->cct, plugin));
+    }
+  }
+
   while (data_pending) {
      bufferlist data;
      len = get_data(data);
@@ -2404,7 +2527,17 @@ void RGWPostObj::execute()
      if (!len)
        break;
 
-     op_ret = put_data_and_throttle(processor, data, ofs, &hash, false);
+     off_t stored_ofs = ofs;
+     if (compressor) {
+       hash.Update((const byte *)data.c_str(), data.length());
+       op_ret = compressor->handle_data(data, stored_ofs);
+       if (op_ret < 0) {
+	 goto done;
+       }
+     }
+
+     op_ret = put_data_and_throttle(processor, data, stored_ofs,
+				   (compressor ? NULL : &hash), false);
 
      ofs += len;
 
@@ -2427,7 +2560,9 @@ void RGWPostObj::execute()
     goto done;
   }
 
-  processor->complete_hash(&hash);
+  if (!compressor) {
+    processor->complete_hash(&hash);
+  }
   hash.Final(m);
   buf_to_hex(m, CEPH_CRYPTO_MD5_DIGESTSIZE, calc_md5);
 
@@ -2444,6 +2579,10 @@ void RGWPostObj::execute()
     attrs[RGW_ATTR_CONTENT_TYPE] = ct_bl;
   }
 
+  if (compressor) {
+    compressor->get_attrs(compression_type, s->obj_size, attrs);
+  }
+
   op_ret = processor->complete(etag, NULL, 0, attrs, delete_at);
 
 done:
@@ -3678,6 +3817,7 @@ void RGWCompleteMultipart::execute()
   rgw_obj target_obj;
   RGWMPObj mp;
   RGWObjManifest manifest;
+  RGWCompressionInfo cs_info;
   uint64_t olh_epoch = 0;
   string version_id;
 
@@ -3800,10 +3940,15 @@ void RGWCompleteMultipart::execute()
 			 << src_obj << dendl;
         op_ret = -ERR_INVALID_PART;
         return;
-      } else {
-        manifest.append(obj_part.manifest);
       }
 
+      /* the part's blocks move to where the part lands in the object */
+      rgw_compression_add_part(cs_info, obj_part.cs_info, obj_part.size, ofs,
+                               manifest.get_obj_size(),
+                               s->cct->_conf->rgw_max_chunk_size);
+
+      manifest.append(obj_part.manifest);
+
       rgw_obj_key remove_key;
       src_obj.get_index_key(&remove_key);
 
@@ -3824,6 +3969,13 @@ void RGWCompleteMultipart::execute()
 
   attrs[RGW_ATTR_ETAG] = etag_bl;
 
+  if (cs_info.is_compressed()) {
+    cs_info.orig_size = ofs;
+    bufferlist cs_bl;
+    ::encode(cs_info, cs_bl);
+    attrs[RGW_ATTR_COMPRESSION] = cs_bl;
+  }
+
   target_obj.init(s->bucket, s->object.name);
   if (versioned_object) {
     store->gen_rand_obj_instance_name(&target_obj);
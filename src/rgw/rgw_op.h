@@ -385,6 +385,7 @@ protected:
   string delimiter;
   string encoding_type;
   bool list_versions;
+  bool allow_unordered;
   int max;
   vector<RGWObjEnt> objs;
   map<string, bool> common_prefixes;
@@ -397,7 +398,7 @@ protected:
   int parse_max_keys();
 
 public:
-  RGWListBucket() : list_versions(false), max(0),
+  RGWListBucket() : list_versions(false), allow_unordered(false), max(0),
                     default_max(0), is_truncated(false), shard_id(-1) {}
   int verify_permission();
   void pre_exec();
@@ -461,6 +461,7 @@ int RGWOrphanSearch::build_linked_oids_for_bucket(const string& bucket_instance_
   list_op.params.marker = rgw_obj_key(marker);
   list_op.params.list_versions = true;
   list_op.params.enforce_ns = false;
+  list_op.params.allow_unordered = true;
 
   bool truncated;
 
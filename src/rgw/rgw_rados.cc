@@ -55,6 +55,8 @@ using namespace librados;
 
 #include "rgw_gc.h"
 #include "rgw_object_expirer_core.h"
+#include "rgw_data_cache.h"
+#include "rgw_compression.h"
 #include "rgw_sync.h"
 #include "rgw_data_sync.h"
 #include "rgw_realm_watcher.h"
@@ -1477,6 +1479,16 @@ int RGWZoneParams::fix_pool_names()
   return 0;
 }
 
+const string& RGWZoneParams::get_compression_type(const string& placement_rule) const
+{
+  static const string none = "none";
+  map<string, RGWZonePlacementInfo>::const_iterator iter = placement_pools.find(placement_rule);
+  if (iter == placement_pools.end() || iter->second.compression_type.empty()) {
+    return none;
+  }
+  return iter->second.compression_type;
+}
+
 int RGWZoneParams::create(bool exclusive)
 {
   list<string> zones;
@@ -2885,6 +2897,106 @@ int RGWDataNotifier::process()
   return 0;
 }
 
+struct complete_op_data {
+  RGWIndexCompletionThread *manager;
+  rgw_bucket bucket;
+  rgw_obj obj;
+  RGWModifyOp op;
+  string tag;
+  rgw_bucket_entry_ver ver;
+  cls_rgw_obj_key key;
+  rgw_bucket_dir_entry_meta dir_meta;
+  list<cls_rgw_obj_key> remove_objs;
+  bool log_op;
+  uint16_t bilog_flags;
+  utime_t start;
+
+  complete_op_data() : manager(NULL), op(CLS_RGW_OP_UNKNOWN), log_op(false), bilog_flags(0) {}
+};
+
+/*
+ * Index completions are sent without waiting for the result.  Those that
+ * a shard refuses because the bucket index is being resharded end up
+ * here, and are sent again once the bucket has moved to its new layout.
+ */
+class RGWIndexCompletionThread : public RGWRadosThread {
+  Mutex lock;
+  list<complete_op_data *> completions;
+
+  uint64_t interval_msec() {
+    return cct->_conf->rgw_reshard_retry_interval_msec;
+  }
+public:
+  RGWIndexCompletionThread(RGWRados *_store)
+    : RGWRadosThread(_store), lock("RGWIndexCompletionThread") {}
+  ~RGWIndexCompletionThread() {
+    stop();
+    for (list<complete_op_data *>::iterator iter = completions.begin();
+         iter != completions.end(); ++iter) {
+      delete *iter;
+    }
+  }
+
+  void add_completion(complete_op_data *arg) {
+    Mutex::Locker l(lock);
+    completions.push_back(arg);
+  }
+
+  int process();
+};
+
+int RGWIndexCompletionThread::process()
+{
+  list<complete_op_data *> pending;
+  {
+    Mutex::Locker l(lock);
+    pending.swap(completions);
+  }
+
+  utime_t max_wait(cct->_conf->rgw_reshard_max_wait_sec, 0);
+  utime_t now = ceph_clock_now(cct);
+
+  for (list<complete_op_data *>::iterator iter = pending.begin();
+       iter != pending.end(); ++iter) {
+    complete_op_data *c = *iter;
+    if (going_down()) {
+      add_completion(c);
+      continue;
+    }
+
+    RGWRados::BucketShard bs(store);
+    int r = bs.init(c->bucket, c->obj);
+    if (r >= 0) {
+      librados::ObjectWriteOperation o;
+      cls_rgw_bucket_complete_op(o, c->op, c->tag, c->ver, c->key, c->dir_meta,
+                                 &c->remove_objs, c->log_op, c->bilog_flags);
+      r = bs.index_ctx.operate(bs.bucket_obj, &o);
+    }
+    if (r == -ERR_BUSY_RESHARDING && now - c->start < max_wait) {
+      add_completion(c);
+      continue;
+    }
+    if (r < 0) {
+      /* the pending entry is cleaned up once its tag times out */
+      ldout(cct, 0) << "ERROR: failed to complete index op on bucket " << c->bucket
+                    << " key=" << c->key.name << " tag=" << c->tag << " r=" << r << dendl;
+    }
+    delete c;
+  }
+
+  return 0;
+}
+
+static void obj_complete_cb(completion_t cb, void *arg)
+{
+  complete_op_data *c = (complete_op_data *)arg;
+  if (rados_aio_get_return_value(cb) == -ERR_BUSY_RESHARDING) {
+    c->manager->add_completion(c);
+    return;
+  }
+  delete c;
+}
+
 class RGWSyncProcessorThread : public RGWRadosThread {
 public:
   RGWSyncProcessorThread(RGWRados *_store) : RGWRadosThread(_store) {}
@@ -3095,6 +3207,10 @@ void RGWRados::finalize()
     data_notifier->stop();
     delete data_notifier;
   }
+  if (index_completion_thread) {
+    index_completion_thread->stop();
+    delete index_completion_thread;
+  }
   delete meta_mgr;
   delete data_log;
   if (async_rados) {
@@ -3111,6 +3227,9 @@ void RGWRados::finalize()
   delete obj_expirer;
   obj_expirer = NULL;
 
+  delete data_cache;
+  data_cache = NULL;
+
   delete rest_master_conn;
 
   map<string, RGWRESTConn *>::iterator iter;
@@ -3660,6 +3779,15 @@ int RGWRados::init_complete()
 
   obj_expirer = new RGWObjectExpirer(this);
 
+  if (cct->_conf->rgw_data_cache_size > 0) {
+    data_cache = new RGWDataCache(cct);
+    ret = data_cache->init();
+    if (ret < 0) {
+      lderr(cct) << "ERROR: failed to initialize data cache: " << cpp_strerror(-ret) << dendl;
+      return ret;
+    }
+  }
+
   if (use_gc_thread) {
     gc->start_processor();
     obj_expirer->start_processor();
@@ -3713,6 +3841,9 @@ int RGWRados::init_complete()
   data_notifier = new RGWDataNotifier(this);
   data_notifier->start();
 
+  index_completion_thread = new RGWIndexCompletionThread(this);
+  index_completion_thread->start();
+
   quota_handler = RGWQuotaHandler::generate_handler(this, quota_threads);
 
   bucket_index_max_shards = (cct->_conf->rgw_override_bucket_index_max_shards ? cct->_conf->rgw_override_bucket_index_max_shards :
@@ -4721,11 +4852,22 @@ int rgw_policy_from_attrset(CephContext *cct, map<string, bufferlist>& attrset,
  * result: the objects are put in here.
  * common_prefixes: if delim is filled in, any matching prefixes are placed
  *     here.
+ * allow_unordered: return the objects in no particular order, which saves
+ *     merging the listings of all the index shards.  Can't be combined
+ *     with delim.
  */
 int RGWRados::Bucket::List::list_objects(int max, vector<RGWObjEnt> *result,
                                          map<string, bool> *common_prefixes,
                                          bool *is_truncated)
 {
+  if (params.allow_unordered) {
+    if (!params.delim.empty()) {
+      /* common prefixes need the names in order */
+      return -EINVAL;
+    }
+    return list_objects_unordered(max, result, is_truncated);
+  }
+
   RGWRados *store = target->get_store();
   CephContext *cct = store->ctx();
   rgw_bucket& bucket = target->get_bucket();
@@ -4890,6 +5032,104 @@ done:
   return 0;
 }
 
+int RGWRados::Bucket::List::list_objects_unordered(int max, vector<RGWObjEnt> *result,
+                                                   bool *is_truncated)
+{
+  RGWRados *store = target->get_store();
+  CephContext *cct = store->ctx();
+  rgw_bucket& bucket = target->get_bucket();
+  int shard_id = target->get_shard_id();
+
+  int count = 0;
+  bool truncated = true;
+
+  result->clear();
+
+  rgw_obj marker_obj, end_marker_obj, prefix_obj;
+  marker_obj.set_instance(params.marker.instance);
+  marker_obj.set_ns(params.ns);
+  marker_obj.set_obj(params.marker.name);
+  rgw_obj_key cur_marker;
+  marker_obj.get_index_key(&cur_marker);
+
+  end_marker_obj.set_instance(params.end_marker.instance);
+  end_marker_obj.set_ns(params.ns);
+  end_marker_obj.set_obj(params.end_marker.name);
+  rgw_obj_key cur_end_marker;
+  if (params.ns.empty()) { /* no support for end marker for namespaced objects */
+    end_marker_obj.get_index_key(&cur_end_marker);
+  }
+  const bool cur_end_marker_valid = !cur_end_marker.empty();
+
+  prefix_obj.set_ns(params.ns);
+  prefix_obj.set_obj(params.prefix);
+  string cur_prefix = prefix_obj.get_index_key_name();
+
+  /* the marker picks the shard to resume in, so when the caller continues
+   * where we left off, use the exact index key; entries outside of
+   * params.ns don't map back to it through the marker */
+  if (!next_index_marker.empty() && params.marker == next_marker) {
+    cur_marker = next_index_marker;
+  }
+
+  while (truncated && count < max) {
+    vector<RGWObjEnt> ent_list;
+    int r = store->cls_bucket_list_unordered(bucket, shard_id, cur_marker, cur_prefix, max - count,
+                                             params.list_versions, ent_list, &truncated, &cur_marker);
+    if (r < 0)
+      return r;
+
+    /* entries come in no particular order, so unlike list_objects() we
+     * can't stop at the first one past the namespace or end marker */
+    vector<RGWObjEnt>::iterator eiter;
+    for (eiter = ent_list.begin(); eiter != ent_list.end(); ++eiter) {
+      RGWObjEnt& entry = *eiter;
+      rgw_obj_key obj = entry.key;
+      rgw_obj_key key = obj;
+      string instance;
+      string ns;
+
+      bool valid = rgw_obj::parse_raw_oid(obj.name, &obj.name, &instance, &ns);
+      if (!valid) {
+        ldout(cct, 0) << "ERROR: could not parse object name: " << obj.name << dendl;
+        continue;
+      }
+      params.marker = obj;
+      next_marker = obj;
+      next_index_marker = key;
+
+      if (!params.list_versions && !entry.is_visible()) {
+        continue;
+      }
+
+      if (params.enforce_ns && ns != params.ns) {
+        continue;
+      }
+
+      if (cur_end_marker_valid && cur_end_marker <= obj) {
+        continue;
+      }
+
+      if (params.filter && !params.filter->filter(obj.name, key.name))
+        continue;
+
+      if (params.prefix.size() &&  (obj.name.compare(0, params.prefix.size(), params.prefix) != 0))
+        continue;
+
+      RGWObjEnt ent = entry;
+      ent.key = obj;
+      ent.ns = ns;
+      result->push_back(ent);
+      count++;
+    }
+  }
+
+  if (is_truncated)
+    *is_truncated = truncated;
+
+  return 0;
+}
+
 /**
  * create a rados pool, associated meta info
  * returns 0 on success, -ERR# otherwise.
@@ -5753,7 +5993,20 @@ int RGWRados::Object::Write::write_meta(uint64_t size,
   int64_t poolid;
 
   bool orig_exists = state->exists;
-  uint64_t orig_size = state->size;
+  uint64_t orig_size = state->accounted_size;
+
+  /* the index and the quota account for the data as it was uploaded */
+  uint64_t accounted_size = size;
+  bool compressed;
+  RGWCompressionInfo cs_info;
+  r = rgw_compression_info_from_attrset(attrs, compressed, cs_info);
+  if (r < 0) {
+    ldout(store->ctx(), 0) << "ERROR: couldn't decode compression info for object " << obj << dendl;
+    return r;
+  }
+  if (compressed) {
+    accounted_size = cs_info.orig_size;
+  }
 
   bool versioned_target = (meta.olh_epoch > 0 || !obj.get_instance().empty());
 
@@ -5787,7 +6040,7 @@ int RGWRados::Object::Write::write_meta(uint64_t size,
     ldout(store->ctx(), 0) << "ERROR: complete_atomic_modification returned r=" << r << dendl;
   }
 
-  r = index_op.complete(poolid, epoch, size,
+  r = index_op.complete(poolid, epoch, accounted_size,
                         ut, etag, content_type, &acl_bl,
                         meta.category, meta.remove_objs);
   if (r < 0)
@@ -5822,7 +6075,7 @@ int RGWRados::Object::Write::write_meta(uint64_t size,
   meta.canceled = false;
 
   /* update quota cache */
-  store->quota_handler->update_stats(meta.owner, bucket, (orig_exists ? 0 : 1), size, orig_size);
+  store->quota_handler->update_stats(meta.owner, bucket, (orig_exists ? 0 : 1), accounted_size, orig_size);
 
   return 0;
 
@@ -6117,6 +6370,10 @@ static void set_copy_attrs(map<string, bufferlist>& src_attrs,
     if (!attrs[RGW_ATTR_ETAG].length()) {
       attrs[RGW_ATTR_ETAG] = src_attrs[RGW_ATTR_ETAG];
     }
+    /* the data is copied as stored, so is the way to read it */
+    if (src_attrs.find(RGW_ATTR_COMPRESSION) != src_attrs.end()) {
+      attrs[RGW_ATTR_COMPRESSION] = src_attrs[RGW_ATTR_COMPRESSION];
+    }
     break;
   case RGWRados::ATTRSMOD_MERGE:
     for (map<string, bufferlist>::iterator it = src_attrs.begin(); it != src_attrs.end(); ++it) {
@@ -6337,6 +6594,7 @@ int RGWRados::fetch_remote_obj(RGWObjectCtx& obj_ctx,
       JSONDecoder::decode_json("attrs", src_attrs, &jp);
 
       src_attrs.erase(RGW_ATTR_MANIFEST); // not interested in original object layout
+      src_attrs.erase(RGW_ATTR_COMPRESSION); // the data came in decompressed
       if (source_zone.empty()) { /* need to preserve expiration if copy in the same zonegroup */
         src_attrs.erase(RGW_ATTR_DELETE_AT);
       } else {
@@ -6450,13 +6708,33 @@ int RGWRados::copy_obj_to_remote_dest(RGWObjState *astate,
 
   RGWRESTStreamWriteRequest *out_stream_req;
 
-  int ret = rest_master_conn->put_obj_init(user_id, dest_obj, astate->size, src_attrs, &out_stream_req);
+  /* the other zonegroup gets the data as it was uploaded */
+  bool compressed;
+  RGWCompressionInfo cs_info;
+  int ret = rgw_compression_info_from_attrset(src_attrs, compressed, cs_info);
+  if (ret < 0) {
+    return ret;
+  }
+
+  ret = rest_master_conn->put_obj_init(user_id, dest_obj, astate->accounted_size, src_attrs, &out_stream_req);
   if (ret < 0) {
     delete out_stream_req;
     return ret;
   }
 
-  ret = read_op.iterate(0, astate->size - 1, out_stream_req->get_out_cb());
+  if (!compressed) {
+    ret = read_op.iterate(0, astate->size - 1, out_stream_req->get_out_cb());
+  } else if (astate->accounted_size > 0) {
+    CompressorRef compressor;
+    ret = rgw_compression_get_compressor(cct, cs_info, &compressor);
+    if (ret >= 0) {
+      RGWGetObj_Decompress decompress(cct, &cs_info, compressor, out_stream_req->get_out_cb());
+      off_t ofs = 0;
+      off_t end = astate->accounted_size - 1;
+      decompress.fixup_range(ofs, end);
+      ret = read_op.iterate(ofs, end, &decompress);
+    }
+  }
   if (ret < 0)
     return ret;
 
@@ -6467,6 +6745,24 @@ int RGWRados::copy_obj_to_remote_dest(RGWObjState *astate,
   return 0;
 }
 
+/*
+ * Waits for the oldest of the aio ops of a copy; the object it was sent to
+ * is added to done if it succeeded.
+ */
+static int wait_copy_aio(list<pair<librados::AioCompletion *, rgw_obj> >& pending,
+                         vector<rgw_obj>& done)
+{
+  librados::AioCompletion *c = pending.front().first;
+  c->wait_for_safe();
+  int r = c->get_return_value();
+  c->release();
+  if (r >= 0) {
+    done.push_back(pending.front().second);
+  }
+  pending.pop_front();
+  return r;
+}
+
 /**
  * Copy an object.
  * dest_obj: the object to copy into
@@ -6607,6 +6903,13 @@ int RGWRados::copy_obj(RGWObjectCtx& obj_ctx,
     }
   }
 
+  /* data that doesn't fit in the head is copied by the osds rather than
+   * read and written back by us */
+  bool copy_tail = copy_data && obj_size > max_chunk_size && !(dest_obj == src_obj);
+  if (copy_tail) {
+    copy_first = false;
+  }
+
   if (petag) {
     map<string, bufferlist>::iterator iter = attrs.find(RGW_ATTR_ETAG);
     if (iter != attrs.end()) {
@@ -6615,7 +6918,7 @@ int RGWRados::copy_obj(RGWObjectCtx& obj_ctx,
     }
   }
 
-  if (copy_data) { /* refcounting tail wouldn't work here, just copy the data */
+  if (copy_data && !copy_tail) { /* refcounting tail wouldn't work here, just copy the data */
     return copy_obj_data(obj_ctx, dest_bucket_info, read_op, end, dest_obj, src_obj,
                          max_chunk_size, mtime, 0, attrs, category, olh_epoch, delete_at,
                          version_id, ptag, petag, err);
@@ -6629,9 +6932,11 @@ int RGWRados::copy_obj(RGWObjectCtx& obj_ctx,
 
   rgw_rados_ref ref;
   rgw_bucket bucket;
-  ret = get_obj_ref(miter.get_location(), &ref, &bucket);
-  if (ret < 0) {
-    return ret;
+  if (!copy_tail) {
+    ret = get_obj_ref(miter.get_location(), &ref, &bucket);
+    if (ret < 0) {
+      return ret;
+    }
   }
 
   bool versioned_dest = dest_bucket_info.versioning_enabled();
@@ -6662,7 +6967,17 @@ int RGWRados::copy_obj(RGWObjectCtx& obj_ctx,
     append_rand_alpha(cct, tag, tag, 32);
   }
 
-  if (!copy_itself) {
+  if (copy_tail) {
+    ret = copy_obj_tail(astate, src_obj, dest_obj, tag, &manifest, &ref, &ref_objs);
+    if (ret < 0) {
+      return ret;
+    }
+
+    pmanifest = &manifest;
+  } else if (!copy_itself) {
+    const uint32_t max_aio = cct->_conf->rgw_copy_obj_max_aio;
+    list<pair<librados::AioCompletion *, rgw_obj> > pending;
+
     manifest = astate->manifest;
     rgw_bucket& tail_bucket = manifest.get_tail_bucket();
     if (tail_bucket.name.empty()) {
@@ -6670,18 +6985,35 @@ int RGWRados::copy_obj(RGWObjectCtx& obj_ctx,
     }
     string oid, key;
     for (; miter != astate->manifest.obj_end(); ++miter) {
+      if (pending.size() >= max_aio) {
+        ret = wait_copy_aio(pending, ref_objs);
+        if (ret < 0) {
+          break;
+        }
+      }
+
       ObjectWriteOperation op;
       cls_refcount_get(op, tag, true);
       const rgw_obj& loc = miter.get_location();
       get_obj_bucket_and_oid_loc(loc, bucket, oid, key);
       ref.ioctx.locator_set_key(key);
 
-      ret = ref.ioctx.operate(oid, &op);
+      librados::AioCompletion *c = librados::Rados::aio_create_completion(NULL, NULL, NULL);
+      ret = ref.ioctx.aio_operate(oid, c, &op);
       if (ret < 0) {
-        goto done_ret;
+        c->release();
+        break;
       }
-
-      ref_objs.push_back(loc);
+      pending.push_back(make_pair(c, loc));
+    }
+    while (!pending.empty()) {
+      int r = wait_copy_aio(pending, ref_objs);
+      if (r < 0 && ret >= 0) {
+        ret = r;
+      }
+    }
+    if (ret < 0) {
+      goto done_ret;
     }
 
     pmanifest = &manifest;
@@ -6720,6 +7052,8 @@ int RGWRados::copy_obj(RGWObjectCtx& obj_ctx,
 
 done_ret:
   if (!copy_itself) {
+    /* this also removes the copies of copy_obj_tail(), we hold their only
+     * reference */
     vector<rgw_obj>::iterator riter;
 
     string oid, key;
@@ -6815,61 +7149,207 @@ int RGWRados::copy_obj_data(RGWObjectCtx& obj_ctx,
   return ret;
 }
 
-bool RGWRados::is_meta_master()
+/*
+ * Copies all the data of src_obj into new tail objects of dest_obj with
+ * copy-from, so that the tail never passes through the gateway; the head
+ * is read and written back, guarded by the source's idtag.  Up to
+ * rgw_copy_obj_max_aio stripes are copied at a time.  Each copy holds a
+ * single reference, tag; on success manifest describes the copies, tail_objs
+ * lists them and ref can be used to drop them.
+ */
+int RGWRados::copy_obj_tail(RGWObjState *astate, rgw_obj& src_obj, rgw_obj& dest_obj,
+                            const string& tag, RGWObjManifest *manifest,
+                            rgw_rados_ref *ref, vector<rgw_obj> *tail_objs)
 {
-  if (!get_zonegroup().is_master) {
-    return false;
-  }
-
-  return (get_zonegroup().master_zone == zone_public_config.id);
-}
+  const uint32_t max_aio = cct->_conf->rgw_copy_obj_max_aio;
 
-/**
-  * Check to see if the bucket metadata could be synced
-  * bucket: the bucket to check
-  * Returns false is the bucket is not synced
-  */
-bool RGWRados::is_syncing_bucket_meta(rgw_bucket& bucket)
-{
-  /* zonegroup is not master zonegroup */
-  if (!get_zonegroup().is_master) {
-    return false;
+  /* an object without a manifest has all of its data in the head */
+  map<uint64_t, RGWObjManifestPart> src_parts;
+  if (astate->has_manifest) {
+    RGWObjManifest::obj_iterator miter;
+    for (miter = astate->manifest.obj_begin(); miter != astate->manifest.obj_end(); ++miter) {
+      uint64_t stripe_ofs = miter.get_stripe_ofs();
+      uint64_t size = MIN(miter.get_stripe_size(), astate->size - stripe_ofs);
+      if (!size) {
+        continue;
+      }
+      RGWObjManifestPart& part = src_parts[stripe_ofs];
+      part.loc = miter.get_location();
+      part.loc_ofs = miter.location_ofs();
+      part.size = size;
+    }
+  } else {
+    RGWObjManifestPart& part = src_parts[0];
+    part.loc = src_obj;
+    part.size = astate->size;
   }
+  rgw_obj head = (astate->has_manifest ? astate->manifest.get_head() : src_obj);
 
-  /* single zonegroup and a single zone */
-  if (current_period.is_single_zonegroup(cct, this) && get_zonegroup().zones.size() == 1) {
-    return false;
-  }
+  string prefix;
+  append_rand_alpha(cct, dest_obj.get_object(), prefix, 32);
 
-  /* zone is not master */
-  if (get_zonegroup().master_zone.compare(zone_public_config.id) != 0) {
-    return false;
+  rgw_obj tail_obj;
+  tail_obj.init_ns(dest_obj.bucket, prefix, shadow_ns);
+  rgw_bucket bucket;
+  int ret = get_obj_ref(tail_obj, ref, &bucket);
+  if (ret < 0) {
+    return ret;
   }
 
-  return true;
-}
-  
-/**
- * Delete a bucket.
- * bucket: the name of the bucket to delete
- * Returns 0 on success, -ERR# otherwise.
- */
-int RGWRados::delete_bucket(rgw_bucket& bucket, RGWObjVersionTracker& objv_tracker)
-{
-  librados::IoCtx index_ctx;
-  string oid;
-  int r = open_bucket_index(bucket, index_ctx, oid);
-  if (r < 0)
-    return r;
+  /* the copies may come with the references of the source, replace them */
+  list<string> refs;
+  refs.push_back(tag);
 
-  std::map<string, RGWObjEnt> ent_map;
-  rgw_obj_key marker;
-  string prefix;
-  bool is_truncated;
+  list<pair<librados::AioCompletion *, rgw_obj> > pending;
+  map<uint64_t, RGWObjManifestPart> objs;
+  int i = 0;
+  string oid, key;
+  map<uint64_t, RGWObjManifestPart>::iterator iter;
+  for (iter = src_parts.begin(); iter != src_parts.end(); ++iter) {
+    if (pending.size() >= max_aio) {
+      ret = wait_copy_aio(pending, *tail_objs);
+      if (ret < 0) {
+        break;
+      }
+    }
 
-  do {
-#define NUM_ENTRIES 1000
-    r = cls_bucket_list(bucket, RGW_NO_SHARD, marker, prefix, NUM_ENTRIES, true, ent_map,
+    rgw_rados_ref src_ref;
+    ret = get_obj_ref(iter->second.loc, &src_ref, &bucket);
+    if (ret < 0) {
+      break;
+    }
+
+    char buf[16];
+    snprintf(buf, sizeof(buf), "_%d", ++i);
+    RGWObjManifestPart& part = objs[iter->first];
+    part = iter->second;
+    part.loc.init_ns(dest_obj.bucket, prefix + buf, shadow_ns);
+
+    ObjectWriteOperation op;
+    if (iter->second.loc == head) {
+      /* unlike the tail stripes the head may be overwritten under us, so
+       * read it through the same idtag guard as any read of the object */
+      bufferlist bl;
+      ObjectReadOperation rop;
+      if (astate->obj_tag.length() > 0 && !astate->fake_tag) {
+        rop.cmpxattr(RGW_ATTR_ID_TAG, LIBRADOS_CMPXATTR_OP_EQ, astate->obj_tag);
+      }
+      rop.read(iter->second.loc_ofs, iter->second.size, &bl, NULL);
+      ret = src_ref.ioctx.operate(src_ref.oid, &rop, NULL);
+      if (ret < 0) {
+        if (ret == -ECANCELED) {
+          ldout(cct, 5) << src_obj << " was overwritten while being copied" << dendl;
+        }
+        break;
+      }
+      if (bl.length() != iter->second.size) {
+        ldout(cct, 0) << "ERROR: short read of the head of " << src_obj << dendl;
+        ret = -EIO;
+        break;
+      }
+      op.write_full(bl);
+    } else {
+      op.copy_from(src_ref.oid, src_ref.ioctx, 0);
+    }
+    cls_refcount_set(op, refs);
+
+    get_obj_bucket_and_oid_loc(part.loc, bucket, oid, key);
+    ref->ioctx.locator_set_key(key);
+
+    librados::AioCompletion *c = librados::Rados::aio_create_completion(NULL, NULL, NULL);
+    ret = ref->ioctx.aio_operate(oid, c, &op);
+    if (ret < 0) {
+      c->release();
+      break;
+    }
+    pending.push_back(make_pair(c, part.loc));
+  }
+  while (!pending.empty()) {
+    int r = wait_copy_aio(pending, *tail_objs);
+    if (r < 0 && ret >= 0) {
+      ret = r;
+    }
+  }
+
+  if (ret < 0) {
+    ldout(cct, 0) << "ERROR: failed to copy data of " << src_obj << " ret=" << ret << dendl;
+    vector<rgw_obj>::iterator titer;
+    for (titer = tail_objs->begin(); titer != tail_objs->end(); ++titer) {
+      get_obj_bucket_and_oid_loc(*titer, bucket, oid, key);
+      ref->ioctx.locator_set_key(key);
+      int r = ref->ioctx.remove(oid);
+      if (r < 0) {
+        ldout(cct, 0) << "ERROR: failed to remove " << *titer << " r=" << r << dendl;
+      }
+    }
+    tail_objs->clear();
+    return ret;
+  }
+
+  ldout(cct, 20) << "copied " << objs.size() << " stripes of " << src_obj << dendl;
+
+  manifest->set_explicit(astate->size, objs);
+  manifest->set_head(dest_obj);
+  manifest->set_head_size(0);
+
+  return 0;
+}
+
+bool RGWRados::is_meta_master()
+{
+  if (!get_zonegroup().is_master) {
+    return false;
+  }
+
+  return (get_zonegroup().master_zone == zone_public_config.id);
+}
+
+/**
+  * Check to see if the bucket metadata could be synced
+  * bucket: the bucket to check
+  * Returns false is the bucket is not synced
+  */
+bool RGWRados::is_syncing_bucket_meta(rgw_bucket& bucket)
+{
+  /* zonegroup is not master zonegroup */
+  if (!get_zonegroup().is_master) {
+    return false;
+  }
+
+  /* single zonegroup and a single zone */
+  if (current_period.is_single_zonegroup(cct, this) && get_zonegroup().zones.size() == 1) {
+    return false;
+  }
+
+  /* zone is not master */
+  if (get_zonegroup().master_zone.compare(zone_public_config.id) != 0) {
+    return false;
+  }
+
+  return true;
+}
+  
+/**
+ * Delete a bucket.
+ * bucket: the name of the bucket to delete
+ * Returns 0 on success, -ERR# otherwise.
+ */
+int RGWRados::delete_bucket(rgw_bucket& bucket, RGWObjVersionTracker& objv_tracker)
+{
+  librados::IoCtx index_ctx;
+  string oid;
+  int r = open_bucket_index(bucket, index_ctx, oid);
+  if (r < 0)
+    return r;
+
+  std::map<string, RGWObjEnt> ent_map;
+  rgw_obj_key marker;
+  string prefix;
+  bool is_truncated;
+
+  do {
+#define NUM_ENTRIES 1000
+    r = cls_bucket_list(bucket, RGW_NO_SHARD, marker, prefix, NUM_ENTRIES, true, ent_map,
                         &is_truncated, &marker);
     if (r < 0)
       return r;
@@ -7161,6 +7641,334 @@ int RGWRados::bucket_rebuild_index(rgw_bucket& bucket)
   return CLSRGWIssueBucketRebuild(index_ctx, bucket_objs, cct->_conf->rgw_bucket_index_max_aio)();
 }
 
+string RGWRados::bi_key_hash_source(const string& index_key_name)
+{
+  string name, instance, ns;
+  if (!rgw_obj::parse_raw_oid(index_key_name, &name, &instance, &ns))
+    return index_key_name;
+  if (ns == RGW_OBJ_NS_MULTIPART) {
+    /* <key>.<upload_id>.meta */
+    int end_pos = name.rfind('.');
+    int mid_pos = (end_pos > 0 ? (int)name.rfind('.', end_pos - 1) : -1);
+    if (mid_pos >= 0)
+      return name.substr(0, mid_pos);
+  }
+  return name;
+}
+
+static int bi_entry_name(rgw_cls_bi_entry& entry, string *name)
+{
+  bufferlist::iterator iter = entry.data.begin();
+  try {
+    switch (entry.type) {
+    case PlainIdx:
+    case InstanceIdx:
+      {
+        rgw_bucket_dir_entry dirent;
+        ::decode(dirent, iter);
+        *name = dirent.key.name;
+      }
+      break;
+    case OLHIdx:
+      {
+        rgw_bucket_olh_entry olh;
+        ::decode(olh, iter);
+        *name = olh.key.name;
+      }
+      break;
+    default:
+      return -EINVAL;
+    }
+  } catch (buffer::error& err) {
+    return -EIO;
+  }
+  return 0;
+}
+
+/*
+ * Copies the entries of shard oid that belong to another shard under the
+ * new layout (or, if remove is set, removes them from oid).
+ */
+int RGWRados::reshard_bucket_index_shard(librados::IoCtx& index_ctx,
+                                         const string& bucket_oid_base,
+                                         const string& oid, uint32_t num_shards,
+                                         bool remove)
+{
+  const uint32_t max_entries = 1000;
+  const uint32_t max_aio = cct->_conf->rgw_bucket_index_max_aio;
+  list<librados::AioCompletion *> pending;
+  string marker;
+  bool is_truncated = true;
+  int ret = 0;
+
+  while (is_truncated && ret >= 0) {
+    list<rgw_cls_bi_entry> entries;
+    ret = cls_rgw_bi_list(index_ctx, oid, string(), marker, max_entries,
+                          &entries, &is_truncated);
+    if (ret < 0) {
+      ldout(cct, 0) << "ERROR: bi_list on " << oid << " returned " << ret << dendl;
+      break;
+    }
+
+    map<string, librados::ObjectWriteOperation> ops; // by target oid
+    set<string> moved;
+    for (list<rgw_cls_bi_entry>::iterator iter = entries.begin();
+         iter != entries.end(); ++iter) {
+      rgw_cls_bi_entry& entry = *iter;
+      marker = entry.idx;
+
+      string name;
+      ret = bi_entry_name(entry, &name);
+      if (ret < 0) {
+        ldout(cct, 0) << "ERROR: failed to decode bucket index entry idx="
+                      << entry.idx << " on " << oid << dendl;
+        break;
+      }
+      string target_oid;
+      ret = get_bucket_index_object(bucket_oid_base, bi_key_hash_source(name), num_shards,
+                                    RGWBucketInfo::MOD, &target_oid, NULL);
+      if (ret < 0)
+        break;
+      if (target_oid == oid)
+        continue;
+
+      if (remove)
+        moved.insert(entry.idx);
+      else
+        cls_rgw_bi_put(ops[target_oid], target_oid, entry);
+    }
+    if (ret < 0)
+      break;
+
+    if (remove && !moved.empty()) {
+      ops[oid].omap_rm_keys(moved);
+    }
+
+    for (map<string, librados::ObjectWriteOperation>::iterator iter = ops.begin();
+         iter != ops.end(); ++iter) {
+      if (pending.size() >= max_aio) {
+        librados::AioCompletion *c = pending.front();
+        pending.pop_front();
+        c->wait_for_safe();
+        int r = c->get_return_value();
+        c->release();
+        if (r < 0) {
+          ret = r;
+          break;
+        }
+      }
+      librados::AioCompletion *c = librados::Rados::aio_create_completion(NULL, NULL, NULL);
+      ret = index_ctx.aio_operate(iter->first, c, &iter->second);
+      if (ret < 0) {
+        c->release();
+        break;
+      }
+      pending.push_back(c);
+    }
+  }
+
+  while (!pending.empty()) {
+    librados::AioCompletion *c = pending.front();
+    pending.pop_front();
+    c->wait_for_safe();
+    int r = c->get_return_value();
+    c->release();
+    if (r < 0 && ret >= 0)
+      ret = r;
+  }
+  if (ret < 0) {
+    ldout(cct, 0) << "ERROR: resharding " << oid << " returned " << ret << dendl;
+  }
+  return ret;
+}
+
+/**
+ * Reshard a bucket index in place.
+ *
+ * The new shard count must be a multiple of the old one, so that every
+ * entry either stays where it is or moves to one of the new shards
+ * (hash % old == (hash % new) % old).  Copying entries therefore does
+ * not disturb the layout in use, and the switch happens atomically when
+ * the bucket instance is written with the new num_shards, after which
+ * the copied entries are trimmed from the old shards.  The bucket stays
+ * available throughout: reads keep going to the old shards until the
+ * switch, while the old shards are flagged so that they refuse index
+ * updates (-ERR_BUSY_RESHARDING); those wait for the new layout and
+ * retry.  Header stats are recalculated at the end.
+ *
+ * A reshard that was interrupted leaves flagged shards behind.  Running
+ * it again, with any count including the current one, first trims the
+ * entries that do not belong to their shard under the current layout and
+ * clears the flags, whatever state the earlier attempt was left in.
+ */
+int RGWRados::bucket_reshard(RGWBucketInfo& bucket_info,
+                             map<string, bufferlist>& attrs,
+                             uint32_t num_shards)
+{
+  rgw_bucket& bucket = bucket_info.bucket;
+  uint32_t old_num_shards = bucket_info.num_shards;
+
+  if (bucket_info.bucket_index_shard_hash_type != RGWBucketInfo::MOD) {
+    return -ENOTSUP;
+  }
+  if (num_shards < old_num_shards || num_shards > MAX_BUCKET_INDEX_SHARDS_PRIME ||
+      (old_num_shards > 0 && num_shards % old_num_shards != 0) ||
+      (old_num_shards == 0 && num_shards == 1)) {
+    ldout(cct, 0) << "ERROR: can't reshard bucket " << bucket << " from "
+                  << old_num_shards << " to " << num_shards << " shards" << dendl;
+    return -EINVAL;
+  }
+
+  librados::IoCtx index_ctx;
+  string bucket_oid_base;
+  int ret = open_bucket_index_base(bucket, index_ctx, bucket_oid_base);
+  if (ret < 0)
+    return ret;
+
+  map<int, string> old_objs, new_objs;
+  get_bucket_index_objects(bucket_oid_base, old_num_shards, old_objs);
+  get_bucket_index_objects(bucket_oid_base, num_shards, new_objs);
+  if (old_num_shards > 0) {
+    for (uint32_t i = 0; i < old_num_shards; ++i)
+      new_objs.erase(i);
+  }
+
+  map<int, struct rgw_cls_list_ret> headers;
+  ret = CLSRGWIssueGetDirHeader(index_ctx, old_objs, headers, cct->_conf->rgw_bucket_index_max_aio)();
+  if (ret < 0)
+    return ret;
+  bool interrupted = false;
+  for (map<int, struct rgw_cls_list_ret>::iterator iter = headers.begin();
+       iter != headers.end(); ++iter) {
+    if (iter->second.dir.header.resharding)
+      interrupted = true;
+  }
+
+  bool resharding = interrupted;
+  if (interrupted) {
+    // entries copied out before the layout switched are stale where they
+    // are now, and copying them again could overwrite newer ones
+    ldout(cct, 0) << "bucket " << bucket << " index has shards left from an "
+                  << "interrupted reshard, trimming them" << dendl;
+    for (map<int, string>::iterator iter = old_objs.begin();
+         iter != old_objs.end(); ++iter) {
+      ret = reshard_bucket_index_shard(index_ctx, bucket_oid_base,
+                                       iter->second, old_num_shards, true);
+      if (ret < 0)
+        goto out;
+    }
+  }
+
+  if (num_shards == old_num_shards) {
+    if (!interrupted)
+      return 0;
+    goto done;
+  }
+
+  resharding = true;
+  ret = CLSRGWIssueSetBucketResharding(index_ctx, old_objs, cct->_conf->rgw_bucket_index_max_aio, true)();
+  if (ret < 0)
+    goto out;
+
+  // leftovers of an earlier attempt may hold stale entries
+  for (map<int, string>::iterator iter = new_objs.begin();
+       iter != new_objs.end(); ++iter) {
+    ret = index_ctx.remove(iter->second);
+    if (ret < 0 && ret != -ENOENT)
+      goto out;
+  }
+  ret = CLSRGWIssueBucketIndexInit(index_ctx, new_objs, cct->_conf->rgw_bucket_index_max_aio)();
+  if (ret < 0)
+    goto out;
+
+  for (map<int, string>::iterator iter = old_objs.begin();
+       iter != old_objs.end(); ++iter) {
+    ldout(cct, 10) << "resharding " << iter->second << dendl;
+    ret = reshard_bucket_index_shard(index_ctx, bucket_oid_base,
+                                     iter->second, num_shards, false);
+    if (ret < 0)
+      goto out;
+  }
+
+  ret = switch_bucket_index_shards(bucket_info, attrs, num_shards);
+  if (ret < 0)
+    goto out;
+
+  // the new layout is live, drop the entries that moved
+  if (old_num_shards == 0) {
+    ret = index_ctx.remove(old_objs[0]);
+    if (ret == -ENOENT)
+      ret = 0;
+    if (ret >= 0)
+      resharding = false;
+  } else {
+    for (map<int, string>::iterator iter = old_objs.begin();
+         iter != old_objs.end() && ret >= 0; ++iter) {
+      ret = reshard_bucket_index_shard(index_ctx, bucket_oid_base,
+                                       iter->second, num_shards, true);
+    }
+  }
+  if (ret < 0)
+    goto out;
+
+done:
+  if (resharding) {
+    ret = CLSRGWIssueSetBucketResharding(index_ctx, old_objs, cct->_conf->rgw_bucket_index_max_aio, false)();
+    if (ret < 0)
+      goto out;
+    resharding = false;
+  }
+
+  ret = bucket_rebuild_index(bucket);
+
+out:
+  if (resharding) {
+    int r = CLSRGWIssueSetBucketResharding(index_ctx, old_objs, cct->_conf->rgw_bucket_index_max_aio, false)();
+    if (r < 0) {
+      ldout(cct, 0) << "ERROR: failed to clear the resharding flag on the index of bucket "
+                    << bucket << ": r=" << r << ", rerun the reshard to recover" << dendl;
+    }
+  }
+  return ret;
+}
+
+/*
+ * Writes the bucket instance with the new shard count.  The write is
+ * guarded by the instance's version, so an update made to it while the
+ * entries were being copied is not overwritten; the instance is reread
+ * and the switch retried instead.
+ */
+int RGWRados::switch_bucket_index_shards(RGWBucketInfo& bucket_info,
+                                         map<string, bufferlist>& attrs,
+                                         uint32_t num_shards)
+{
+  uint32_t old_num_shards = bucket_info.num_shards;
+  int ret;
+  for (int i = 0; i < 10; ++i) {
+    bucket_info.num_shards = num_shards;
+    ret = put_bucket_instance_info(bucket_info, false, 0, &attrs);
+    if (ret != -ECANCELED)
+      break;
+
+    ldout(cct, 10) << "bucket " << bucket_info.bucket
+                   << " instance changed while resharding, rereading it" << dendl;
+    RGWObjectCtx obj_ctx(this);
+    attrs.clear();
+    ret = get_bucket_instance_info(obj_ctx, bucket_info.bucket, bucket_info, NULL, &attrs);
+    if (ret < 0)
+      return ret;
+    if (bucket_info.num_shards != old_num_shards) {
+      ldout(cct, 0) << "ERROR: bucket " << bucket_info.bucket
+                    << " was resharded concurrently" << dendl;
+      return -EBUSY;
+    }
+  }
+  if (ret < 0) {
+    bucket_info.num_shards = old_num_shards;
+  }
+  return ret;
+}
+
 
 int RGWRados::defer_gc(void *ctx, rgw_obj& obj)
 {
@@ -7317,7 +8125,7 @@ int RGWRados::Object::Delete::delete_obj()
     /* only delete object if mtime is less than or equal to params.unmod_since */
     store->cls_obj_check_mtime(op, utime_t(params.unmod_since, 0), CLS_RGW_CHECK_TIME_MTIME_LE);
   }
-  uint64_t obj_size = state->size;
+  uint64_t obj_size = state->accounted_size;
 
   if (!params.expiration_time.is_zero()) {
     bufferlist bl;
@@ -7624,6 +8432,17 @@ int RGWRados::get_obj_state_impl(RGWObjectCtx *rctx, rgw_obj& obj, RGWObjState *
       s->fake_tag = true;
     }
   }
+  s->accounted_size = s->size;
+  bool compressed;
+  RGWCompressionInfo cs_info;
+  r = rgw_compression_info_from_attrset(s->attrset, compressed, cs_info);
+  if (r < 0) {
+    ldout(cct, 0) << "ERROR: couldn't decode compression info for object " << s->obj << dendl;
+    return r;
+  }
+  if (compressed) {
+    s->accounted_size = cs_info.orig_size;
+  }
   map<string, bufferlist>::iterator aiter = s->attrset.find(RGW_ATTR_PG_VER);
   if (aiter != s->attrset.end()) {
     bufferlist& pg_ver_bl = aiter->second;
@@ -8085,7 +8904,7 @@ int RGWRados::set_attrs(void *ctx, rgw_obj& obj,
       uint64_t epoch = ref.ioctx.get_last_version();
       int64_t poolid = ref.ioctx.get_id();
       utime_t mtime = ceph_clock_now(cct);
-      r = index_op.complete(poolid, epoch, state->size,
+      r = index_op.complete(poolid, epoch, state->accounted_size,
                             mtime, etag, content_type, &acl_bl,
                             RGW_OBJ_CATEGORY_MAIN, NULL);
     } else {
@@ -8224,22 +9043,9 @@ int RGWRados::Object::Read::prepare(int64_t *pofs, int64_t *pend)
   if (pend)
     end = *pend;
 
-  if (ofs < 0) {
-    ofs += astate->size;
-    if (ofs < 0)
-      ofs = 0;
-    end = astate->size - 1;
-  } else if (end < 0) {
-    end = astate->size - 1;
-  }
-
-  if (astate->size > 0) {
-    if (ofs >= (off_t)astate->size) {
-      return -ERANGE;
-    }
-    if (end >= (off_t)astate->size) {
-      end = astate->size - 1;
-    }
+  r = range_to_ofs(astate->size, ofs, end);
+  if (r < 0) {
+    return r;
   }
 
   if (pofs)
@@ -8256,6 +9062,28 @@ int RGWRados::Object::Read::prepare(int64_t *pofs, int64_t *pend)
   return 0;
 }
 
+int RGWRados::Object::Read::range_to_ofs(uint64_t obj_size, int64_t &ofs, int64_t &end)
+{
+  if (ofs < 0) {
+    ofs += obj_size;
+    if (ofs < 0)
+      ofs = 0;
+    end = obj_size - 1;
+  } else if (end < 0) {
+    end = obj_size - 1;
+  }
+
+  if (obj_size > 0) {
+    if (ofs >= (off_t)obj_size) {
+      return -ERANGE;
+    }
+    if (end >= (off_t)obj_size) {
+      end = obj_size - 1;
+    }
+  }
+  return 0;
+}
+
 int RGWRados::SystemObject::get_state(RGWObjState **pstate, RGWObjVersionTracker *objv_tracker)
 {
   return store->get_system_obj_state(&ctx, obj, pstate, objv_tracker);
@@ -8362,7 +9190,7 @@ int RGWRados::Bucket::UpdateIndex::complete(int64_t poolid, uint64_t epoch, uint
   ent.owner_display_name = owner.get_display_name();
   ent.content_type = content_type;
 
-  ret = store->cls_obj_complete_add(*bs, optag, poolid, epoch, ent, category, remove_objs, bilog_flags);
+  ret = store->cls_obj_complete_add(*bs, obj, optag, poolid, epoch, ent, category, remove_objs, bilog_flags);
 
   return ret;
 }
@@ -8936,7 +9764,97 @@ done_err:
   return r;
 }
 
+/* the data cache knows objects by their rados location */
+static string obj_data_cache_name(rgw_obj& obj)
+{
+  rgw_bucket bucket;
+  string oid, loc;
+  get_obj_bucket_and_oid_loc(obj, bucket, oid, loc);
+  return oid;
+}
+
+bool RGWRados::obj_data_cached(void *ctx, rgw_obj& obj)
+{
+  if (!data_cache)
+    return false;
+
+  RGWObjectCtx *rctx = static_cast<RGWObjectCtx *>(ctx);
+
+  /* reads of an olh end up on its current instance, which is what the
+   * cache holds.  Before the head was read we can't tell where it points,
+   * but then a prefetch of the olh head doesn't read any data either */
+  if (!obj.have_instance()) {
+    RGWObjState *s = rctx->get_state(obj);
+    if (s->has_attrs && s->is_olh) {
+      RGWObjState *target;
+      int r = get_obj_state(rctx, obj, &target, true);
+      if (r < 0 || !target->exists)
+        return false;
+      return data_cache->contains(obj_data_cache_name(target->obj));
+    }
+  }
+  return data_cache->contains(obj_data_cache_name(obj));
+}
+
+/* passes the data on, keeping a copy for the data cache */
+class RGWDataCacheFillCB : public RGWGetDataCB {
+  RGWGetDataCB *cb;
+  bufferlist data;
+public:
+  explicit RGWDataCacheFillCB(RGWGetDataCB *_cb) : cb(_cb) {}
+
+  int handle_data(bufferlist& bl, off_t bl_ofs, off_t bl_len) {
+    bufferlist sub;
+    sub.substr_of(bl, bl_ofs, bl_len);
+    data.claim_append(sub);
+    return cb->handle_data(bl, bl_ofs, bl_len);
+  }
+  void set_extra_data_len(uint64_t len) {
+    RGWGetDataCB::set_extra_data_len(len);
+    cb->set_extra_data_len(len);
+  }
+  bufferlist& get_data() { return data; }
+};
+
 int RGWRados::Object::Read::iterate(int64_t ofs, int64_t end, RGWGetDataCB *cb)
+{
+  RGWRados *store = source->get_store();
+  RGWObjectCtx& obj_ctx = source->get_ctx();
+
+  RGWDataCache *data_cache = store->data_cache;
+  if (!data_cache || end < ofs) {
+    return iterate_uncached(ofs, end, cb);
+  }
+
+  RGWObjState *astate;
+  int r = store->get_obj_state(&obj_ctx, state.obj, &astate, NULL);
+  if (r < 0)
+    return r;
+  /* without a tag we couldn't tell a cached copy is current */
+  if (!astate->obj_tag.length() || astate->size > data_cache->get_max_obj_size()) {
+    return iterate_uncached(ofs, end, cb);
+  }
+
+  string name = obj_data_cache_name(state.obj);
+  bufferlist bl;
+  if (data_cache->get(name, astate->obj_tag, bl) && bl.length() == astate->size) {
+    return cb->handle_data(bl, ofs, end - ofs + 1);
+  }
+
+  if (ofs != 0 || (uint64_t)end + 1 != astate->size) {
+    /* only whole objects are cached */
+    return iterate_uncached(ofs, end, cb);
+  }
+
+  RGWDataCacheFillCB fill_cb(cb);
+  r = iterate_uncached(ofs, end, &fill_cb);
+  if (r >= 0 && fill_cb.get_data().length() == astate->size) {
+    data_cache->put(name, astate->obj_tag, fill_cb.get_data());
+  }
+  return r;
+}
+
+int RGWRados::Object::Read::iterate_uncached(int64_t ofs, int64_t end, RGWGetDataCB *cb)
 {
   RGWRados *store = source->get_store();
   CephContext *cct = store->ctx();
@@ -9202,9 +10120,15 @@ int RGWRados::bucket_index_link_olh(RGWObjState& olh_state, rgw_obj& obj_instanc
   }
 
   cls_rgw_obj_key key(obj_instance.get_index_key_name(), obj_instance.get_instance());
-  ret = cls_rgw_bucket_link_olh(bs.index_ctx, bs.bucket_obj, key, olh_state.olh_tag, delete_marker, op_tag, meta, olh_epoch,
-                                unmod_since,
-                                get_zone().log_data);
+  utime_t start = ceph_clock_now(cct);
+  do {
+    ret = cls_rgw_bucket_link_olh(bs.index_ctx, bs.bucket_obj, key, olh_state.olh_tag, delete_marker, op_tag, meta, olh_epoch,
+                                  unmod_since,
+                                  get_zone().log_data);
+    if (ret != -ERR_BUSY_RESHARDING)
+      break;
+    ret = wait_for_reshard(bs, obj_instance, start);
+  } while (ret >= 0);
   if (ret < 0) {
     return ret;
   }
@@ -9235,7 +10159,13 @@ int RGWRados::bucket_index_unlink_instance(rgw_obj& obj_instance, const string&
   }
 
   cls_rgw_obj_key key(obj_instance.get_index_key_name(), obj_instance.get_instance());
-  ret = cls_rgw_bucket_unlink_instance(bs.index_ctx, bs.bucket_obj, key, op_tag, olh_epoch, get_zone().log_data);
+  utime_t start = ceph_clock_now(cct);
+  do {
+    ret = cls_rgw_bucket_unlink_instance(bs.index_ctx, bs.bucket_obj, key, op_tag, olh_epoch, get_zone().log_data);
+    if (ret != -ERR_BUSY_RESHARDING)
+      break;
+    ret = wait_for_reshard(bs, obj_instance, start);
+  } while (ret >= 0);
   if (ret < 0) {
     return ret;
   }
@@ -9294,11 +10224,15 @@ int RGWRados::bucket_index_trim_olh_log(RGWObjState& state, rgw_obj& obj_instanc
 
   cls_rgw_obj_key key(obj_instance.get_index_key_name(), string());
 
-  ObjectWriteOperation op;
-
-  cls_rgw_trim_olh_log(op, key, ver, olh_tag);
-
-  ret = bs.index_ctx.operate(bs.bucket_obj, &op);
+  utime_t start = ceph_clock_now(cct);
+  do {
+    ObjectWriteOperation op;
+    cls_rgw_trim_olh_log(op, key, ver, olh_tag);
+    ret = bs.index_ctx.operate(bs.bucket_obj, &op);
+    if (ret != -ERR_BUSY_RESHARDING)
+      break;
+    ret = wait_for_reshard(bs, obj_instance, start);
+  } while (ret >= 0);
   if (ret < 0)
     return ret;
 
@@ -9325,7 +10259,13 @@ int RGWRados::bucket_index_clear_olh(RGWObjState& state, rgw_obj& obj_instance)
 
   cls_rgw_obj_key key(obj_instance.get_index_key_name(), string());
 
-  ret = cls_rgw_clear_olh(bs.index_ctx, bs.bucket_obj, key, olh_tag);
+  utime_t start = ceph_clock_now(cct);
+  do {
+    ret = cls_rgw_clear_olh(bs.index_ctx, bs.bucket_obj, key, olh_tag);
+    if (ret != -ERR_BUSY_RESHARDING)
+      break;
+    ret = wait_for_reshard(bs, obj_instance, start);
+  } while (ret >= 0);
   if (ret < 0) {
     ldout(cct, 5) << "cls_rgw_clear_olh() returned ret=" << ret << dendl;
     return ret;
@@ -10725,35 +11665,69 @@ int RGWRados::cls_rgw_init_index(librados::IoCtx& index_ctx, librados::ObjectWri
   return r;
 }
 
+/*
+ * Called after the shard in bs refused an index update because the
+ * bucket index is being resharded: waits a bit and points bs at the
+ * shard obj maps to now, or gives up once rgw_reshard_max_wait_sec have
+ * passed since start.
+ */
+int RGWRados::wait_for_reshard(BucketShard& bs, rgw_obj& obj, const utime_t& start)
+{
+  utime_t waited = ceph_clock_now(cct);
+  waited -= start;
+  if (waited >= utime_t(cct->_conf->rgw_reshard_max_wait_sec, 0)) {
+    ldout(cct, 0) << "ERROR: timed out waiting for reshard of bucket " << bs.bucket << dendl;
+    return -ERR_BUSY_RESHARDING;
+  }
+
+  ldout(cct, 10) << "bucket index object " << bs.bucket_obj << " is being resharded, retrying" << dendl;
+  usleep(cct->_conf->rgw_reshard_retry_interval_msec * 1000);
+
+  rgw_bucket bucket = bs.bucket;
+  return bs.init(bucket, obj);
+}
+
 int RGWRados::cls_obj_prepare_op(BucketShard& bs, RGWModifyOp op, string& tag,
                                  rgw_obj& obj, uint16_t bilog_flags)
 {
-  ObjectWriteOperation o;
   cls_rgw_obj_key key(obj.get_index_key_name(), obj.get_instance());
-  cls_rgw_bucket_prepare_op(o, op, tag, key, obj.get_loc(), get_zone().log_data, bilog_flags);
-  int r = bs.index_ctx.operate(bs.bucket_obj, &o);
+  utime_t start = ceph_clock_now(cct);
+  int r;
+  do {
+    ObjectWriteOperation o;
+    cls_rgw_bucket_prepare_op(o, op, tag, key, obj.get_loc(), get_zone().log_data, bilog_flags);
+    r = bs.index_ctx.operate(bs.bucket_obj, &o);
+    if (r != -ERR_BUSY_RESHARDING)
+      break;
+    r = wait_for_reshard(bs, obj, start);
+  } while (r >= 0);
   return r;
 }
 
-int RGWRados::cls_obj_complete_op(BucketShard& bs, RGWModifyOp op, string& tag,
+int RGWRados::cls_obj_complete_op(BucketShard& bs, rgw_obj& obj, RGWModifyOp op, string& tag,
                                   int64_t pool, uint64_t epoch,
                                   RGWObjEnt& ent, RGWObjCategory category,
 				  list<rgw_obj_key> *remove_objs, uint16_t bilog_flags)
 {
-  list<cls_rgw_obj_key> *pro = NULL;
-  list<cls_rgw_obj_key> ro;
+  complete_op_data *arg = new complete_op_data;
+  arg->manager = index_completion_thread;
+  arg->bucket = bs.bucket;
+  arg->obj = obj;
+  arg->op = op;
+  arg->tag = tag;
+  arg->log_op = get_zone().log_data;
+  arg->bilog_flags = bilog_flags;
+  arg->start = ceph_clock_now(cct);
 
   if (remove_objs) {
     for (list<rgw_obj_key>::iterator iter = remove_objs->begin(); iter != remove_objs->end(); ++iter) {
       cls_rgw_obj_key k;
       iter->transform(&k);
-      ro.push_back(k);
+      arg->remove_objs.push_back(k);
     }
-    pro = &ro;
   }
 
-  ObjectWriteOperation o;
-  rgw_bucket_dir_entry_meta dir_meta;
+  rgw_bucket_dir_entry_meta& dir_meta = arg->dir_meta;
   dir_meta.size = ent.size;
   dir_meta.accounted_size = ent.size;
   dir_meta.mtime = utime_t(ent.mtime, 0);
@@ -10763,25 +11737,33 @@ int RGWRados::cls_obj_complete_op(BucketShard& bs, RGWModifyOp op, string& tag,
   dir_meta.content_type = ent.content_type;
   dir_meta.category = category;
 
-  rgw_bucket_entry_ver ver;
-  ver.pool = pool;
-  ver.epoch = epoch;
-  cls_rgw_obj_key key(ent.key.name, ent.key.instance);
-  cls_rgw_bucket_complete_op(o, op, tag, ver, key, dir_meta, pro,
-                             get_zone().log_data, bilog_flags);
+  arg->ver.pool = pool;
+  arg->ver.epoch = epoch;
+  arg->key = cls_rgw_obj_key(ent.key.name, ent.key.instance);
 
-  AioCompletion *c = librados::Rados::aio_create_completion(NULL, NULL, NULL);
+  ObjectWriteOperation o;
+  cls_rgw_bucket_complete_op(o, op, tag, arg->ver, arg->key, dir_meta, &arg->remove_objs,
+                             arg->log_op, bilog_flags);
+
+  if (!index_completion_thread) {
+    delete arg;
+    arg = NULL;
+  }
+  AioCompletion *c = librados::Rados::aio_create_completion(arg, NULL, (arg ? obj_complete_cb : NULL));
   int ret = bs.index_ctx.aio_operate(bs.bucket_obj, c, &o);
+  if (ret < 0) {
+    delete arg;
+  }
   c->release();
   return ret;
 }
 
-int RGWRados::cls_obj_complete_add(BucketShard& bs, string& tag,
+int RGWRados::cls_obj_complete_add(BucketShard& bs, rgw_obj& obj, string& tag,
                                    int64_t pool, uint64_t epoch,
                                    RGWObjEnt& ent, RGWObjCategory category,
                                    list<rgw_obj_key> *remove_objs, uint16_t bilog_flags)
 {
-  return cls_obj_complete_op(bs, CLS_RGW_OP_ADD, tag, pool, epoch, ent, category, remove_objs, bilog_flags);
+  return cls_obj_complete_op(bs, obj, CLS_RGW_OP_ADD, tag, pool, epoch, ent, category, remove_objs, bilog_flags);
 }
 
 int RGWRados::cls_obj_complete_del(BucketShard& bs, string& tag,
@@ -10792,14 +11774,14 @@ int RGWRados::cls_obj_complete_del(BucketShard& bs, string& tag,
 {
   RGWObjEnt ent;
   obj.get_index_key(&ent.key);
-  return cls_obj_complete_op(bs, CLS_RGW_OP_DEL, tag, pool, epoch, ent, RGW_OBJ_CATEGORY_NONE, remove_objs, bilog_flags);
+  return cls_obj_complete_op(bs, obj, CLS_RGW_OP_DEL, tag, pool, epoch, ent, RGW_OBJ_CATEGORY_NONE, remove_objs, bilog_flags);
 }
 
 int RGWRados::cls_obj_complete_cancel(BucketShard& bs, string& tag, rgw_obj& obj, uint16_t bilog_flags)
 {
   RGWObjEnt ent;
   obj.get_index_key(&ent.key);
-  return cls_obj_complete_op(bs, CLS_RGW_OP_CANCEL, tag, -1 /* pool id */, 0, ent, RGW_OBJ_CATEGORY_NONE, NULL, bilog_flags);
+  return cls_obj_complete_op(bs, obj, CLS_RGW_OP_CANCEL, tag, -1 /* pool id */, 0, ent, RGW_OBJ_CATEGORY_NONE, NULL, bilog_flags);
 }
 
 int RGWRados::cls_obj_set_bucket_tag_timeout(rgw_bucket& bucket, uint64_t timeout)
@@ -10928,6 +11910,145 @@ int RGWRados::cls_bucket_list(rgw_bucket& bucket, int shard_id, rgw_obj_key& sta
   return 0;
 }
 
+/*
+ * Unordered listing: rather than merging the shards, walk them one after
+ * another in shard order.  The marker is the last key returned, whose hash
+ * tells us which shard to resume in, so the marker needs no shard
+ * information of its own.  Once the marker's shard is exhausted, the
+ * following shards are all read from their beginning, so we list a batch
+ * of them in parallel.
+ */
+int RGWRados::cls_bucket_list_unordered(rgw_bucket& bucket, int shard_id, rgw_obj_key& start,
+                                        const string& prefix, uint32_t num_entries, bool list_versions,
+                                        vector<RGWObjEnt>& ent_list, bool *is_truncated,
+                                        rgw_obj_key *last_entry,
+                                        bool (*force_check_filter)(const string& name))
+{
+  ldout(cct, 10) << "cls_bucket_list_unordered " << bucket << " start " << start.name << "[" << start.instance << "] num_entries " << num_entries << dendl;
+
+  librados::IoCtx index_ctx;
+  map<int, string> oids;
+  int r = open_bucket_index(bucket, index_ctx, oids, shard_id);
+  if (r < 0)
+    return r;
+
+  map<int, string>::iterator shard_iter = oids.begin();
+  if (shard_id < 0 && !start.empty() && oids.size() > 1) {
+    string oid;
+    int start_shard;
+    r = open_bucket_index_shard(bucket, index_ctx, bi_key_hash_source(start.name), &oid, &start_shard);
+    if (r < 0)
+      return r;
+    shard_iter = oids.find(start_shard);
+    if (shard_iter == oids.end()) {
+      ldout(cct, 0) << "ERROR: " << __func__ << ": marker " << start.name << " maps to shard " << start_shard
+                    << " which the bucket does not have" << dendl;
+      return -EINVAL;
+    }
+  }
+
+  cls_rgw_obj_key marker(start.name, start.instance);
+  cls_rgw_obj_key last_key;
+  bool resume_shard = !start.empty();
+  map<string, bufferlist> updates;
+  uint32_t count = 0;
+
+  while (count < num_entries && shard_iter != oids.end()) {
+    map<int, string> batch;
+    map<int, struct rgw_cls_list_ret> list_results;
+    cls_rgw_obj_key start_key;
+    map<int, string>::iterator iter = shard_iter;
+    if (resume_shard) {
+      /* only the shard we stopped in has a marker */
+      start_key = marker;
+      batch[iter->first] = iter->second;
+    } else {
+      for (uint32_t i = 0; i < cct->_conf->rgw_bucket_index_max_aio && iter != oids.end(); ++i, ++iter) {
+        batch[iter->first] = iter->second;
+      }
+    }
+    r = CLSRGWIssueBucketList(index_ctx, start_key, prefix, num_entries - count, list_versions,
+                              batch, list_results, cct->_conf->rgw_bucket_index_max_aio)();
+    if (r < 0)
+      return r;
+
+    resume_shard = false;
+    for (iter = batch.begin(); iter != batch.end(); ++iter, ++shard_iter) {
+      struct rgw_cls_list_ret& result = list_results[iter->first];
+      map<string, struct rgw_bucket_dir_entry>::iterator eiter = result.dir.m.begin();
+      for (; eiter != result.dir.m.end(); ++eiter) {
+        if (count >= num_entries) {
+          /* stop in the middle of this shard */
+          resume_shard = true;
+          break;
+        }
+        struct rgw_bucket_dir_entry& dirent = eiter->second;
+
+        RGWObjEnt e;
+        e.key.set(dirent.key.name, dirent.key.instance);
+        e.size = dirent.meta.size;
+        e.mtime = dirent.meta.mtime;
+        e.etag = dirent.meta.etag;
+        e.owner = dirent.meta.owner;
+        e.owner_display_name = dirent.meta.owner_display_name;
+        e.content_type = dirent.meta.content_type;
+        e.tag = dirent.tag;
+        e.flags = dirent.flags;
+        e.versioned_epoch = dirent.versioned_epoch;
+
+        marker = dirent.key;
+        last_key = dirent.key;
+
+        bool force_check = force_check_filter && force_check_filter(dirent.key.name);
+        if ((!dirent.exists && !dirent.is_delete_marker()) || !dirent.pending_map.empty() || force_check) {
+          /* there are uncommitted ops. We need to check the current state,
+           * and if the tags are old we need to do cleanup as well. */
+          librados::IoCtx sub_ctx;
+          sub_ctx.dup(index_ctx);
+          r = check_disk_state(sub_ctx, bucket, dirent, e, updates[iter->second]);
+          if (r < 0 && r != -ENOENT) {
+            return r;
+          }
+          if (r == -ENOENT) {
+            continue;
+          }
+        }
+        ldout(cct, 10) << "RGWRados::cls_bucket_list_unordered: got " << e.key.name << "[" << e.key.instance << "]" << dendl;
+        ent_list.push_back(e);
+        ++count;
+      }
+      if (eiter == result.dir.m.end() && result.is_truncated) {
+        /* the shard has more than it returned; go back for the rest */
+        resume_shard = true;
+      }
+      if (resume_shard) {
+        /* anything we got from the shards after this one is read again later */
+        break;
+      }
+      marker = cls_rgw_obj_key();
+    }
+  }
+
+  // Suggest updates if there is any
+  map<string, bufferlist>::iterator miter = updates.begin();
+  for (; miter != updates.end(); ++miter) {
+    if (miter->second.length()) {
+      ObjectWriteOperation o;
+      cls_rgw_suggest_changes(o, miter->second);
+      // we don't care if we lose suggested updates, send them off blindly
+      AioCompletion *c = librados::Rados::aio_create_completion(NULL, NULL, NULL);
+      index_ctx.aio_operate(miter->first, c, &o);
+      c->release();
+    }
+  }
+
+  *is_truncated = (shard_iter != oids.end());
+  if (!last_key.name.empty())
+    *last_entry = rgw_obj_key(last_key.name, last_key.instance);
+
+  return 0;
+}
+
 int RGWRados::cls_obj_usage_log_add(const string& oid, rgw_usage_log_info& info)
 {
   librados::IoCtx io_ctx;
@@ -11068,7 +12189,7 @@ int RGWRados::check_disk_state(librados::IoCtx io_ctx,
   string content_type;
   ACLOwner owner;
 
-  object.size = astate->size;
+  object.size = astate->accounted_size;
   object.mtime = utime_t(astate->mtime, 0);
 
   map<string, bufferlist>::iterator iter = astate->attrset.find(RGW_ATTR_ETAG);
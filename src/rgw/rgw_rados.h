@@ -25,7 +25,9 @@ class ACLOwner;
 class RGWGC;
 class RGWMetaNotifier;
 class RGWDataNotifier;
+class RGWIndexCompletionThread;
 class RGWObjectExpirer;
+class RGWDataCache;
 class RGWMetaSyncProcessorThread;
 class RGWDataSyncProcessorThread;
 class RGWRESTConn;
@@ -293,6 +295,8 @@ public:
     explicit_objs = true;
     obj_size = _size;
     objs.swap(_objs);
+
+    update_iterators();
   }
 
   void get_implicit_location(uint64_t cur_part_id, uint64_t cur_stripe, uint64_t ofs, string *override_prefix, rgw_obj *location);
@@ -581,26 +585,30 @@ struct RGWUploadPartInfo {
   string etag;
   utime_t modified;
   RGWObjManifest manifest;
+  RGWCompressionInfo cs_info;
 
   RGWUploadPartInfo() : num(0), size(0) {}
 
   void encode(bufferlist& bl) const {
-    ENCODE_START(3, 2, bl);
+    ENCODE_START(4, 2, bl);
     ::encode(num, bl);
     ::encode(size, bl);
     ::encode(etag, bl);
     ::encode(modified, bl);
     ::encode(manifest, bl);
+    ::encode(cs_info, bl);
     ENCODE_FINISH(bl);
   }
   void decode(bufferlist::iterator& bl) {
-    DECODE_START_LEGACY_COMPAT_LEN(3, 2, 2, bl);
+    DECODE_START_LEGACY_COMPAT_LEN(4, 2, 2, bl);
     ::decode(num, bl);
     ::decode(size, bl);
     ::decode(etag, bl);
     ::decode(modified, bl);
     if (struct_v >= 3)
       ::decode(manifest, bl);
+    if (struct_v >= 4)
+      ::decode(cs_info, bl);
     DECODE_FINISH(bl);
   }
   void dump(Formatter *f) const;
@@ -613,7 +621,8 @@ struct RGWObjState {
   bool is_atomic;
   bool has_attrs;
   bool exists;
-  uint64_t size;
+  uint64_t size; /* stored size */
+  uint64_t accounted_size; /* size before compression */
   time_t mtime;
   uint64_t epoch;
   bufferlist obj_tag;
@@ -637,7 +646,7 @@ struct RGWObjState {
 
   map<string, bufferlist> attrset;
   RGWObjState() : is_atomic(false), has_attrs(0), exists(false),
-                  size(0), mtime(0), epoch(0), fake_tag(false), has_manifest(false),
+                  size(0), accounted_size(0), mtime(0), epoch(0), fake_tag(false), has_manifest(false),
                   has_data(false), prefetch_data(false), keep_tail(false), is_olh(false),
                   pg_ver(0), zone_short_id(0) {}
   RGWObjState(const RGWObjState& rhs) : obj (rhs.obj) {
@@ -645,6 +654,7 @@ struct RGWObjState {
     has_attrs = rhs.has_attrs;
     exists = rhs.exists;
     size = rhs.size;
+    accounted_size = rhs.accounted_size;
     mtime = rhs.mtime;
     epoch = rhs.epoch;
     if (rhs.obj_tag.length()) {
@@ -809,22 +819,27 @@ struct RGWZonePlacementInfo {
   string index_pool;
   string data_pool;
   string data_extra_pool; /* if not set we should use data_pool */
+  string compression_type; /* compressor plugin for new object data, if any */
 
   void encode(bufferlist& bl) const {
-    ENCODE_START(4, 1, bl);
+    ENCODE_START(5, 1, bl);
     ::encode(index_pool, bl);
     ::encode(data_pool, bl);
     ::encode(data_extra_pool, bl);
+    ::encode(compression_type, bl);
     ENCODE_FINISH(bl);
   }
 
   void decode(bufferlist::iterator& bl) {
-    DECODE_START(4, bl);
+    DECODE_START(5, bl);
     ::decode(index_pool, bl);
     ::decode(data_pool, bl);
     if (struct_v >= 4) {
       ::decode(data_extra_pool, bl);
     }
+    if (struct_v >= 5) {
+      ::decode(compression_type, bl);
+    }
     DECODE_FINISH(bl);
   }
   const string& get_data_extra_pool() {
@@ -878,6 +893,9 @@ struct RGWZoneParams : RGWSystemMetaObj {
   int create_default(bool old_format = false);
   int create(bool exclusive = true);
   int fix_pool_names();
+
+  /// the compressor for new data under a placement rule, or "none"
+  const string& get_compression_type(const string& placement_rule) const;
   
   void encode(bufferlist& bl) const {
     ENCODE_START(6, 1, bl);
@@ -1731,6 +1749,7 @@ class RGWRados
 
   RGWGC *gc;
   RGWObjectExpirer *obj_expirer;
+  RGWDataCache *data_cache;
   bool use_gc_thread;
   bool quota_threads;
   bool run_sync_thread;
@@ -1739,6 +1758,7 @@ class RGWRados
 
   RGWMetaNotifier *meta_notifier;
   RGWDataNotifier *data_notifier;
+  RGWIndexCompletionThread *index_completion_thread;
   RGWMetaSyncProcessorThread *meta_sync_processor_thread;
   map<string, RGWDataSyncProcessorThread *> data_sync_processor_threads;
 
@@ -1809,9 +1829,10 @@ protected:
   RGWPeriod current_period;
 public:
   RGWRados() : max_req_id(0), lock("rados_timer_lock"), watchers_lock("watchers_lock"), timer(NULL),
-               gc(NULL), obj_expirer(NULL), use_gc_thread(false), quota_threads(false),
+               gc(NULL), obj_expirer(NULL), data_cache(NULL), use_gc_thread(false), quota_threads(false),
                run_sync_thread(false), async_rados(nullptr), meta_notifier(NULL),
-               data_notifier(NULL), meta_sync_processor_thread(NULL),
+               data_notifier(NULL), index_completion_thread(NULL),
+               meta_sync_processor_thread(NULL),
                meta_sync_thread_lock("meta_sync_thread_lock"), data_sync_thread_lock("data_sync_thread_lock"),
                num_watchers(0), watchers(NULL),
                watch_initialized(false),
@@ -1905,6 +1926,14 @@ public:
     return zone_public_config;
   }
 
+  /// the compression of a placement target; empty means the default one
+  const string& get_compression_type(const string& placement_rule) {
+    if (placement_rule.empty()) {
+      return zone_params.get_compression_type(zonegroup.default_placement);
+    }
+    return zone_params.get_compression_type(placement_rule);
+  }
+
   uint32_t get_zone_short_id() const {
     return zone_short_id;
   }
@@ -2181,12 +2210,19 @@ public:
         Params() : lastmod(NULL), read_size(NULL), obj_size(NULL), attrs(NULL), perr(NULL) {}
       } params;
 
+    private:
+      int iterate_uncached(int64_t ofs, int64_t end, RGWGetDataCB *cb);
+
+    public:
       explicit Read(RGWRados::Object *_source) : source(_source) {}
 
       int prepare(int64_t *pofs, int64_t *pend);
       int read(int64_t ofs, int64_t end, bufferlist& bl);
       int iterate(int64_t ofs, int64_t end, RGWGetDataCB *cb);
       int get_attr(const char *name, bufferlist& dest);
+
+      /// resolve a requested range (negative ofs counts from the end) against obj_size
+      static int range_to_ofs(uint64_t obj_size, int64_t &ofs, int64_t &end);
     };
 
     struct Write {
@@ -2341,6 +2377,7 @@ public:
     struct List {
       RGWRados::Bucket *target;
       rgw_obj_key next_marker;
+      rgw_obj_key next_index_marker; /* index key of next_marker, see list_objects_unordered() */
 
       struct Params {
         string prefix;
@@ -2351,10 +2388,14 @@ public:
         bool enforce_ns;
         RGWAccessListFilter *filter;
         bool list_versions;
+        bool allow_unordered;
 
-        Params() : enforce_ns(true), filter(NULL), list_versions(false) {}
+        Params() : enforce_ns(true), filter(NULL), list_versions(false), allow_unordered(false) {}
       } params;
 
+    private:
+      int list_objects_unordered(int max, vector<RGWObjEnt> *result, bool *is_truncated);
+
     public:
       explicit List(RGWRados::Bucket *_target) : target(_target) {}
 
@@ -2495,6 +2536,10 @@ public:
                string *petag,
                struct rgw_err *err);
 
+  int copy_obj_tail(RGWObjState *astate, rgw_obj& src_obj, rgw_obj& dest_obj,
+                    const string& tag, RGWObjManifest *manifest,
+                    rgw_rados_ref *ref, vector<rgw_obj> *tail_objs);
+
   /**
    * Delete a bucket.
    * bucket: the name of the bucket to delete
@@ -2665,6 +2710,9 @@ public:
     RGWObjectCtx *rctx = static_cast<RGWObjectCtx *>(ctx);
     rctx->set_atomic(obj);
   }
+  /// true if the local data cache may hold the object's data
+  bool obj_data_cached(void *ctx, rgw_obj& obj);
+
   void set_prefetch_data(void *ctx, rgw_obj& obj) {
     RGWObjectCtx *rctx = static_cast<RGWObjectCtx *>(ctx);
     rctx->set_prefetch_data(obj);
@@ -2702,10 +2750,11 @@ public:
                                      map<string, bufferlist> *pattrs, bool create_entry_point);
 
   int cls_rgw_init_index(librados::IoCtx& io_ctx, librados::ObjectWriteOperation& op, string& oid);
+  int wait_for_reshard(BucketShard& bs, rgw_obj& obj, const utime_t& start);
   int cls_obj_prepare_op(BucketShard& bs, RGWModifyOp op, string& tag, rgw_obj& obj, uint16_t bilog_flags);
-  int cls_obj_complete_op(BucketShard& bs, RGWModifyOp op, string& tag, int64_t pool, uint64_t epoch,
+  int cls_obj_complete_op(BucketShard& bs, rgw_obj& obj, RGWModifyOp op, string& tag, int64_t pool, uint64_t epoch,
                           RGWObjEnt& ent, RGWObjCategory category, list<rgw_obj_key> *remove_objs, uint16_t bilog_flags);
-  int cls_obj_complete_add(BucketShard& bs, string& tag, int64_t pool, uint64_t epoch, RGWObjEnt& ent,
+  int cls_obj_complete_add(BucketShard& bs, rgw_obj& obj, string& tag, int64_t pool, uint64_t epoch, RGWObjEnt& ent,
                            RGWObjCategory category, list<rgw_obj_key> *remove_objs, uint16_t bilog_flags);
   int cls_obj_complete_del(BucketShard& bs, string& tag, int64_t pool, uint64_t epoch, rgw_obj& obj,
                            list<rgw_obj_key> *remove_objs, uint16_t bilog_flags);
@@ -2715,6 +2764,10 @@ public:
                       uint32_t num_entries, bool list_versions, map<string, RGWObjEnt>& m,
                       bool *is_truncated, rgw_obj_key *last_entry,
                       bool (*force_check_filter)(const string&  name) = NULL);
+  int cls_bucket_list_unordered(rgw_bucket& bucket, int shard_id, rgw_obj_key& start, const string& prefix,
+                                uint32_t num_entries, bool list_versions, vector<RGWObjEnt>& ent_list,
+                                bool *is_truncated, rgw_obj_key *last_entry,
+                                bool (*force_check_filter)(const string&  name) = NULL);
   int cls_bucket_head(rgw_bucket& bucket, int shard_id, map<string, struct rgw_bucket_dir_header>& headers, map<int, string> *bucket_instance_ids = NULL);
   int cls_bucket_head_async(rgw_bucket& bucket, int shard_id, RGWGetDirHeader_CB *ctx, int *num_aio);
   int list_bi_log_entries(rgw_bucket& bucket, int shard_id, string& marker, uint32_t max, std::list<rgw_bi_log_entry>& result, bool *truncated);
@@ -2791,6 +2844,10 @@ public:
                          map<RGWObjCategory, RGWStorageStats> *existing_stats,
                          map<RGWObjCategory, RGWStorageStats> *calculated_stats);
   int bucket_rebuild_index(rgw_bucket& bucket);
+  int bucket_reshard(RGWBucketInfo& bucket_info,
+                     map<string, bufferlist>& attrs, uint32_t num_shards);
+  int switch_bucket_index_shards(RGWBucketInfo& bucket_info,
+                                 map<string, bufferlist>& attrs, uint32_t num_shards);
   int remove_objs_from_index(rgw_bucket& bucket, list<rgw_obj_key>& oid_list);
   int move_rados_obj(librados::IoCtx& src_ioctx,
 		     const string& src_oid, const string& src_locator,
@@ -2874,18 +2931,6 @@ public:
 
   librados::Rados* get_rados_handle();
 
- private:
-  /**
-   * This is a helper method, it generates a list of bucket index objects with the given
-   * bucket base oid and number of shards.
-   *
-   * bucket_oid_base [in] - base name of the bucket index object;
-   * num_shards [in] - number of bucket index object shards.
-   * bucket_objs [out] - filled by this method, a list of bucket index objects.
-   */
-  void get_bucket_index_objects(const string& bucket_oid_base, uint32_t num_shards,
-      map<int, string>& bucket_objs, int shard_id = -1);
-
   /**
    * Get the bucket index object with the given base bucket index object and object key,
    * and the number of bucket index shards.
@@ -2898,9 +2943,31 @@ public:
    *
    * Return 0 on success, a failure code otherwise.
    */
-  int get_bucket_index_object(const string& bucket_oid_base, const string& obj_key,
+  static int get_bucket_index_object(const string& bucket_oid_base, const string& obj_key,
       uint32_t num_shards, RGWBucketInfo::BIShardsHashType hash_type, string *bucket_obj, int *shard);
 
+  /**
+   * Get the key that picks the index shard of an index entry, given the
+   * entry's name: usually the name itself, but multipart upload meta
+   * objects go with the object being uploaded.
+   */
+  static string bi_key_hash_source(const string& index_key_name);
+
+ private:
+  /**
+   * This is a helper method, it generates a list of bucket index objects with the given
+   * bucket base oid and number of shards.
+   *
+   * bucket_oid_base [in] - base name of the bucket index object;
+   * num_shards [in] - number of bucket index object shards.
+   * bucket_objs [out] - filled by this method, a list of bucket index objects.
+   */
+  void get_bucket_index_objects(const string& bucket_oid_base, uint32_t num_shards,
+      map<int, string>& bucket_objs, int shard_id = -1);
+
+  int reshard_bucket_index_shard(librados::IoCtx& index_ctx, const string& bucket_oid_base,
+                                 const string& oid, uint32_t num_shards, bool remove);
+
   /**
    * Check the actual on-disk state of the object specified
    * by list_state, and fill in the time and size of object.
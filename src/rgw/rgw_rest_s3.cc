@@ -318,6 +318,10 @@ int RGWListBucket_ObjStore_S3::get_params()
   }
   delimiter = s->info.args.get("delimiter");
   encoding_type = s->info.args.get("encoding-type");
+  s->info.args.get_bool("allow-unordered", &allow_unordered, false);
+  if (allow_unordered && !delimiter.empty()) {
+    return -EINVAL;
+  }
   if (s->system_request) {
     s->info.args.get_bool("objs-container", &objs_container, false);
     const char *shard_id_str = s->info.env->get("HTTP_RGWX_SHARD_ID");
@@ -2061,6 +2061,56 @@ TEST(BufferList, append_zero) {
   EXPECT_EQ('\0', bl[1]);
 }
 
+TEST(BufferList, contiguous_appender) {
+  bufferlist bl;
+  bl.append('A');
+  {
+    bufferlist::contiguous_appender app = bl.get_contiguous_appender(7);
+    EXPECT_EQ((unsigned)1, bl.length());
+    app.append("BCD", 3);
+    char *p = app.get_pos_add(2);
+    p[0] = 'E';
+    p[1] = 'F';
+    EXPECT_EQ((size_t)5, app.length());
+  }
+  // only what was appended is added, to the same segment
+  EXPECT_EQ((unsigned)6, bl.length());
+  EXPECT_EQ((unsigned)1, bl.buffers().size());
+  EXPECT_EQ(0, memcmp("ABCDEF", bl.c_str(), 6));
+
+  // more than fits in the current append buffer
+  std::string big(CEPH_BUFFER_APPEND_SIZE * 2 + 1, 'x');
+  {
+    bufferlist::contiguous_appender app = bl.get_contiguous_appender(big.size());
+    app.append(big.c_str(), big.size());
+  }
+  EXPECT_EQ((unsigned)6 + big.size(), bl.length());
+  EXPECT_EQ((unsigned)2, bl.buffers().size());
+  EXPECT_EQ(big, std::string(bl.buffers().back().c_str(), big.size()));
+
+  // decoding what ENCODE_START and the string encoder appended this way
+  bufferlist ebl;
+  ebl.append('A');
+  {
+    ENCODE_START(3, 2, ebl);
+    ::encode(std::string("foo"), ebl);
+    ENCODE_FINISH(ebl);
+  }
+  bufferlist::iterator it = ebl.begin();
+  char c;
+  ::decode(c, it);
+  EXPECT_EQ('A', c);
+  std::string s;
+  DECODE_START(3, it);
+  EXPECT_EQ(3, struct_v);
+  EXPECT_EQ(2, struct_compat);
+  EXPECT_EQ((__u32)7, struct_len);
+  ::decode(s, it);
+  DECODE_FINISH(it);
+  EXPECT_EQ("foo", s);
+  EXPECT_TRUE(it.end());
+}
+
 TEST(BufferList, operator_brackets) {
   bufferlist bl;
   EXPECT_THROW(bl[1], buffer::end_of_buffer);
@@ -0,0 +1,10 @@
+  $ crushtool -c $TESTDIR/straw2.txt -o straw2
+  $ crushtool -i straw2 --test --check-batch --min-x 0 --max-x 9999
+  $ rm straw2
+  $ crushtool -i $TESTDIR/test-map-a.crushmap --test --check-batch
+  $ crushtool -i $TESTDIR/test-map-big-1.crushmap --test --check-batch
+  $ crushtool -i $TESTDIR/test-map-hammer-tunables.crushmap --test --check-batch
+  $ crushtool -i $TESTDIR/test-map-indep.crushmap --test --check-batch
+  $ crushtool -i $TESTDIR/test-map-jewel-tunables.crushmap --test --check-batch
+  $ crushtool -i $TESTDIR/test-map-tries-vs-retries.crushmap --test --check-batch
+  $ crushtool -i $TESTDIR/test-map-vary-r.crushmap --test --check-batch
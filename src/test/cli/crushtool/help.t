@@ -82,6 +82,7 @@
      --show-mappings       show mappings
      --show-bad-mappings   show bad mappings
      --show-choose-tries   show choose tries histogram
+     --check-batch         verify batch mappings match single mappings
      --output-name name
                            prepend the data file(s) generated during the
                            testing routine with name
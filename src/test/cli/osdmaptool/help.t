@@ -10,4 +10,6 @@
      --test-random           do random placements
      --test-map-pg <pgid>    map a pgid to osds
      --test-map-object <objectname> [--pool <poolid>] map an object to osds
+     --optimize-pg-weights [--pool <poolid>] [--max-iterations <n>]
+                             adjust osd reweights to even out pg counts
   [1]
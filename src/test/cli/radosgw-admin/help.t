@@ -22,6 +22,7 @@
     bucket stats               returns bucket statistics
     bucket rm                  remove bucket
     bucket check               check bucket index
+    bucket reshard             reshard bucket index
     object rm                  remove object
     object unlink              unlink object from bucket index
     objects expire             run expired objects cleanup
@@ -153,6 +154,8 @@
      --fix                     besides checking bucket index, will also fix it
      --check-objects           bucket check: rebuilds bucket index according to
                                actual objects state
+     --allow-unordered         bucket list: list objects in no particular order,
+                               faster on buckets with many index shards
      --format=<format>         specify output format for certain operations: xml,
                                json
      --purge-data              when specified, user removal will also purge all the
@@ -184,6 +187,11 @@
      --max-size                specify max size (in bytes, negative value to disable)
      --quota-scope             scope of quota (bucket, user)
   
+  Bucket reshard options:
+     --num-shards              new number of bucket index shards, a multiple of
+                               the current one (default: sized for
+                               rgw_max_objs_per_shard objects per shard)
+  
   Orphans search options:
      --pool                    data pool to scan for leaked rados objects in
      --num-shards              num of shards to use for keeping the temporary scan info
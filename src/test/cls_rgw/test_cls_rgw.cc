@@ -373,6 +373,93 @@ TEST(cls_rgw, index_suggest)
   test_stats(ioctx, bucket_oid, 0, num_objs / 2, total_size);
 }
 
+TEST(cls_rgw, index_resharding)
+{
+  string old_oid = str_int("bucket", 4);
+  string new_oid = str_int("bucket", 5);
+
+  OpMgr mgr;
+
+  ObjectWriteOperation *op = mgr.write_op();
+  cls_rgw_bucket_init(*op);
+  ASSERT_EQ(0, ioctx.operate(old_oid, op));
+  op = mgr.write_op();
+  cls_rgw_bucket_init(*op);
+  ASSERT_EQ(0, ioctx.operate(new_oid, op));
+
+  int epoch = 1;
+  uint64_t obj_size = 1024;
+
+  rgw_bucket_dir_entry_meta meta;
+  meta.category = 0;
+  meta.size = obj_size;
+
+  /* one object that is in place, and one still being written */
+  string obj = str_int("obj", 0);
+  string tag = str_int("tag", 0);
+  string loc = str_int("loc", 0);
+  index_prepare(mgr, ioctx, old_oid, CLS_RGW_OP_ADD, tag, obj, loc);
+  index_complete(mgr, ioctx, old_oid, CLS_RGW_OP_ADD, tag, epoch, obj, meta);
+
+  string pending_obj = str_int("obj", 1);
+  string pending_tag = str_int("tag", 1);
+  string pending_loc = str_int("loc", 1);
+  index_prepare(mgr, ioctx, old_oid, CLS_RGW_OP_ADD, pending_tag, pending_obj, pending_loc);
+
+  map<int, string> old_objs;
+  old_objs[0] = old_oid;
+  ASSERT_EQ(0, CLSRGWIssueSetBucketResharding(ioctx, old_objs, 8 /* max aio */, true)());
+
+  /* index updates are refused while the flag is set */
+  string new_obj = str_int("obj", 2);
+  string new_tag = str_int("tag", 2);
+  cls_rgw_obj_key new_key(new_obj, string());
+  op = mgr.write_op();
+  cls_rgw_bucket_prepare_op(*op, CLS_RGW_OP_ADD, new_tag, new_key, loc, true, 0);
+  ASSERT_EQ(-CLS_RGW_ERR_BUSY_RESHARDING, ioctx.operate(old_oid, op));
+
+  rgw_bucket_entry_ver ver;
+  ver.pool = ioctx.get_id();
+  ver.epoch = epoch;
+  meta.accounted_size = meta.size;
+  cls_rgw_obj_key pending_key(pending_obj, string());
+  op = mgr.write_op();
+  cls_rgw_bucket_complete_op(*op, CLS_RGW_OP_ADD, pending_tag, ver, pending_key, meta, NULL, true, 0);
+  ASSERT_EQ(-CLS_RGW_ERR_BUSY_RESHARDING, ioctx.operate(old_oid, op));
+
+  ASSERT_EQ(-CLS_RGW_ERR_BUSY_RESHARDING,
+            cls_rgw_bucket_unlink_instance(ioctx, old_oid, new_key, new_tag, epoch, true));
+
+  test_stats(ioctx, old_oid, 0, 1, obj_size);
+
+  /* copy the entries out, the pending one included */
+  list<rgw_cls_bi_entry> entries;
+  bool is_truncated;
+  ASSERT_EQ(0, cls_rgw_bi_list(ioctx, old_oid, string(), string(), 100, &entries, &is_truncated));
+  ASSERT_FALSE(is_truncated);
+  ASSERT_EQ(2u, entries.size());
+  for (list<rgw_cls_bi_entry>::iterator iter = entries.begin(); iter != entries.end(); ++iter) {
+    ASSERT_EQ(0, cls_rgw_bi_put(ioctx, new_oid, *iter));
+  }
+
+  /* the refused completion is sent again to the new shard */
+  index_complete(mgr, ioctx, new_oid, CLS_RGW_OP_ADD, pending_tag, epoch, pending_obj, meta);
+
+  map<int, string> new_objs;
+  new_objs[0] = new_oid;
+  ASSERT_EQ(0, CLSRGWIssueBucketRebuild(ioctx, new_objs, 8)());
+  test_stats(ioctx, new_oid, 0, 2, obj_size * 2);
+
+  /* rebuilding the old shard keeps it blocked */
+  ASSERT_EQ(0, CLSRGWIssueBucketRebuild(ioctx, old_objs, 8)());
+  op = mgr.write_op();
+  cls_rgw_bucket_prepare_op(*op, CLS_RGW_OP_ADD, new_tag, new_key, loc, true, 0);
+  ASSERT_EQ(-CLS_RGW_ERR_BUSY_RESHARDING, ioctx.operate(old_oid, op));
+
+  ASSERT_EQ(0, CLSRGWIssueSetBucketResharding(ioctx, old_objs, 8, false)());
+  index_prepare(mgr, ioctx, old_oid, CLS_RGW_OP_ADD, new_tag, new_obj, loc);
+}
+
 /* test garbage collection */
 static void create_obj(cls_rgw_obj& obj, int i, int j)
 {
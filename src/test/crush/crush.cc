@@ -637,6 +637,56 @@ TEST(CRUSH, straw2_reweight) {
 }
 
 
+TEST(CRUSH, straw2_batch) {
+  // the batch mapper must produce exactly the same mappings as
+  // crush_do_rule, including for buckets larger than one hash batch
+  // and for devices with reduced or zero reweights.
+  CrushWrapper *c = new CrushWrapper;
+  c->create();
+  c->set_tunables_jewel();
+  c->set_type_name(2, "root");
+  c->set_type_name(1, "host");
+  c->set_type_name(0, "osd");
+
+  int rootno;
+  c->add_bucket(0, CRUSH_BUCKET_STRAW2, CRUSH_HASH_RJENKINS1,
+		2, 0, NULL, NULL, &rootno);
+  c->set_item_name(rootno, "default");
+
+  map<string,string> loc;
+  loc["root"] = "default";
+  int osd = 0;
+  for (int h = 0; h < 10; ++h) {
+    loc["host"] = string("host-") + stringify(h);
+    for (int o = 0; o < 5 + h * 7; ++o, ++osd) {
+      c->insert_item(g_ceph_context, osd, 1.0 + (o % 3),
+		     string("osd.") + stringify(osd), loc);
+    }
+  }
+  int ruleno = c->add_simple_ruleset("data", "default", "host",
+				     "firstn", pg_pool_t::TYPE_REPLICATED);
+  ASSERT_LE(0, ruleno);
+
+  vector<__u32> weight(c->get_max_devices(), 0x10000);
+  for (unsigned i = 0; i < weight.size(); i += 11)
+    weight[i] = 0;
+  for (unsigned i = 3; i < weight.size(); i += 13)
+    weight[i] = 0x8000;
+
+  vector<int> xs;
+  for (int x = 0; x < 100000; ++x)
+    xs.push_back(x * 2654435761u);
+  vector<vector<int> > batch;
+  c->do_rule_batch(ruleno, xs, batch, 3, weight);
+  ASSERT_EQ(xs.size(), batch.size());
+  for (unsigned i = 0; i < xs.size(); ++i) {
+    vector<int> out;
+    c->do_rule(ruleno, xs[i], out, 3, weight);
+    ASSERT_EQ(out, batch[i]);
+  }
+  delete c;
+}
+
 
 int main(int argc, char **argv) {
   vector<const char*> args;
@@ -300,6 +300,7 @@ TYPE(cls_rgw_gc_set_entry_op)
 TYPE(cls_rgw_obj)
 TYPE(cls_rgw_obj_chain)
 TYPE(rgw_cls_tag_timeout_op)
+TYPE(rgw_cls_set_resharding_op)
 TYPE(cls_rgw_bi_log_list_op)
 TYPE(cls_rgw_bi_log_trim_op)
 TYPE(cls_rgw_bi_log_list_ret)
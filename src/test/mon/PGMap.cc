@@ -81,6 +81,49 @@ TEST(pgmap, min_last_epoch_clean)
 
 }
 
+TEST(pgmap, min_last_epoch_clean_remove)
+{
+  PGMap pg_map;
+  PGMap::Incremental inc;
+  osd_stat_t os;
+  pg_stat_t ps;
+
+  ps.last_epoch_clean = 100;
+  inc.pg_stat_updates[pg_t(1,1)] = ps;
+  ps.last_epoch_clean = 200;
+  inc.pg_stat_updates[pg_t(2,1)] = ps;
+  inc.pg_stat_updates[pg_t(3,1)] = ps;
+  inc.version = 1;
+  inc.update_stat(0, 500, os);
+  pg_map.apply_incremental(g_ceph_context, inc);
+  ASSERT_EQ(100u, pg_map.get_min_last_epoch_clean());
+  ASSERT_EQ(2u, pg_map.num_pg_by_last_epoch_clean.size());
+
+  // removing the only pg at the minimum raises it
+  inc = PGMap::Incremental();
+  inc.version = 2;
+  inc.pg_remove.insert(pg_t(1,1));
+  pg_map.apply_incremental(g_ceph_context, inc);
+  ASSERT_EQ(200u, pg_map.get_min_last_epoch_clean());
+
+  // a clean pg takes its reported epoch
+  ps.state = PG_STATE_CLEAN;
+  ps.reported_epoch = 300;
+  inc = PGMap::Incremental();
+  inc.version = 3;
+  inc.pg_stat_updates[pg_t(2,1)] = ps;
+  pg_map.apply_incremental(g_ceph_context, inc);
+  ASSERT_EQ(200u, pg_map.get_min_last_epoch_clean());
+
+  inc = PGMap::Incremental();
+  inc.version = 4;
+  inc.pg_stat_updates[pg_t(3,1)] = ps;
+  pg_map.apply_incremental(g_ceph_context, inc);
+  ASSERT_EQ(300u, pg_map.get_min_last_epoch_clean());
+  ASSERT_EQ(1u, pg_map.num_pg_by_last_epoch_clean.size());
+  ASSERT_EQ(2, pg_map.num_pg_by_last_epoch_clean[300]);
+}
+
 TEST(pgmap, calc_stats)
 {
   bufferlist bl;
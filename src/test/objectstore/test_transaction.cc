@@ -73,3 +73,37 @@ TEST(Transaction, Swap)
   ASSERT_TRUE(a.empty());
   ASSERT_FALSE(b.empty());
 }
+
+TEST(Transaction, EncodeDecode)
+{
+  // enough ops to span several op buffers
+  const int num_ops = OPS_PER_PTR * 3 + 1;
+  const coll_t cid;
+  auto a = ObjectStore::Transaction{};
+  for (int i = 0; i < num_ops; i++) {
+    ghobject_t oid(hobject_t(sobject_t(object_t("obj" + std::to_string(i)), 0)));
+    bufferlist bl;
+    bl.append(std::to_string(i));
+    a.write(cid, oid, i, bl.length(), bl);
+  }
+  ASSERT_EQ(num_ops, a.get_num_ops());
+
+  bufferlist encoded;
+  ::encode(a, encoded);
+  auto p = encoded.begin();
+  auto b = ObjectStore::Transaction{};
+  ::decode(b, p);
+  ASSERT_EQ(num_ops, b.get_num_ops());
+
+  int i = 0;
+  for (auto it = b.begin(); it.have_op(); i++) {
+    auto op = it.decode_op();
+    ASSERT_EQ(ObjectStore::Transaction::OP_WRITE, op->op);
+    ASSERT_EQ("obj" + std::to_string(i), it.get_oid(op->oid).hobj.oid.name);
+    ASSERT_EQ((uint64_t)i, op->off);
+    bufferlist bl;
+    it.decode_bl(bl);
+    ASSERT_EQ(std::to_string(i), std::string(bl.c_str(), bl.length()));
+  }
+  ASSERT_EQ(num_ops, i);
+}
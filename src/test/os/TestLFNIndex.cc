@@ -21,8 +21,11 @@
 
 #include <stdio.h>
 #include <signal.h>
+#include <sys/wait.h>
 #include "os/filestore/LFNIndex.h"
+#include "os/filestore/HashIndex.h"
 #include "os/filestore/chain_xattr.h"
+#include "include/stringify.h"
 #include "common/ceph_argparse.h"
 #include "global/global_init.h"
 #include <gtest/gtest.h>
@@ -439,6 +442,175 @@ TEST_F(TestLFNIndex, get_mangled_name) {
   }
 }
 
+class TestWrapHashIndex : public HashIndex {
+public:
+  bool crash_on_retry;
+
+  TestWrapHashIndex(const char *base_path, double retry_probability)
+    : HashIndex(coll_t(), base_path, 1, 2, CollectionIndex::HOBJECT_WITH_POOL,
+		retry_probability, .5),
+      crash_on_retry(false) {}
+
+  void set_error_injection(bool on) {
+    error_injection_on = on;
+  }
+
+  /// called by the retry wrapper once an operation was interrupted
+  int cleanup() {
+    if (crash_on_retry)
+      _exit(1);
+    return HashIndex::cleanup();
+  }
+};
+
+class TestHashIndex : public ::testing::Test {
+public:
+  static const unsigned num_objects = 24;
+
+  virtual void SetUp() {
+    ASSERT_EQ(0, ::system("rm -fr PATH_HASH"));
+    ASSERT_EQ(0, ::mkdir("PATH_HASH", 0700));
+  }
+
+  virtual void TearDown() {
+    ASSERT_EQ(0, ::system("rm -fr PATH_HASH"));
+  }
+
+  // objects i and i + 16 share the subdir a split creates for them
+  static ghobject_t make_oid(unsigned i) {
+    return ghobject_t(hobject_t(object_t("obj_" + stringify(i)), "",
+				CEPH_NOSNAP, i, 0, ""));
+  }
+
+  static void create_objects(CollectionIndex &index) {
+    for (unsigned i = 0; i < num_objects; i++) {
+      CollectionIndex::IndexedPath path;
+      int exists = 0;
+      ghobject_t oid = make_oid(i);
+      ASSERT_EQ(0, index.lookup(oid, &path, &exists));
+      ASSERT_EQ(0, exists);
+      int fd = ::creat(path->path(), 0600);
+      ASSERT_LE(0, fd);
+      ::close(fd);
+      ASSERT_EQ(0, index.created(oid, path->path()));
+    }
+  }
+
+  /// every object can be looked up and listed; @return how many are in a subdir
+  static unsigned check_objects(CollectionIndex &index) {
+    unsigned in_subdir = 0;
+    for (unsigned i = 0; i < num_objects; i++) {
+      CollectionIndex::IndexedPath path;
+      int exists = 0;
+      EXPECT_EQ(0, index.lookup(make_oid(i), &path, &exists));
+      EXPECT_EQ(1, exists) << "obj_" << i << " at " << path->path();
+      if (string(path->path()).find("/DIR_") != string::npos)
+	in_subdir++;
+    }
+    vector<ghobject_t> ls;
+    ghobject_t next;
+    EXPECT_EQ(0, index.collection_list_partial(ghobject_t(), ghobject_t::get_max(),
+					       true, num_objects * 2, &ls, &next));
+    EXPECT_EQ(num_objects, ls.size());
+    set<ghobject_t, ghobject_t::BitwiseComparator> listed(ls.begin(), ls.end());
+    for (unsigned i = 0; i < num_objects; i++)
+      EXPECT_EQ(1u, listed.count(make_oid(i))) << "obj_" << i;
+    return in_subdir;
+  }
+};
+
+TEST_F(TestHashIndex, split_ahead_steps) {
+  TestWrapHashIndex index("PATH_HASH", 0);
+  ASSERT_EQ(0, index.init());
+  create_objects(index);
+  ASSERT_TRUE(index.want_split_ahead());
+  ASSERT_EQ(0u, check_objects(index));
+
+  // each step moves one group of objects into its own subdir, and the
+  // collection stays usable in between
+  unsigned steps = 0;
+  unsigned in_subdir = 0;
+  int r;
+  while ((r = index.split_ahead()) > 0) {
+    steps++;
+    unsigned now_in_subdir = check_objects(index);
+    ASSERT_LT(in_subdir, now_in_subdir);
+    in_subdir = now_in_subdir;
+    ASSERT_GT(num_objects, steps);
+  }
+  ASSERT_EQ(0, r);
+  ASSERT_LT(1u, steps);
+  ASSERT_FALSE(index.want_split_ahead());
+  ASSERT_EQ(in_subdir, check_objects(index));
+
+  // nothing left in progress
+  ASSERT_EQ(0, index.cleanup());
+  ASSERT_EQ(in_subdir, check_objects(index));
+}
+
+TEST_F(TestHashIndex, split_ahead_interrupted) {
+  for (unsigned seed = 0; seed < 20; seed++) {
+    SetUp();
+    TestWrapHashIndex index("PATH_HASH", .05);
+    index.set_error_injection(false);
+    ASSERT_EQ(0, index.init());
+    create_objects(index);
+    ASSERT_TRUE(index.want_split_ahead());
+
+    // steps interrupted part way are completed by cleanup() and retried
+    srand(seed);
+    index.set_error_injection(true);
+    int r;
+    while ((r = index.split_ahead()) > 0)
+      ;
+    ASSERT_EQ(0, r);
+    index.set_error_injection(false);
+    ASSERT_LT(0u, check_objects(index));
+    ASSERT_EQ(0, index.cleanup());
+    check_objects(index);
+  }
+}
+
+TEST_F(TestHashIndex, split_ahead_restart) {
+  unsigned crashed = 0;
+  for (unsigned seed = 0; seed < 20; seed++) {
+    SetUp();
+
+    // die wherever a step gets interrupted, leaving it half done on disk
+    pid_t pid = fork();
+    ASSERT_LE(0, pid);
+    if (pid == 0) {
+      TestWrapHashIndex index("PATH_HASH", .05);
+      index.set_error_injection(false);
+      if (index.init() < 0)
+	_exit(2);
+      create_objects(index);
+      if (::testing::Test::HasFailure() || !index.want_split_ahead())
+	_exit(2);
+      srand(seed);
+      index.set_error_injection(true);
+      index.crash_on_retry = true;
+      while (index.split_ahead() > 0)
+	;
+      _exit(0);
+    }
+    int status;
+    ASSERT_EQ(pid, waitpid(pid, &status, 0));
+    ASSERT_TRUE(WIFEXITED(status));
+    ASSERT_NE(2, WEXITSTATUS(status));
+    if (WEXITSTATUS(status) == 1)
+      crashed++;
+
+    // on restart, cleanup() finishes the split before anything else
+    TestWrapHashIndex index("PATH_HASH", 0);
+    ASSERT_EQ(0, index.cleanup());
+    check_objects(index);
+    ASSERT_EQ(0, index.cleanup());
+    check_objects(index);
+  }
+  ASSERT_LT(0u, crashed);
+}
+
 int main(int argc, char **argv) {
   int fd = ::creat("detect", 0600);
   int ret = chain_fsetxattr(fd, "user.test", "A", 1);
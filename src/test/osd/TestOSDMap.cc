@@ -400,3 +400,67 @@ TEST_F(OSDMapTest, PrimaryAffinity) {
     osdmap.set_primary_affinity(1, 0x10000);
   }
 }
+
+TEST_F(OSDMapTest, BalancePGWeights) {
+  set_up_map();
+
+  set<int64_t> pools;
+  map<int,unsigned> new_weights;
+  ostringstream ss;
+  ASSERT_EQ(-EINVAL, osdmap.calc_pg_balance_weights(pools, 0, .05,
+						    &new_weights, &ss));
+
+  // the flat map gives every osd the same crush weight, so a perfect
+  // balance puts the same number of pg copies on each of them
+  int n = get_num_osds();
+  vector<int> before(n, 0), after(n, 0);
+  int total = 0;
+  for (map<int64_t,pg_pool_t>::const_iterator p = osdmap.get_pools().begin();
+       p != osdmap.get_pools().end();
+       ++p) {
+    for (ps_t ps = 0; ps < p->second.get_pg_num(); ++ps) {
+      vector<int> raw;
+      int primary;
+      osdmap.pg_to_osds(pg_t(ps, p->first, -1), &raw, &primary);
+      for (unsigned i = 0; i < raw.size(); ++i)
+	before[raw[i]]++;
+      total += raw.size();
+    }
+  }
+
+  int r = osdmap.calc_pg_balance_weights(pools, 20, .05, &new_weights, &ss);
+  cout << ss.str() << std::endl;
+  ASSERT_LE(0, r);
+  ASSERT_EQ((unsigned)r, new_weights.size());
+  for (map<int,unsigned>::iterator p = new_weights.begin();
+       p != new_weights.end(); ++p) {
+    ASSERT_LT(0u, p->second);
+    ASSERT_GE((unsigned)CEPH_OSD_IN, p->second);
+    osdmap.set_weight(p->first, p->second);
+  }
+  // the weights are not dragged down as a whole
+  unsigned max_weight = 0;
+  for (int i = 0; i < n; ++i)
+    max_weight = MAX(max_weight, osdmap.get_weight(i));
+  ASSERT_EQ((unsigned)CEPH_OSD_IN, max_weight);
+
+  for (map<int64_t,pg_pool_t>::const_iterator p = osdmap.get_pools().begin();
+       p != osdmap.get_pools().end();
+       ++p) {
+    for (ps_t ps = 0; ps < p->second.get_pg_num(); ++ps) {
+      vector<int> raw;
+      int primary;
+      osdmap.pg_to_osds(pg_t(ps, p->first, -1), &raw, &primary);
+      for (unsigned i = 0; i < raw.size(); ++i)
+	after[raw[i]]++;
+    }
+  }
+
+  double avg = (double)total / n;
+  double dev_before = 0, dev_after = 0;
+  for (int i = 0; i < n; ++i) {
+    dev_before += (before[i] - avg) * (before[i] - avg);
+    dev_after += (after[i] - avg) * (after[i] - avg);
+  }
+  ASSERT_LE(dev_after, dev_before);
+}
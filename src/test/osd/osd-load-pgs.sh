@@ -0,0 +1,55 @@
+#!/bin/bash
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU Library Public License as published by
+# the Free Software Foundation; either version 2, or (at your option)
+# any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Library Public License for more details.
+#
+
+source ../qa/workunits/ceph-helpers.sh
+
+function run() {
+    local dir=$1
+    shift
+
+    export CEPH_MON="127.0.0.1:7125" # git grep '\<7125\>' : there must be only one
+    export CEPH_ARGS
+    CEPH_ARGS+="--fsid=$(uuidgen) --auth-supported=none "
+    CEPH_ARGS+="--mon-host=$CEPH_MON "
+
+    local funcs=${@:-$(set | sed -n -e 's/^\(TEST_[0-9a-z_]*\) .*/\1/p')}
+    for func in $funcs ; do
+        setup $dir || return 1
+        $func $dir || return 1
+        teardown $dir || return 1
+    done
+}
+
+function TEST_load_pgs_lockdep() {
+    local dir=$1
+    local osd_args="--lockdep=true --osd-load-pgs-threads=4"
+
+    run_mon $dir a --osd_pool_default_size=1 || return 1
+    run_osd $dir 0 $osd_args || return 1
+    ceph osd pool create load_pgs 32 || return 1
+    wait_for_clean || return 1
+
+    # the restart loads every pg, reading them in parallel
+    kill_daemons $dir TERM osd || return 1
+    activate_osd $dir 0 $osd_args || return 1
+    wait_for_clean || return 1
+
+    grep -q "load_pgs opened" $dir/osd.0.log || return 1
+    ! grep -q "recursive lock" $dir/osd.0.log || return 1
+}
+
+main osd-load-pgs "$@"
+
+# Local Variables:
+# compile-command: "cd ../.. ; make -j4 && test/osd/osd-load-pgs.sh"
+# End:
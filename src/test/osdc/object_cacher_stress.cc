@@ -103,6 +103,7 @@ int stress_test(uint64_t num_ops, uint64_t num_objs,
       Context *completion = new C_Count(op.get(), &outstanding_reads);
       lock.Lock();
       int r = obc.readx(rd, &object_set, completion);
+      obc.verify_stats();
       lock.Unlock();
       assert(r >= 0);
       if ((uint64_t)r == length)
@@ -116,6 +117,7 @@ int stress_test(uint64_t num_ops, uint64_t num_objs,
       wr->extents.push_back(op->extent);
       lock.Lock();
       obc.writex(wr, &object_set, NULL);
+      obc.verify_stats();
       lock.Unlock();
     }
   }
@@ -139,7 +141,9 @@ int stress_test(uint64_t num_ops, uint64_t num_objs,
   }
 
   lock.Lock();
+  obc.verify_stats();
   obc.release_set(&object_set);
+  obc.verify_stats();
   lock.Unlock();
 
   int r = 0;
@@ -159,6 +163,7 @@ int stress_test(uint64_t num_ops, uint64_t num_objs,
 
   lock.Lock();
   bool unclean = obc.release_set(&object_set);
+  obc.verify_stats();
   lock.Unlock();
 
   if (unclean) {
@@ -52,7 +52,9 @@
 #include "common/Mutex.h"
 #include "common/Thread.h"
 #include "common/Timer.h"
+#include "crush/CrushWrapper.h"
 #include "msg/async/Event.h"
+#include "os/ObjectStore.h"
 #include "global/global_init.h"
 
 #include "test/perf_helper.h"
@@ -318,6 +320,65 @@ double buffer_iterator()
   return Cycles::to_seconds(stop - start)/count;
 }
 
+// Measure the cost of building the transaction of a small replicated
+// write, encoding it as the primary does for MOSDRepOp, then decoding it
+// and walking its ops as the replica does.
+double transaction_encode_decode()
+{
+  int count = 100000;
+  coll_t cid;
+  ghobject_t oid(hobject_t(sobject_t(object_t("perf_obj"), CEPH_NOSNAP)));
+  ghobject_t pglog_oid(hobject_t(sobject_t(object_t("perf_pglog"), 0)));
+  bufferlist data, attr, snapset;
+  data.append(buffer::create(4096));
+  data.zero();
+  attr.append(string(256, 'a'));
+  snapset.append(string(32, 's'));
+  map<string, bufferlist> pglog;
+  pglog["0000000011.00000000000000000042"].append(string(128, 'l'));
+  uint64_t start = Cycles::rdtsc();
+  for (int i = 0; i < count; i++) {
+    ObjectStore::Transaction t;
+    t.write(cid, oid, 0, data.length(), data);
+    t.setattr(cid, oid, "_", attr);
+    t.setattr(cid, oid, "snapset", snapset);
+    t.omap_setkeys(cid, pglog_oid, pglog);
+    bufferlist bl;
+    ::encode(t, bl);
+
+    bufferlist::iterator p = bl.begin();
+    ObjectStore::Transaction d;
+    ::decode(d, p);
+    ObjectStore::Transaction::iterator op_iter = d.begin();
+    while (op_iter.have_op()) {
+      ObjectStore::Transaction::Op *op = op_iter.decode_op();
+      switch (op->op) {
+      case ObjectStore::Transaction::OP_WRITE:
+        {
+          bufferlist wbl;
+          op_iter.decode_bl(wbl);
+        }
+        break;
+      case ObjectStore::Transaction::OP_SETATTR:
+        {
+          string name = op_iter.decode_string();
+          bufferlist abl;
+          op_iter.decode_bl(abl);
+        }
+        break;
+      case ObjectStore::Transaction::OP_OMAP_SETKEYS:
+        {
+          map<string, bufferptr> aset;
+          op_iter.decode_attrset(aset);
+        }
+        break;
+      }
+    }
+  }
+  uint64_t stop = Cycles::rdtsc();
+  return Cycles::to_seconds(stop - start)/count;
+}
+
 // Implements the CondPingPong test.
 class CondPingPong {
   Mutex mutex;
@@ -565,6 +626,71 @@ double ceph_str_hash_rjenkins()
   return Cycles::to_seconds(stop - start)/count;
 }
 
+// Build a straw2 map with 40 hosts of 24 osds and a 3x replicated rule.
+static CrushWrapper *build_crush_map()
+{
+  CrushWrapper *c = new CrushWrapper;
+  c->create();
+  c->set_tunables_jewel();
+  c->set_type_name(2, "root");
+  c->set_type_name(1, "host");
+  c->set_type_name(0, "osd");
+  int rootno;
+  c->add_bucket(0, CRUSH_BUCKET_STRAW2, CRUSH_HASH_RJENKINS1,
+		2, 0, NULL, NULL, &rootno);
+  c->set_item_name(rootno, "default");
+  map<string,string> loc;
+  loc["root"] = "default";
+  int osd = 0;
+  for (int h = 0; h < 40; h++) {
+    char name[32];
+    snprintf(name, sizeof(name), "host-%d", h);
+    loc["host"] = name;
+    for (int o = 0; o < 24; o++, osd++) {
+      snprintf(name, sizeof(name), "osd.%d", osd);
+      c->insert_item(g_ceph_context, osd, 1.0, name, loc);
+    }
+  }
+  c->add_simple_ruleset("data", "default", "host", "firstn", 1);
+  return c;
+}
+
+// Map 1M PG seeds, one crush_do_rule call each.
+double perf_crush_do_rule()
+{
+  int count = 1000000;
+  CrushWrapper *c = build_crush_map();
+  vector<__u32> weight(c->get_max_devices(), 0x10000);
+  vector<int> out;
+
+  uint64_t start = Cycles::rdtsc();
+  for (int i = 0; i < count; i++)
+    c->do_rule(0, i, out, 3, weight);
+  uint64_t stop = Cycles::rdtsc();
+  delete c;
+
+  return Cycles::to_seconds(stop - start)/count;
+}
+
+// Map the same 1M PG seeds through the batch interface.
+double perf_crush_do_rule_batch()
+{
+  int count = 1000000;
+  CrushWrapper *c = build_crush_map();
+  vector<__u32> weight(c->get_max_devices(), 0x10000);
+  vector<int> xs(count);
+  for (int i = 0; i < count; i++)
+    xs[i] = i;
+  vector<vector<int> > out;
+
+  uint64_t start = Cycles::rdtsc();
+  c->do_rule_batch(0, xs, out, 3, weight);
+  uint64_t stop = Cycles::rdtsc();
+  delete c;
+
+  return Cycles::to_seconds(stop - start)/count;
+}
+
 // Measure the cost of reading the fine-grain cycle counter.
 double rdtsc_test()
 {
@@ -933,6 +1059,8 @@ TestInfo tests[] = {
     "Buffer::get_contiguous"},
   {"buffer_iterator", buffer_iterator,
     "iterate over buffer with 5 ptrs"},
+  {"transaction_encode_decode", transaction_encode_decode,
+    "build, encode, decode and walk a write txn"},
   {"cond_ping_pong", cond_ping_pong,
     "condition variable round-trip"},
   {"div32", div32,
@@ -955,6 +1083,10 @@ TestInfo tests[] = {
     "rjenkins hash on 16 byte of data"},
   {"ceph_str_hash_rjenkins", ceph_str_hash_rjenkins<256>,
     "rjenkins hash on 256 bytes of data"},
+  {"crush_do_rule", perf_crush_do_rule,
+    "CRUSH map one PG (straw2, 960 osds)"},
+  {"crush_do_rule_batch", perf_crush_do_rule_batch,
+    "CRUSH batch map one PG (straw2, 960 osds)"},
   {"rdtsc", rdtsc_test,
     "Read the fine-grain cycle counter"},
   {"cycles_to_seconds", perf_cycles_to_seconds,
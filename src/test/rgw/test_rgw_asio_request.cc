@@ -0,0 +1,240 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ *
+ */
+#include "rgw/rgw_asio_client.h"
+#include "global/global_init.h"
+#include "global/global_context.h"
+#include "common/ceph_argparse.h"
+#include <gtest/gtest.h>
+
+static const string *find_header(const RGWAsioRequest& req,
+				 const string& name)
+{
+  for (vector<pair<string, string> >::const_iterator p = req.headers.begin();
+       p != req.headers.end();
+       ++p)
+    if (p->first == name)
+      return &p->second;
+  return NULL;
+}
+
+TEST(RGWAsioRequest, RequestLine)
+{
+  RGWAsioRequest req;
+  ASSERT_EQ(0, req.parse("PUT /bucket/obj?acl&x=1 HTTP/1.0\r\n\r\n"));
+  ASSERT_EQ("PUT", req.method);
+  ASSERT_EQ("/bucket/obj", req.uri);
+  ASSERT_EQ("acl&x=1", req.query_string);
+  ASSERT_EQ(1, req.version_major);
+  ASSERT_EQ(0, req.version_minor);
+  ASSERT_TRUE(req.headers.empty());
+  ASSERT_FALSE(req.keepalive());
+
+  RGWAsioRequest req2;
+  ASSERT_EQ(0, req2.parse("GET / HTTP/1.1\r\n\r\n"));
+  ASSERT_EQ("/", req2.uri);
+  ASSERT_EQ("", req2.query_string);
+  ASSERT_TRUE(req2.keepalive());
+}
+
+TEST(RGWAsioRequest, MalformedRequestLine)
+{
+  const char *bad[] = {
+    "",
+    "GET / HTTP/1.1",                    // no line end
+    "GET / HTTP/1.1\r\n",                // no blank line
+    "GET\r\n\r\n",
+    "GET /\r\n\r\n",
+    " / HTTP/1.1\r\n\r\n",               // no method
+    "GET  HTTP/1.1\r\n\r\n",             // no target
+    "GET ?x HTTP/1.1\r\n\r\n",           // no path
+    "GET / / HTTP/1.1\r\n\r\n",          // space in target
+    "GET / HTTP/1\r\n\r\n",
+    "GET / HTTP/1.1x\r\n\r\n",
+    "GET / http/1.1\r\n\r\n",
+    "GET / HTTP/a.1\r\n\r\n",
+    NULL
+  };
+  for (const char **p = bad; *p; ++p) {
+    RGWAsioRequest req;
+    EXPECT_EQ(-EINVAL, req.parse(*p)) << "'" << *p << "'";
+  }
+}
+
+TEST(RGWAsioRequest, Headers)
+{
+  RGWAsioRequest req;
+  ASSERT_EQ(0, req.parse("GET / HTTP/1.1\r\n"
+			 "Host: example.com\r\n"
+			 "X-Amz-Date:\t 20161019T000000Z \t\r\n"
+			 "X-Empty:\r\n"
+			 "X-Value: a:b: c\r\n"
+			 "\r\n"));
+  ASSERT_EQ(4u, req.headers.size());
+  ASSERT_EQ("Host", req.headers[0].first);
+  ASSERT_EQ("example.com", req.headers[0].second);
+  // names keep their case; values lose surrounding whitespace
+  ASSERT_EQ("X-Amz-Date", req.headers[1].first);
+  ASSERT_EQ("20161019T000000Z", req.headers[1].second);
+  ASSERT_EQ("", req.headers[2].second);
+  ASSERT_EQ("a:b: c", req.headers[3].second);
+}
+
+TEST(RGWAsioRequest, HeaderCasing)
+{
+  RGWAsioRequest req;
+  ASSERT_EQ(0, req.parse("PUT /b/o HTTP/1.1\r\n"
+			 "CONTENT-LENGTH: 10\r\n"
+			 "connection: CLOSE\r\n"
+			 "\r\n"));
+  ASSERT_TRUE(req.has_content_length);
+  ASSERT_EQ(10u, req.content_length);
+  ASSERT_TRUE(req.explicit_conn_close);
+  ASSERT_FALSE(req.keepalive());
+  ASSERT_TRUE(find_header(req, "CONTENT-LENGTH"));
+
+  RGWAsioRequest req2;
+  ASSERT_EQ(0, req2.parse("GET / HTTP/1.0\r\n"
+			  "Connection: Keep-Alive\r\n"
+			  "\r\n"));
+  ASSERT_TRUE(req2.explicit_keepalive);
+  ASSERT_TRUE(req2.keepalive());
+  ASSERT_FALSE(req2.expect_continue);
+
+  RGWAsioRequest req3;
+  ASSERT_EQ(0, req3.parse("PUT /b/o HTTP/1.1\r\n"
+			  "expect: 100-Continue\r\n"
+			  "\r\n"));
+  ASSERT_TRUE(req3.expect_continue);
+}
+
+TEST(RGWAsioRequest, HeaderFolding)
+{
+  RGWAsioRequest req;
+  ASSERT_EQ(0, req.parse("GET / HTTP/1.1\r\n"
+			 "X-Folded: first\r\n"
+			 "  second\r\n"
+			 "\tthird: still value\r\n"
+			 "Host: h\r\n"
+			 "\r\n"));
+  ASSERT_EQ(2u, req.headers.size());
+  ASSERT_EQ("first second third: still value", *find_header(req, "X-Folded"));
+  ASSERT_EQ("h", *find_header(req, "Host"));
+
+  // a folded content-length is still checked
+  RGWAsioRequest req2;
+  ASSERT_EQ(0, req2.parse("PUT / HTTP/1.1\r\n"
+			  "Content-Length:\r\n"
+			  " 5\r\n"
+			  "\r\n"));
+  ASSERT_EQ(5u, req2.content_length);
+
+  // nothing to continue
+  RGWAsioRequest req3;
+  ASSERT_EQ(-EINVAL, req3.parse("GET / HTTP/1.1\r\n"
+				" orphan\r\n"
+				"\r\n"));
+}
+
+TEST(RGWAsioRequest, MalformedHeaders)
+{
+  const char *bad[] = {
+    "GET / HTTP/1.1\r\nNoColon\r\n\r\n",
+    "GET / HTTP/1.1\r\n: no name\r\n\r\n",
+    "GET / HTTP/1.1\r\nHost : space before colon\r\n\r\n",
+    "GET / HTTP/1.1\r\nContent-Length: ten\r\n\r\n",
+    "GET / HTTP/1.1\r\nContent-Length: -1\r\n\r\n",
+    "GET / HTTP/1.1\r\nContent-Length: 1\r\nContent-Length: 2\r\n\r\n",
+    "GET / HTTP/1.1\r\nHost: h\r\n",   // no blank line
+    NULL
+  };
+  for (const char **p = bad; *p; ++p) {
+    RGWAsioRequest req;
+    EXPECT_EQ(-EINVAL, req.parse(*p)) << "'" << *p << "'";
+  }
+
+  // repeating the same length is fine
+  RGWAsioRequest req;
+  ASSERT_EQ(0, req.parse("GET / HTTP/1.1\r\n"
+			 "Content-Length: 1\r\n"
+			 "Content-Length: 1\r\n"
+			 "\r\n"));
+  ASSERT_EQ(1u, req.content_length);
+}
+
+TEST(RGWAsioRequest, OversizeHeader)
+{
+  string value(ASIO_MAX_HEADER_SIZE, 'x');
+  RGWAsioRequest req;
+  ASSERT_EQ(-E2BIG, req.parse("GET / HTTP/1.1\r\nX-Big: " + value +
+			      "\r\n\r\n"));
+
+  // just under the limit
+  string head = "GET / HTTP/1.1\r\nX-Big: ";
+  string tail = "\r\n\r\n";
+  value.resize(ASIO_MAX_HEADER_SIZE - head.size() - tail.size());
+  RGWAsioRequest req2;
+  ASSERT_EQ(0, req2.parse(head + value + tail));
+  ASSERT_EQ(value, *find_header(req2, "X-Big"));
+}
+
+TEST(RGWAsioRequest, ContentLengthAndChunked)
+{
+  RGWAsioRequest req;
+  ASSERT_EQ(0, req.parse("PUT /b/o HTTP/1.1\r\n"
+			 "Content-Length: 4096\r\n"
+			 "\r\n"));
+  ASSERT_TRUE(req.has_content_length);
+  ASSERT_EQ(4096u, req.content_length);
+  ASSERT_FALSE(req.chunked);
+
+  RGWAsioRequest req2;
+  ASSERT_EQ(0, req2.parse("PUT /b/o HTTP/1.1\r\n"
+			  "Transfer-Encoding: Chunked\r\n"
+			  "\r\n"));
+  ASSERT_TRUE(req2.chunked);
+  ASSERT_FALSE(req2.has_content_length);
+
+  // chunked wins over content-length, whichever comes first
+  RGWAsioRequest req3;
+  ASSERT_EQ(0, req3.parse("PUT /b/o HTTP/1.1\r\n"
+			  "Content-Length: 10\r\n"
+			  "Transfer-Encoding: chunked\r\n"
+			  "\r\n"));
+  ASSERT_TRUE(req3.chunked);
+  ASSERT_FALSE(req3.has_content_length);
+  ASSERT_EQ(0u, req3.content_length);
+
+  RGWAsioRequest req4;
+  ASSERT_EQ(0, req4.parse("PUT /b/o HTTP/1.1\r\n"
+			  "Transfer-Encoding: identity\r\n"
+			  "Content-Length: 10\r\n"
+			  "\r\n"));
+  ASSERT_FALSE(req4.chunked);
+  ASSERT_EQ(10u, req4.content_length);
+
+  RGWAsioRequest req5;
+  ASSERT_EQ(-ENOTSUP, req5.parse("PUT /b/o HTTP/1.1\r\n"
+				 "Transfer-Encoding: gzip, chunked\r\n"
+				 "\r\n"));
+}
+
+int main(int argc, char** argv)
+{
+  vector<const char*> args;
+  argv_to_vec(argc, (const char **)argv, args);
+
+  global_init(NULL, args, CEPH_ENTITY_TYPE_CLIENT, CODE_ENVIRONMENT_UTILITY, 0);
+  common_init_finish(g_ceph_context);
+
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
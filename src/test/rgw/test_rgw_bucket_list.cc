@@ -0,0 +1,251 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ *
+ */
+
+/*
+ * Lists a bucket whose index is spread over several shards.  Needs a
+ * running cluster with the rgw pools, e.g. from vstart.sh.
+ */
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "global/global_init.h"
+#include "global/global_context.h"
+#include "common/ceph_argparse.h"
+#include "cls/rgw/cls_rgw_client.h"
+#include "rgw/rgw_rados.h"
+#include "rgw/rgw_op.h"
+#include <gtest/gtest.h>
+
+using namespace std;
+
+#define NUM_SHARDS 7
+#define NUM_PER_DIR 40
+
+static RGWRados *store;
+static rgw_bucket bucket;
+static set<string> all_names;
+static set<string> dir_a_names;
+
+static int add_index_entry(librados::IoCtx& index_ctx, rgw_obj& obj)
+{
+  string bucket_oid_base = ".dir." + bucket.marker;
+  string oid;
+  int r = RGWRados::get_bucket_index_object(bucket_oid_base, obj.get_hash_object(), NUM_SHARDS,
+                                            RGWBucketInfo::MOD, &oid, NULL);
+  if (r < 0)
+    return r;
+
+  cls_rgw_obj_key key(obj.get_index_key_name(), obj.get_instance());
+  string tag = "tag-" + key.name;
+
+  librados::ObjectWriteOperation prepare;
+  cls_rgw_bucket_prepare_op(prepare, CLS_RGW_OP_ADD, tag, key, obj.get_loc(), false, 0);
+  r = index_ctx.operate(oid, &prepare);
+  if (r < 0)
+    return r;
+
+  rgw_bucket_entry_ver ver;
+  ver.pool = index_ctx.get_id();
+  ver.epoch = 1;
+  rgw_bucket_dir_entry_meta meta;
+  meta.category = RGW_OBJ_CATEGORY_MAIN;
+  meta.size = meta.accounted_size = 1;
+
+  librados::ObjectWriteOperation complete;
+  cls_rgw_bucket_complete_op(complete, CLS_RGW_OP_ADD, tag, ver, key, meta, NULL, false, 0);
+  return index_ctx.operate(oid, &complete);
+}
+
+/*
+ * Lists up to max entries per call until the listing isn't truncated,
+ * failing on duplicates.
+ */
+static int list_all(RGWRados::Bucket::List& list_op, int max, set<string> *names, int *calls)
+{
+  bool truncated = true;
+  while (truncated) {
+    vector<RGWObjEnt> result;
+    int r = list_op.list_objects(max, &result, NULL, &truncated);
+    if (r < 0)
+      return r;
+    if (result.size() > (size_t)max)
+      return -E2BIG;
+    for (vector<RGWObjEnt>::iterator iter = result.begin(); iter != result.end(); ++iter) {
+      if (!names->insert(iter->key.name).second)
+        return -EEXIST;
+    }
+    ++*calls;
+  }
+  return 0;
+}
+
+/* must be the first test! */
+TEST(TestRGWBucketList, init)
+{
+  char buf[32];
+  snprintf(buf, sizeof(buf), "test-bucket-list-%d", getpid());
+  bucket.name = buf;
+
+  RGWUserInfo owner;
+  owner.user_id.from_str("test-bucket-list");
+  map<string, bufferlist> attrs;
+  RGWBucketInfo info;
+  ASSERT_EQ(0, store->create_bucket(owner, bucket, store->get_zonegroup().get_id(), string(),
+                                    attrs, info, NULL, NULL, 0, NULL));
+  ASSERT_EQ((uint32_t)NUM_SHARDS, info.num_shards);
+
+  librados::IoCtx index_ctx;
+  ASSERT_EQ(0, store->get_rados_handle()->ioctx_create(bucket.index_pool.c_str(), index_ctx));
+
+  const char *dirs[] = { "dir-a/", "dir-b/", "_dir-c/", NULL };
+  for (const char **dir = dirs; *dir; ++dir) {
+    for (int i = 0; i < NUM_PER_DIR; ++i) {
+      snprintf(buf, sizeof(buf), "%s%d", *dir, i);
+      rgw_obj obj(bucket, buf);
+      ASSERT_EQ(0, add_index_entry(index_ctx, obj));
+      all_names.insert(buf);
+      if (*dir == dirs[0])
+        dir_a_names.insert(buf);
+    }
+  }
+
+  /* a multipart upload in progress, which is not listed */
+  RGWMPObj mp("dir-a/upload", "2~upload");
+  rgw_obj meta_obj;
+  meta_obj.init_ns(bucket, mp.get_meta(), RGW_OBJ_NS_MULTIPART);
+  meta_obj.index_hash_source = "dir-a/upload";
+  ASSERT_EQ(0, add_index_entry(index_ctx, meta_obj));
+}
+
+TEST(TestRGWBucketList, Ordered)
+{
+  RGWRados::Bucket target(store, bucket);
+  RGWRados::Bucket::List list_op(&target);
+
+  set<string> names;
+  int calls = 0;
+  ASSERT_EQ(0, list_all(list_op, 1000, &names, &calls));
+  ASSERT_EQ(all_names, names);
+}
+
+TEST(TestRGWBucketList, Unordered)
+{
+  const int maxes[] = { 1, 7, 13, 1000 };
+  for (size_t i = 0; i < sizeof(maxes) / sizeof(maxes[0]); ++i) {
+    RGWRados::Bucket target(store, bucket);
+    RGWRados::Bucket::List list_op(&target);
+    list_op.params.allow_unordered = true;
+
+    set<string> names;
+    int calls = 0;
+    ASSERT_EQ(0, list_all(list_op, maxes[i], &names, &calls)) << "max=" << maxes[i];
+    ASSERT_EQ(all_names, names) << "max=" << maxes[i];
+    ASSERT_GE(calls, (int)all_names.size() / maxes[i]);
+  }
+}
+
+TEST(TestRGWBucketList, UnorderedMarker)
+{
+  /* continue with a new listing from the marker each time, like
+   * successive requests do */
+  set<string> names;
+  rgw_obj_key marker;
+  bool truncated = true;
+  int calls = 0;
+  while (truncated) {
+    RGWRados::Bucket target(store, bucket);
+    RGWRados::Bucket::List list_op(&target);
+    list_op.params.allow_unordered = true;
+    list_op.params.marker = marker;
+
+    vector<RGWObjEnt> result;
+    ASSERT_EQ(0, list_op.list_objects(11, &result, NULL, &truncated));
+    ASSERT_GE(11u, result.size());
+    for (vector<RGWObjEnt>::iterator iter = result.begin(); iter != result.end(); ++iter) {
+      ASSERT_TRUE(names.insert(iter->key.name).second) << "listed twice: " << iter->key.name;
+    }
+    if (truncated) {
+      ASSERT_FALSE(result.empty());
+      ASSERT_EQ(result.back().key, list_op.get_next_marker());
+    }
+    marker = list_op.get_next_marker();
+    ASSERT_GT((int)all_names.size(), calls++);
+  }
+  ASSERT_EQ(all_names, names);
+}
+
+TEST(TestRGWBucketList, UnorderedPrefix)
+{
+  const int maxes[] = { 3, 1000 };
+  for (size_t i = 0; i < sizeof(maxes) / sizeof(maxes[0]); ++i) {
+    RGWRados::Bucket target(store, bucket);
+    RGWRados::Bucket::List list_op(&target);
+    list_op.params.allow_unordered = true;
+    list_op.params.prefix = "dir-a/";
+
+    set<string> names;
+    int calls = 0;
+    ASSERT_EQ(0, list_all(list_op, maxes[i], &names, &calls)) << "max=" << maxes[i];
+    ASSERT_EQ(dir_a_names, names) << "max=" << maxes[i];
+  }
+
+  /* names starting with an underscore are stored escaped in the index */
+  RGWRados::Bucket target(store, bucket);
+  RGWRados::Bucket::List list_op(&target);
+  list_op.params.allow_unordered = true;
+  list_op.params.prefix = "_dir-c/1";
+
+  set<string> names;
+  int calls = 0;
+  ASSERT_EQ(0, list_all(list_op, 5, &names, &calls));
+  ASSERT_EQ(11u, names.size()); /* 1 and 10-19 */
+  for (set<string>::iterator iter = names.begin(); iter != names.end(); ++iter) {
+    ASSERT_EQ(0, iter->compare(0, 8, "_dir-c/1"));
+  }
+}
+
+TEST(TestRGWBucketList, UnorderedDelimiter)
+{
+  RGWRados::Bucket target(store, bucket);
+  RGWRados::Bucket::List list_op(&target);
+  list_op.params.allow_unordered = true;
+  list_op.params.delim = "/";
+
+  vector<RGWObjEnt> result;
+  map<string, bool> common_prefixes;
+  bool truncated;
+  ASSERT_EQ(-EINVAL, list_op.list_objects(1000, &result, &common_prefixes, &truncated));
+}
+
+int main(int argc, char **argv)
+{
+  vector<const char*> args;
+  argv_to_vec(argc, (const char **)argv, args);
+
+  global_init(NULL, args, CEPH_ENTITY_TYPE_CLIENT, CODE_ENVIRONMENT_UTILITY, 0);
+  common_init_finish(g_ceph_context);
+  g_ceph_context->_conf->set_val("rgw_override_bucket_index_max_shards", "7");
+
+  store = RGWStoreManager::get_storage(g_ceph_context, false, false, false);
+  if (!store) {
+    cerr << "couldn't init storage provider" << std::endl;
+    return 1;
+  }
+
+  ::testing::InitGoogleTest(&argc, argv);
+  int r = RUN_ALL_TESTS();
+
+  RGWStoreManager::close_storage(store);
+  return r;
+}
@@ -0,0 +1,167 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ *
+ */
+#include "rgw/rgw_cache.h"
+#include "global/global_init.h"
+#include "global/global_context.h"
+#include "common/ceph_argparse.h"
+#include "common/config.h"
+#include <set>
+#include <gtest/gtest.h>
+
+namespace {
+
+// remembers what it was asked to chain and invalidate
+struct MockChainedCache : public RGWChainedCache {
+  std::set<std::string> keys;
+  void chain_cb(const std::string& key, void *data) override {
+    keys.insert(key);
+  }
+  void invalidate(const std::string& key) override {
+    keys.erase(key);
+  }
+  void invalidate_all() override {
+    keys.clear();
+  }
+};
+
+ObjectCacheInfo make_info(const std::string& s)
+{
+  ObjectCacheInfo info;
+  info.flags = CACHE_FLAG_DATA;
+  info.data.append(s);
+  return info;
+}
+
+struct ObjectCacheTest : public ::testing::Test {
+  void SetUp() override {
+    g_ceph_context->_conf->set_val("rgw_cache_lru_size", "16");
+    g_ceph_context->_conf->set_val("rgw_cache_num_shards", "4");
+    g_ceph_context->_conf->apply_changes(NULL);
+  }
+};
+
+} // anonymous namespace
+
+TEST_F(ObjectCacheTest, GetPutRemove)
+{
+  ObjectCache cache;
+  cache.set_ctx(g_ceph_context);
+  cache.set_enabled(true);
+
+  std::string name = "obj";
+  ObjectCacheInfo info = make_info("data");
+  ObjectCacheInfo out;
+  ASSERT_EQ(-ENOENT, cache.get(name, out, CACHE_FLAG_DATA, NULL));
+  cache.put(name, info, NULL);
+  ASSERT_EQ(0, cache.get(name, out, CACHE_FLAG_DATA, NULL));
+  ASSERT_TRUE(out.data.contents_equal(info.data));
+  // we don't have the xattrs
+  ASSERT_EQ(-ENOENT, cache.get(name, out, CACHE_FLAG_XATTRS, NULL));
+
+  cache.remove(name);
+  ASSERT_EQ(-ENOENT, cache.get(name, out, CACHE_FLAG_DATA, NULL));
+
+  cache.put(name, info, NULL);
+  cache.set_enabled(false);
+  ASSERT_EQ(-ENOENT, cache.get(name, out, CACHE_FLAG_DATA, NULL));
+}
+
+TEST_F(ObjectCacheTest, BeforeSetCtx)
+{
+  ObjectCache cache;
+  std::string name = "obj";
+  ObjectCacheInfo info = make_info("data");
+  ObjectCacheInfo out;
+  // disabled until told otherwise, but usable
+  cache.put(name, info, NULL);
+  ASSERT_EQ(-ENOENT, cache.get(name, out, CACHE_FLAG_DATA, NULL));
+  cache.remove(name);
+
+  cache.set_enabled(true);
+  cache.set_ctx(g_ceph_context);
+  cache.put(name, info, NULL);
+  ASSERT_EQ(0, cache.get(name, out, CACHE_FLAG_DATA, NULL));
+}
+
+TEST_F(ObjectCacheTest, Bounded)
+{
+  ObjectCache cache;
+  cache.set_ctx(g_ceph_context);
+  cache.set_enabled(true);
+
+  std::string hot = "hot";
+  ObjectCacheInfo info = make_info("data");
+  ObjectCacheInfo out;
+  cache.put(hot, info, NULL);
+
+  int cached = 0;
+  for (int i = 0; i < 1000; i++) {
+    std::string name = "obj" + std::to_string(i);
+    cache.put(name, info, NULL);
+    // keep hitting one object; it should stay
+    ASSERT_EQ(0, cache.get(hot, out, CACHE_FLAG_DATA, NULL));
+  }
+  for (int i = 0; i < 1000; i++) {
+    std::string name = "obj" + std::to_string(i);
+    if (cache.get(name, out, CACHE_FLAG_DATA, NULL) == 0)
+      cached++;
+  }
+  // each shard holds up to lru_size / num_shards, plus the one being added
+  ASSERT_LE(cached, 16 + 4);
+  ASSERT_GT(cached, 0);
+}
+
+TEST_F(ObjectCacheTest, Chained)
+{
+  ObjectCache cache;
+  cache.set_ctx(g_ceph_context);
+  cache.set_enabled(true);
+
+  MockChainedCache chained;
+  cache.chain_cache(&chained);
+
+  // chain an entry to objects in (likely) different shards
+  std::list<std::string> names = { "a", "b", "c", "d", "e" };
+  std::list<rgw_cache_entry_info> infos;
+  std::list<rgw_cache_entry_info *> info_ptrs;
+  for (auto& name : names) {
+    ObjectCacheInfo info = make_info(name);
+    infos.emplace_back();
+    cache.put(name, info, &infos.back());
+    info_ptrs.push_back(&infos.back());
+  }
+
+  std::string key = "key";
+  RGWChainedCache::Entry entry(&chained, key, NULL);
+  ASSERT_TRUE(cache.chain_cache_entry(info_ptrs, &entry));
+  ASSERT_EQ(1u, chained.keys.count(key));
+
+  // updating any of them drops the chained entry
+  ObjectCacheInfo info = make_info("new");
+  cache.put(names.back(), info, NULL);
+  ASSERT_EQ(0u, chained.keys.count(key));
+
+  // and can't chain to a stale generation
+  ASSERT_FALSE(cache.chain_cache_entry(info_ptrs, &entry));
+}
+
+int main(int argc, char** argv)
+{
+  vector<const char*> args;
+  argv_to_vec(argc, (const char **)argv, args);
+
+  global_init(NULL, args, CEPH_ENTITY_TYPE_CLIENT, CODE_ENVIRONMENT_UTILITY, 0);
+  common_init_finish(g_ceph_context);
+
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
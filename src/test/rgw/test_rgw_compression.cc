@@ -0,0 +1,265 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ *
+ */
+#include "rgw/rgw_compression.h"
+#include "global/global_init.h"
+#include "global/global_context.h"
+#include "common/ceph_argparse.h"
+#include <gtest/gtest.h>
+
+namespace {
+
+// run-length encoding, so the stored data differs in size from the original
+class RLECompressor : public Compressor {
+public:
+  int compress(const bufferlist &in, bufferlist &out) override {
+    bufferlist tmp = in;
+    const char *p = tmp.c_str();
+    const char *end = p + tmp.length();
+    while (p < end) {
+      unsigned char count = 1;
+      while (p + count < end && p[count] == *p && count < 255)
+	count++;
+      out.append((char)count);
+      out.append(*p);
+      p += count;
+    }
+    return 0;
+  }
+  int decompress(const bufferlist &in, bufferlist &out) override {
+    bufferlist tmp = in;
+    if (tmp.length() % 2)
+      return -EINVAL;
+    const char *p = tmp.c_str();
+    for (unsigned i = 0; i < tmp.length(); i += 2) {
+      out.append(std::string((unsigned char)p[i], p[i + 1]));
+    }
+    return 0;
+  }
+};
+
+class FailingCompressor : public Compressor {
+public:
+  int compress(const bufferlist &in, bufferlist &out) override {
+    return -EINVAL;
+  }
+  int decompress(const bufferlist &in, bufferlist &out) override {
+    return -EINVAL;
+  }
+};
+
+// collects what it is handed
+struct BufferSink : public RGWGetDataCB {
+  bufferlist bl;
+  int handle_data(bufferlist& in, off_t bl_ofs, off_t bl_len) override {
+    bufferlist part;
+    part.substr_of(in, bl_ofs, bl_len);
+    bl.claim_append(part);
+    return 0;
+  }
+};
+
+std::string make_block(char c, size_t runs)
+{
+  std::string s;
+  for (size_t i = 0; i < runs; i++) {
+    s.append(i % 7 + 1, c + (i % 3));
+  }
+  return s;
+}
+
+// store the blocks compressed; returns the stored data
+bufferlist put_blocks(RGWPutObj_Compress& compress,
+		      const std::vector<std::string>& blocks,
+		      std::string *orig)
+{
+  bufferlist stored;
+  for (auto& b : blocks) {
+    bufferlist bl;
+    bl.append(b);
+    off_t ofs = orig->size();
+    EXPECT_EQ(0, compress.handle_data(bl, ofs));
+    EXPECT_EQ((off_t)stored.length(), ofs);
+    stored.append(bl);
+    orig->append(b);
+  }
+  return stored;
+}
+
+// read [ofs, end] of the original data, feeding the stored data in pieces
+std::string read_range(RGWCompressionInfo& cs_info, const bufferlist& stored,
+		       off_t ofs, off_t end, size_t piece)
+{
+  BufferSink sink;
+  RGWGetObj_Decompress decompress(g_ceph_context, &cs_info,
+				  CompressorRef(new RLECompressor), &sink);
+  decompress.fixup_range(ofs, end);
+  EXPECT_LE(0, ofs);
+  EXPECT_LT(end, (off_t)stored.length());
+
+  for (off_t cur = ofs; cur <= end; cur += piece) {
+    off_t len = std::min<off_t>(piece, end + 1 - cur);
+    bufferlist bl;
+    bl.substr_of(stored, cur, len);
+    // hand it in at an offset, as the read path does
+    bufferlist padded;
+    padded.append("xx");
+    padded.append(bl);
+    EXPECT_EQ(0, decompress.handle_data(padded, 2, len));
+  }
+  return std::string(sink.bl.c_str(), sink.bl.length());
+}
+
+} // anonymous namespace
+
+TEST(RGWCompression, RoundTrip)
+{
+  RGWPutObj_Compress compress(g_ceph_context, CompressorRef(new RLECompressor));
+
+  std::vector<std::string> blocks = {
+    make_block('a', 100), make_block('k', 37), make_block('u', 250)
+  };
+  std::string orig;
+  bufferlist stored = put_blocks(compress, blocks, &orig);
+  ASSERT_TRUE(compress.is_compressed());
+  ASSERT_NE(orig.size(), stored.length());
+
+  map<string, bufferlist> attrs;
+  compress.get_attrs("rle", orig.size(), attrs);
+
+  bool need_decompress = false;
+  RGWCompressionInfo cs_info;
+  ASSERT_EQ(0, rgw_compression_info_from_attrset(attrs, need_decompress, cs_info));
+  ASSERT_TRUE(need_decompress);
+  ASSERT_EQ("rle", cs_info.compression_type);
+  ASSERT_EQ(orig.size(), cs_info.orig_size);
+  ASSERT_EQ(blocks.size(), cs_info.blocks.size());
+
+  // whole object, then ranges within, across and at the ends of blocks
+  off_t b1 = blocks[0].size();
+  off_t b2 = b1 + blocks[1].size();
+  off_t last = orig.size() - 1;
+  std::vector<std::pair<off_t, off_t> > ranges = {
+    {0, last}, {0, 0}, {last, last}, {5, 17}, {b1, b2 - 1},
+    {b1 - 3, b1 + 2}, {10, last - 10}, {b2 - 1, b2}
+  };
+  for (auto& r : ranges) {
+    for (size_t piece : {1, 7, 4096}) {
+      std::string got = read_range(cs_info, stored, r.first, r.second, piece);
+      ASSERT_EQ(orig.substr(r.first, r.second - r.first + 1), got)
+	<< "range " << r.first << "-" << r.second << " piece " << piece;
+    }
+  }
+}
+
+TEST(RGWCompression, Uncompressed)
+{
+  map<string, bufferlist> attrs;
+  bool need_decompress = true;
+  RGWCompressionInfo cs_info;
+  ASSERT_EQ(0, rgw_compression_info_from_attrset(attrs, need_decompress, cs_info));
+  ASSERT_FALSE(need_decompress);
+
+  // if the first block fails, the object is stored as is
+  RGWPutObj_Compress compress(g_ceph_context, CompressorRef(new FailingCompressor));
+  bufferlist bl;
+  bl.append("data");
+  off_t ofs = 0;
+  ASSERT_EQ(0, compress.handle_data(bl, ofs));
+  ASSERT_FALSE(compress.is_compressed());
+  ASSERT_EQ(0, ofs);
+  ASSERT_EQ(std::string("data"), std::string(bl.c_str(), bl.length()));
+
+  compress.get_attrs("failing", 4, attrs);
+  ASSERT_TRUE(attrs.empty());
+
+  attrs[RGW_ATTR_COMPRESSION].append("garbage");
+  ASSERT_EQ(-EIO, rgw_compression_info_from_attrset(attrs, need_decompress, cs_info));
+}
+
+TEST(RGWCompression, MixedParts)
+{
+  // a compressed part, an uncompressed one, then another compressed one
+  RGWCompressionInfo cs_info;
+  std::string orig;
+  bufferlist stored;
+  for (int i = 0; i < 3; i++) {
+    std::vector<std::string> blocks = {
+      make_block('a' + i, 40 + i), make_block('k' + i, 25)
+    };
+    RGWPutObj_Compress compress(g_ceph_context,
+				i == 1 ? CompressorRef(new FailingCompressor) :
+				CompressorRef(new RLECompressor));
+    std::string part;
+    bufferlist part_stored = put_blocks(compress, blocks, &part);
+    ASSERT_EQ(i != 1, compress.is_compressed());
+
+    map<string, bufferlist> attrs;
+    compress.get_attrs("rle", part.size(), attrs);
+    bool need_decompress;
+    RGWCompressionInfo part_info;
+    ASSERT_EQ(0, rgw_compression_info_from_attrset(attrs, need_decompress, part_info));
+
+    rgw_compression_add_part(cs_info, part_info, part.size(), orig.size(),
+			     stored.length(), 64);
+    orig.append(part);
+    stored.append(part_stored);
+  }
+  cs_info.orig_size = orig.size();
+
+  ASSERT_EQ("rle", cs_info.compression_type);
+  // the uncompressed part is split into blocks stored as is
+  size_t raw_blocks = 0;
+  for (auto& b : cs_info.blocks) {
+    if (b.compression_type == "none") {
+      ASSERT_GE(64u, b.len);
+      raw_blocks++;
+    } else {
+      ASSERT_EQ("", b.compression_type);
+    }
+  }
+  ASSERT_LT(1u, raw_blocks);
+  ASSERT_EQ(raw_blocks + 4, cs_info.blocks.size());
+
+  off_t last = orig.size() - 1;
+  std::vector<std::pair<off_t, off_t> > ranges = {
+    {0, last}, {0, 0}, {last, last}, {10, last - 10},
+    {(off_t)cs_info.blocks[2].old_ofs - 1, (off_t)cs_info.blocks[2].old_ofs + 70}
+  };
+  for (auto& r : ranges) {
+    for (size_t piece : {1, 7, 4096}) {
+      std::string got = read_range(cs_info, stored, r.first, r.second, piece);
+      ASSERT_EQ(orig.substr(r.first, r.second - r.first + 1), got)
+	<< "range " << r.first << "-" << r.second << " piece " << piece;
+    }
+  }
+
+  // a block compressed with a plugin that isn't available
+  cs_info.blocks[0].compression_type = "no-such-plugin";
+  BufferSink sink;
+  RGWGetObj_Decompress decompress(g_ceph_context, &cs_info,
+				  CompressorRef(new RLECompressor), &sink);
+  off_t ofs = 0, end = 0;
+  decompress.fixup_range(ofs, end);
+  ASSERT_EQ(-EIO, decompress.handle_data(stored, 0, end + 1));
+}
+
+int main(int argc, char** argv)
+{
+  vector<const char*> args;
+  argv_to_vec(argc, (const char **)argv, args);
+
+  global_init(NULL, args, CEPH_ENTITY_TYPE_CLIENT, CODE_ENVIRONMENT_UTILITY, 0);
+  common_init_finish(g_ceph_context);
+
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,146 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ *
+ */
+#include "rgw/rgw_data_cache.h"
+#include "global/global_init.h"
+#include "global/global_context.h"
+#include "common/ceph_argparse.h"
+#include "common/config.h"
+#include <stdlib.h>
+#include <gtest/gtest.h>
+
+namespace {
+
+bufferlist make_bl(const std::string& s)
+{
+  bufferlist bl;
+  bl.append(s);
+  return bl;
+}
+
+// set the cache sizes for a test, and put them back after
+struct DataCacheTest : public ::testing::Test {
+  void SetUp() override {
+    g_ceph_context->_conf->set_val("rgw_data_cache_size", "100");
+    g_ceph_context->_conf->set_val("rgw_data_cache_max_obj_size", "40");
+    g_ceph_context->_conf->set_val("rgw_data_cache_path", "");
+    g_ceph_context->_conf->set_val("rgw_data_cache_path_size", "200");
+    g_ceph_context->_conf->apply_changes(NULL);
+  }
+  void TearDown() override {
+    g_ceph_context->_conf->set_val("rgw_data_cache_size", "0");
+    g_ceph_context->_conf->set_val("rgw_data_cache_path", "");
+    g_ceph_context->_conf->apply_changes(NULL);
+  }
+};
+
+} // anonymous namespace
+
+TEST_F(DataCacheTest, GetPut)
+{
+  RGWDataCache cache(g_ceph_context);
+  ASSERT_EQ(0, cache.init());
+
+  bufferlist tag = make_bl("tag1");
+  bufferlist bl;
+  ASSERT_FALSE(cache.get("obj", tag, bl));
+  ASSERT_FALSE(cache.contains("obj"));
+
+  cache.put("obj", tag, make_bl("data"));
+  ASSERT_TRUE(cache.contains("obj"));
+  ASSERT_TRUE(cache.get("obj", tag, bl));
+  ASSERT_EQ(std::string("data"), std::string(bl.c_str(), bl.length()));
+}
+
+TEST_F(DataCacheTest, StaleTag)
+{
+  RGWDataCache cache(g_ceph_context);
+  ASSERT_EQ(0, cache.init());
+
+  cache.put("obj", make_bl("tag1"), make_bl("old data"));
+
+  // the object was rewritten
+  bufferlist bl;
+  ASSERT_FALSE(cache.get("obj", make_bl("tag2"), bl));
+  // and the stale entry is gone
+  ASSERT_FALSE(cache.contains("obj"));
+  ASSERT_FALSE(cache.get("obj", make_bl("tag1"), bl));
+}
+
+TEST_F(DataCacheTest, Limits)
+{
+  RGWDataCache cache(g_ceph_context);
+  ASSERT_EQ(0, cache.init());
+
+  bufferlist bl;
+  // larger than rgw_data_cache_max_obj_size
+  cache.put("big", make_bl("tag"), make_bl(std::string(41, 'x')));
+  ASSERT_FALSE(cache.contains("big"));
+  // no tag to check against
+  cache.put("untagged", bufferlist(), make_bl("data"));
+  ASSERT_FALSE(cache.contains("untagged"));
+
+  // 40 bytes each, so only two fit in 100 bytes
+  std::string data(40, 'x');
+  cache.put("a", make_bl("tag"), make_bl(data));
+  cache.put("b", make_bl("tag"), make_bl(data));
+  ASSERT_TRUE(cache.get("a", make_bl("tag"), bl)); // b is now least recent
+  cache.put("c", make_bl("tag"), make_bl(data));
+  ASSERT_TRUE(cache.contains("a"));
+  ASSERT_FALSE(cache.contains("b"));
+  ASSERT_TRUE(cache.contains("c"));
+
+  cache.remove("a");
+  ASSERT_FALSE(cache.contains("a"));
+}
+
+TEST_F(DataCacheTest, FileTier)
+{
+  char dir[] = "/tmp/test_rgw_data_cache.XXXXXX";
+  ASSERT_TRUE(mkdtemp(dir) != NULL);
+  g_ceph_context->_conf->set_val("rgw_data_cache_path", dir);
+  g_ceph_context->_conf->apply_changes(NULL);
+
+  {
+    RGWDataCache cache(g_ceph_context);
+    ASSERT_EQ(0, cache.init());
+
+    cache.put("a", make_bl("tag"), make_bl(std::string(40, 'a')));
+    cache.put("b", make_bl("tag"), make_bl(std::string(40, 'b')));
+    cache.put("c", make_bl("tag"), make_bl(std::string(40, 'c')));
+
+    // a went from memory to a file
+    bufferlist bl;
+    ASSERT_TRUE(cache.contains("a"));
+    ASSERT_TRUE(cache.get("a", make_bl("tag"), bl));
+    ASSERT_EQ(std::string(40, 'a'), std::string(bl.c_str(), bl.length()));
+
+    // a stale file entry is dropped too
+    cache.put("d", make_bl("tag"), make_bl(std::string(40, 'd')));
+    cache.put("e", make_bl("tag"), make_bl(std::string(40, 'e')));
+    ASSERT_FALSE(cache.get("b", make_bl("new tag"), bl));
+    ASSERT_FALSE(cache.contains("b"));
+  }
+
+  ASSERT_EQ(0, rmdir(dir));
+}
+
+int main(int argc, char** argv)
+{
+  vector<const char*> args;
+  argv_to_vec(argc, (const char **)argv, args);
+
+  global_init(NULL, args, CEPH_ENTITY_TYPE_CLIENT, CODE_ENVIRONMENT_UTILITY, 0);
+  common_init_finish(g_ceph_context);
+
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
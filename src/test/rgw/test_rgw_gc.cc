@@ -0,0 +1,121 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ *
+ */
+#include "rgw/rgw_gc.h"
+#include "global/global_init.h"
+#include "global/global_context.h"
+#include "common/ceph_argparse.h"
+#include <gtest/gtest.h>
+
+namespace {
+
+// records the entries that would be trimmed from the gc object
+class RecordingGC : public RGWGC {
+public:
+  std::list<string> removed;
+  int calls = 0;
+
+  int remove(int index, const std::list<string>& tags) override {
+    EXPECT_EQ(3, index);
+    removed.insert(removed.end(), tags.begin(), tags.end());
+    calls++;
+    return 0;
+  }
+};
+
+} // anonymous namespace
+
+TEST(RGWGCIOManager, FullChain)
+{
+  RecordingGC gc;
+  RGWGCIOManager io_manager(g_ceph_context, &gc, 3);
+
+  // the removals of the chain's objects complete while still scheduling
+  io_manager.start_tag("a");
+  io_manager.start_tag("a");
+  io_manager.put_tag("a");
+  io_manager.start_tag("a");
+  io_manager.put_tag("a");
+  ASSERT_EQ(0u, io_manager.chains_removed);
+  io_manager.put_tag("a");
+  ASSERT_EQ(1u, io_manager.chains_removed);
+
+  io_manager.drain();
+  ASSERT_EQ(std::list<string>{"a"}, gc.removed);
+
+  // nothing left to flush
+  io_manager.drain();
+  ASSERT_EQ(1, gc.calls);
+}
+
+TEST(RGWGCIOManager, AbortedChain)
+{
+  RecordingGC gc;
+  {
+    RGWGCIOManager io_manager(g_ceph_context, &gc, 3);
+
+    // left early, e.g. when going down: the entry stays
+    io_manager.start_tag("a");
+    io_manager.fail_tag("a");
+    io_manager.put_tag("a");
+
+    // a removal failed while others were still pending
+    io_manager.start_tag("b");
+    io_manager.start_tag("b");
+    io_manager.put_tag("b");
+    io_manager.fail_tag("b");
+    io_manager.put_tag("b");
+
+    io_manager.start_tag("c");
+    io_manager.put_tag("c");
+    ASSERT_EQ(1u, io_manager.chains_removed);
+
+    // a failure doesn't stick to the tag
+    io_manager.start_tag("a");
+    io_manager.put_tag("a");
+    ASSERT_EQ(2u, io_manager.chains_removed);
+  }
+  // flushed when the manager goes away
+  ASSERT_EQ((std::list<string>{"c", "a"}), gc.removed);
+}
+
+TEST(RGWGCIOManager, RemoveChunks)
+{
+  RecordingGC gc;
+  RGWGCIOManager io_manager(g_ceph_context, &gc, 3);
+
+  std::list<string> tags;
+  for (int i = 0; i < 40; i++) {
+    string tag = "tag" + std::to_string(i);
+    tags.push_back(tag);
+    io_manager.start_tag(tag);
+    io_manager.put_tag(tag);
+  }
+  // trimmed in chunks as entries complete
+  ASSERT_LT(0, gc.calls);
+  ASSERT_GT(tags.size(), gc.removed.size());
+
+  io_manager.drain();
+  ASSERT_EQ(tags, gc.removed);
+  ASSERT_EQ(40u, io_manager.chains_removed);
+}
+
+int main(int argc, char** argv)
+{
+  vector<const char*> args;
+  argv_to_vec(argc, (const char **)argv, args);
+
+  global_init(NULL, args, CEPH_ENTITY_TYPE_CLIENT, CODE_ENVIRONMENT_UTILITY, 0);
+  common_init_finish(g_ceph_context);
+
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -225,3 +225,51 @@ TEST(TestRGWManifest, multipart) {
   ASSERT_EQ(m.get_obj_size(), num_parts * part_size);
 }
 
+TEST(TestRGWManifest, explicit_obj) {
+  rgw_bucket bucket;
+  init_bucket(&bucket, "", "buck");
+
+  rgw_obj head(bucket, "oid");
+
+  int num_objs = 5;
+  uint64_t stripe_size = 4 * 1024 * 1024;
+  uint64_t obj_size = (num_objs - 1) * stripe_size + 1000;
+
+  map<uint64_t, RGWObjManifestPart> parts;
+  list<rgw_obj> objs;
+  for (int i = 0; i < num_objs; i++) {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "shadow_%d", i);
+    RGWObjManifestPart& part = parts[i * stripe_size];
+    part.loc.init_ns(bucket, buf, "shadow");
+    part.loc_ofs = i;
+    part.size = MIN(stripe_size, obj_size - i * stripe_size);
+    objs.push_back(part.loc);
+  }
+
+  RGWObjManifest manifest;
+  manifest.set_explicit(obj_size, parts);
+  manifest.set_head(head);
+  manifest.set_head_size(0);
+
+  ASSERT_EQ(manifest.get_obj_size(), obj_size);
+  ASSERT_TRUE(manifest.has_tail());
+
+  list<rgw_obj>::iterator liter;
+  RGWObjManifest::obj_iterator iter;
+  int i = 0;
+  for (iter = manifest.obj_begin(), liter = objs.begin();
+       iter != manifest.obj_end() && liter != objs.end();
+       ++iter, ++liter, ++i) {
+    ASSERT_TRUE(*liter == iter.get_location());
+    ASSERT_EQ(iter.get_stripe_ofs(), i * stripe_size);
+    ASSERT_EQ(iter.location_ofs(), (uint64_t)i);
+  }
+  ASSERT_TRUE(iter == manifest.obj_end());
+  ASSERT_TRUE(liter == objs.end());
+
+  iter = manifest.obj_find(obj_size - 1);
+  ASSERT_TRUE(iter.get_location() == objs.back());
+  ASSERT_EQ(iter.get_stripe_size(), 1000u);
+}
+
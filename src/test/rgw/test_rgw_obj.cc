@@ -16,6 +16,8 @@
 #include "common/ceph_json.h"
 #include "common/Formatter.h"
 #include "rgw/rgw_common.h"
+#include "rgw/rgw_rados.h"
+#include "rgw/rgw_op.h"
 #define GTEST
 #ifdef GTEST
 #include <gtest/gtest.h>
@@ -157,3 +159,44 @@ TEST(TestRGWObj, no_underscore) {
   test_obj("obj", "ns", "v1");
 }
 
+TEST(TestRGWObj, bi_key_hash_source) {
+  rgw_bucket b;
+  init_bucket(&b, "test");
+
+  const char *names[] = { "obj", "_obj", "dir/file.tar.gz", NULL };
+  for (const char **name = names; *name; ++name) {
+    rgw_obj obj(b, *name);
+    ASSERT_EQ(obj.get_hash_object(), RGWRados::bi_key_hash_source(obj.get_index_key_name()));
+
+    /* multipart upload meta objects go with the object being uploaded */
+    RGWMPObj mp(*name, "2~upload");
+    rgw_obj meta_obj;
+    meta_obj.init_ns(b, mp.get_meta(), RGW_OBJ_NS_MULTIPART);
+    meta_obj.index_hash_source = *name;
+    ASSERT_EQ(meta_obj.get_hash_object(), RGWRados::bi_key_hash_source(meta_obj.get_index_key_name()));
+  }
+}
+
+TEST(TestRGWObj, reshard_shard_mapping) {
+  /* growing the shard count by a multiple either leaves an entry where it
+   * is or moves it to one of the added shards */
+  const uint32_t counts[][2] = { {1, 2}, {2, 4}, {3, 12}, {7, 21}, {16, 1024} };
+  for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); ++i) {
+    uint32_t old_num = counts[i][0];
+    uint32_t new_num = counts[i][1];
+    for (int j = 0; j < 1000; ++j) {
+      char key[32];
+      snprintf(key, sizeof(key), "obj-%d", j);
+      string old_oid, new_oid;
+      int old_shard, new_shard;
+      ASSERT_EQ(0, RGWRados::get_bucket_index_object(".dir.marker", key, old_num,
+                                                     RGWBucketInfo::MOD, &old_oid, &old_shard));
+      ASSERT_EQ(0, RGWRados::get_bucket_index_object(".dir.marker", key, new_num,
+                                                     RGWBucketInfo::MOD, &new_oid, &new_shard));
+      ASSERT_EQ(old_shard, new_shard % (int)old_num);
+      if (new_shard < (int)old_num) {
+        ASSERT_EQ(old_oid, new_oid);
+      }
+    }
+  }
+}
@@ -9,6 +9,7 @@
 #include "common/config.h"
 #include "common/Finisher.h"
 #include "os/filestore/FileJournal.h"
+#include "os/filestore/StripedJournal.h"
 #include "include/Context.h"
 #include "common/Mutex.h"
 #include "common/safe_io.h"
@@ -665,3 +666,289 @@ TEST(TestFileJournal, ReplayDetectCorruptHeader) {
     ::close(fd);
   }
 }
+
+static void get_stripe_paths(vector<string> *paths, unsigned n)
+{
+  paths->clear();
+  paths->push_back(path);
+  for (unsigned i = 1; i < n; ++i) {
+    char p[220];
+    snprintf(p, sizeof(p), "%s.stripe%u", path, i);
+    paths->push_back(p);
+  }
+}
+
+static void remove_stripe_paths(const vector<string>& paths)
+{
+  // the first one is path, which main() cleans up
+  for (unsigned i = 1; i < paths.size(); ++i)
+    unlink(paths[i].c_str());
+}
+
+TEST(TestStripedJournal, WriteMany) {
+  g_ceph_context->_conf->set_val("journal_ignore_corruption", "false");
+  g_ceph_context->_conf->set_val("journal_write_header_frequency", "0");
+  g_ceph_context->_conf->apply_changes(NULL);
+
+  vector<string> paths;
+  get_stripe_paths(&paths, 3);
+
+  for (unsigned i = 0 ; i < 3; ++i) {
+    SCOPED_TRACE(subtests[i].description);
+    fsid.generate_random();
+    StripedJournal j(fsid, finisher, &sync_cond, paths, subtests[i].directio,
+		     subtests[i].aio, subtests[i].faio);
+    ASSERT_EQ(0, j.create());
+    j.make_writeable();
+
+    // completions must come back in seq order even though the
+    // stripes write independently
+    Mutex order_lock("order_lock");
+    vector<uint64_t> order;
+    struct C_Order : public Context {
+      Mutex *lock;
+      vector<uint64_t> *order;
+      uint64_t seq;
+      Context *c;
+      C_Order(Mutex *l, vector<uint64_t> *o, uint64_t s, Context *c)
+	: lock(l), order(o), seq(s), c(c) {}
+      void finish(int r) {
+	{
+	  Mutex::Locker l(*lock);
+	  order->push_back(seq);
+	}
+	c->complete(r);
+      }
+    };
+
+    uint64_t seq = 1;
+    {
+      C_Sync s;
+      C_GatherBuilder gb(g_ceph_context, s.c);
+      vector<ObjectStore::Transaction> tls;
+      for (int n = 0; n < 100; n++, seq++) {
+	bufferlist bl;
+	bl.append("small");
+	int orig_len = j.prepare_entry(tls, &bl);
+	j.submit_entry(seq, bl, orig_len,
+		       new C_Order(&order_lock, &order, seq, gb.new_sub()));
+      }
+      gb.activate();
+    }
+
+    ASSERT_EQ(100u, order.size());
+    for (unsigned n = 0; n < order.size(); ++n)
+      ASSERT_EQ(n + 1, order[n]);
+
+    j.close();
+
+    j.open(10);
+
+    bufferlist inbl;
+    string v;
+    uint64_t rseq = 0;
+    for (uint64_t want = 11; want < seq; ++want) {
+      ASSERT_EQ(true, j.read_entry(inbl, rseq));
+      ASSERT_EQ(want, rseq);
+      inbl.copy(0, inbl.length(), v);
+      ASSERT_EQ("small", v);
+      inbl.clear();
+      v.clear();
+    }
+    ASSERT_TRUE(!j.read_entry(inbl, rseq));
+
+    j.make_writeable();
+    j.close();
+  }
+  remove_stripe_paths(paths);
+}
+
+TEST(TestStripedJournal, ReplayStopsAtGap) {
+  g_ceph_context->_conf->set_val("journal_ignore_corruption", "false");
+  g_ceph_context->_conf->set_val("journal_write_header_frequency", "0");
+  g_ceph_context->_conf->apply_changes(NULL);
+
+  vector<string> paths;
+  get_stripe_paths(&paths, 2);
+
+  fsid.generate_random();
+  StripedJournal j(fsid, finisher, &sync_cond, paths);
+  ASSERT_EQ(0, j.create());
+  j.make_writeable();
+
+  // write 1..4 through the stripes, then 6 directly to its stripe so
+  // that 5 is missing
+  {
+    C_Sync s;
+    C_GatherBuilder gb(g_ceph_context, s.c);
+    vector<ObjectStore::Transaction> tls;
+    for (uint64_t seq = 1; seq <= 4; seq++) {
+      bufferlist bl;
+      bl.append("small");
+      int orig_len = j.prepare_entry(tls, &bl);
+      j.submit_entry(seq, bl, orig_len, gb.new_sub());
+    }
+    gb.activate();
+  }
+  j.close();
+
+  {
+    FileJournal even(fsid, finisher, &sync_cond, paths[0].c_str());
+    even.set_seq_stride(2, 0);
+    ASSERT_EQ(0, even.open(0));
+    uint64_t seq = 0;
+    bufferlist inbl;
+    while (even.read_entry(inbl, seq)) {
+      inbl.clear();
+      seq += 2;
+    }
+    even.make_writeable();
+
+    vector<ObjectStore::Transaction> tls;
+    bufferlist bl;
+    bl.append("small");
+    int orig_len = even.prepare_entry(tls, &bl);
+    {
+      C_Sync s;
+      even.submit_entry(6, bl, orig_len, s.c);
+    }
+    even.close();
+  }
+
+  j.open(0);
+  bufferlist inbl;
+  uint64_t seq = 0;
+  for (uint64_t want = 1; want <= 4; ++want) {
+    ASSERT_EQ(true, j.read_entry(inbl, seq));
+    ASSERT_EQ(want, seq);
+    inbl.clear();
+  }
+  ASSERT_TRUE(!j.read_entry(inbl, seq));
+  j.make_writeable();
+  j.close();
+
+  remove_stripe_paths(paths);
+}
+
+// write the given seqs, which must all map to the given stripe, directly
+// to that stripe, as if the others had lost theirs in a crash
+static void write_to_stripe(const vector<string>& paths, unsigned stripe,
+			    const vector<uint64_t>& seqs)
+{
+  FileJournal fj(fsid, finisher, &sync_cond, paths[stripe].c_str());
+  fj.set_seq_stride(paths.size(), stripe);
+  ASSERT_EQ(0, fj.open(0));
+  uint64_t seq = 0;
+  bufferlist inbl;
+  while (fj.read_entry(inbl, seq)) {
+    inbl.clear();
+    seq += paths.size();
+  }
+  fj.make_writeable();
+  {
+    C_Sync s;
+    C_GatherBuilder gb(g_ceph_context, s.c);
+    vector<ObjectStore::Transaction> tls;
+    for (vector<uint64_t>::const_iterator p = seqs.begin();
+	 p != seqs.end();
+	 ++p) {
+      ASSERT_EQ(stripe, *p % paths.size());
+      bufferlist bl;
+      bl.append("small");
+      int orig_len = fj.prepare_entry(tls, &bl);
+      fj.submit_entry(*p, bl, orig_len, gb.new_sub());
+    }
+    gb.activate();
+  }
+  fj.close();
+}
+
+static void submit_small(StripedJournal& j, uint64_t first, uint64_t last)
+{
+  C_Sync s;
+  C_GatherBuilder gb(g_ceph_context, s.c);
+  vector<ObjectStore::Transaction> tls;
+  for (uint64_t seq = first; seq <= last; seq++) {
+    bufferlist bl;
+    bl.append("small");
+    int orig_len = j.prepare_entry(tls, &bl);
+    j.submit_entry(seq, bl, orig_len, gb.new_sub());
+  }
+  gb.activate();
+}
+
+TEST(TestStripedJournal, ReplayAfterGap) {
+  g_ceph_context->_conf->set_val("journal_ignore_corruption", "false");
+  g_ceph_context->_conf->set_val("journal_write_header_frequency", "0");
+  g_ceph_context->_conf->apply_changes(NULL);
+
+  vector<string> paths;
+  get_stripe_paths(&paths, 2);
+
+  fsid.generate_random();
+  StripedJournal j(fsid, finisher, &sync_cond, paths);
+  ASSERT_EQ(0, j.create());
+  j.make_writeable();
+  submit_small(j, 1, 4);
+  j.close();
+
+  // crash: 5 was torn in the odd stripe, but 6 and 8 made it to the
+  // even one, and 7 made it to the odd one past the torn entry
+  {
+    vector<uint64_t> seqs;
+    seqs.push_back(6);
+    seqs.push_back(8);
+    write_to_stripe(paths, 0, seqs);
+  }
+  {
+    vector<uint64_t> seqs;
+    seqs.push_back(5);
+    seqs.push_back(7);
+    write_to_stripe(paths, 1, seqs);
+
+    FileJournal odd(fsid, finisher, &sync_cond, paths[1].c_str());
+    odd.set_seq_stride(2, 1);
+    int fd = open(paths[1].c_str(), O_WRONLY);
+    ASSERT_EQ(0, odd.open(0));
+    odd.corrupt_header_magic(fd, 5);
+    odd.close();
+    ::close(fd);
+  }
+  // a torn 5 would have kept the odd stripe's header from claiming 7
+  g_ceph_context->_conf->set_val("journal_ignore_corruption", "true");
+  g_ceph_context->_conf->apply_changes(NULL);
+
+  // replay stops at the gap
+  bufferlist inbl;
+  uint64_t seq = 0;
+  ASSERT_EQ(0, j.open(0));
+  for (uint64_t want = 1; want <= 4; ++want) {
+    ASSERT_EQ(true, j.read_entry(inbl, seq));
+    ASSERT_EQ(want, seq);
+    inbl.clear();
+  }
+  ASSERT_TRUE(!j.read_entry(inbl, seq));
+  ASSERT_EQ(0, j.make_writeable());
+
+  // new entries fill the gap, landing where the old ones were; crash
+  // again before 8 is rewritten
+  submit_small(j, 5, 7);
+  j.close();
+
+  // the old 8 must not come back
+  ASSERT_EQ(0, j.open(0));
+  seq = 0;
+  for (uint64_t want = 1; want <= 7; ++want) {
+    ASSERT_EQ(true, j.read_entry(inbl, seq));
+    ASSERT_EQ(want, seq);
+    string v;
+    inbl.copy(0, inbl.length(), v);
+    ASSERT_EQ("small", v);
+    inbl.clear();
+  }
+  ASSERT_TRUE(!j.read_entry(inbl, seq));
+  ASSERT_EQ(0, j.make_writeable());
+  j.close();
+
+  remove_stripe_paths(paths);
+}
@@ -36,6 +36,10 @@ void usage()
   cout << "   --test-map-pg <pgid>    map a pgid to osds" << std::endl;
   cout << "   --test-map-object <objectname> [--pool <poolid>] map an object to osds"
        << std::endl;
+  cout << "   --optimize-pg-weights [--pool <poolid>] [--max-iterations <n>]"
+       << std::endl;
+  cout << "                           adjust osd reweights to even out pg counts"
+       << std::endl;
   exit(1);
 }
 
@@ -73,6 +77,8 @@ int main(int argc, const char **argv)
   bool test_map_pgs = false;
   bool test_map_pgs_dump = false;
   bool test_random = false;
+  bool optimize_pg_weights = false;
+  int max_iterations = g_conf->mon_pg_balance_max_iterations;
 
   std::string val;
   std::ostringstream err;
@@ -109,6 +115,13 @@ int main(int argc, const char **argv)
       test_map_pgs = true;
     } else if (ceph_argparse_flag(args, i, "--test-map-pgs-dump", (char*)NULL)) {
       test_map_pgs_dump = true;
+    } else if (ceph_argparse_flag(args, i, "--optimize-pg-weights", (char*)NULL)) {
+      optimize_pg_weights = true;
+    } else if (ceph_argparse_witharg(args, i, &max_iterations, err, "--max-iterations", (char*)NULL)) {
+      if (!err.str().empty()) {
+	cerr << err.str() << std::endl;
+	exit(EXIT_FAILURE);
+      }
     } else if (ceph_argparse_flag(args, i, "--test-random", (char*)NULL)) {
       test_random = true;
     } else if (ceph_argparse_flag(args, i, "--clobber", (char*)NULL)) {
@@ -318,6 +331,34 @@ int main(int argc, const char **argv)
          << ") acting (" << acting << ", p" << acting_primary << ")"
          << std::endl;
   }
+  if (optimize_pg_weights) {
+    if (pool != -1 && !osdmap.have_pg_pool(pool)) {
+      cerr << "There is no pool " << pool << std::endl;
+      exit(1);
+    }
+    set<int64_t> pools;
+    if (pool != -1)
+      pools.insert(pool);
+    map<int,unsigned> new_weights;
+    ostringstream ss;
+    r = osdmap.calc_pg_balance_weights(pools, max_iterations,
+				       g_conf->mon_pg_balance_max_change,
+				       &new_weights, &ss);
+    if (r < 0) {
+      cerr << me << ": " << ss.str() << std::endl;
+      exit(1);
+    }
+    for (map<int,unsigned>::iterator p = new_weights.begin();
+	 p != new_weights.end(); ++p) {
+      cout << "osd." << p->first << " reweight "
+	   << osdmap.get_weightf(p->first) << " -> "
+	   << (float)p->second / (float)CEPH_OSD_IN << std::endl;
+      osdmap.set_weight(p->first, p->second);
+    }
+    cout << ss.str() << std::endl;
+    if (!new_weights.empty())
+      modified = true;
+  }
   if (test_map_pgs || test_map_pgs_dump) {
     if (pool != -1 && !osdmap.have_pg_pool(pool)) {
       cerr << "There is no pool " << pool << std::endl;